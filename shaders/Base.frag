@@ -1,6 +1,11 @@
 //Base lighting fragment shader
 #version 450
 #extension GL_ARB_separate_shader_objects:enable
+// BINDLESS is defined by the renderer if the device supports descriptor
+// indexing, otherwise every mesh binds its own texture
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier:require
+#endif
 
 /*layout(set = 0,binding = 2) uniform Material
 {
@@ -51,29 +56,40 @@ layout(set = 0, binding = 1) uniform Lights
     LightData lights[16];
 } sceneLights;
 
-layout(set = 0, binding = 2) uniform ViewPosition
+layout(set = 0, binding = 0) uniform Frame
 {
+    mat4 view;
+    mat4 projection;
+    mat4 PV;
     vec4 viewPos;
-} cameraData;
+    vec4 time;
+} frame;
 
-layout(set = 0, binding = 4) uniform DirectionalShadows
+layout(set = 0, binding = 2) uniform DirectionalShadows
 {
     ivec4 counts;
     DirectionalShadowEntry entries[10];
 } dirShadows;
 
-layout(set = 0, binding = 6) uniform PointShadows
+layout(set = 0, binding = 4) uniform PointShadows
 {
     ivec4 counts;
     PointShadowEntry entries[5];
 } pointShadows;
 
-layout(set = 0, binding = 3) uniform sampler2D diffuse;
-layout(set = 0, binding = 5) uniform sampler2DArrayShadow dirShadowMaps;
-layout(set = 0, binding = 7) uniform samplerCubeArrayShadow pointShadowMaps;
+layout(set = 0, binding = 3) uniform sampler2DArrayShadow dirShadowMaps;
+layout(set = 0, binding = 5) uniform samplerCubeArrayShadow pointShadowMaps;
+
+#ifdef BINDLESS
+// Bindless texture table, indexed through the object record
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+#else
+layout(set = 1, binding = 0) uniform sampler2D diffuse;
+#endif
 
 layout(location = 0) out vec4 FragColor;
 layout(location = 0) in VS_OUT vs_out;
+layout(location = 5) flat in int textureIndex;
 
 float calcDirectionalShadow(int lightSlot, vec3 normal, vec3 lightDir)
 {
@@ -184,7 +200,13 @@ float calcPointShadow(int lightSlot, vec3 normal, vec3 lightDir)
 
 void main()
 { 
+#ifdef BINDLESS
+    // Draws of one indirect call may differ in texture
+    vec3 baseColor = texture(textures[nonuniformEXT(textureIndex)],
+                             vs_out.TexCoords).rgb;
+#else
     vec3 baseColor = texture(diffuse, vs_out.TexCoords).rgb;
+#endif
     vec3 N = normalize(vs_out.Normal);
     vec3 lighting = vec3(0.0);
 
@@ -237,7 +259,7 @@ void main()
         vec3 amb = sceneLights.lights[i].ambient.rgb;
         vec3 dif = sceneLights.lights[i].diffuse.rgb * ndotl;
 
-        vec3 V = normalize(cameraData.viewPos.xyz - vs_out.FragPos);
+        vec3 V = normalize(frame.viewPos.xyz - vs_out.FragPos);
         vec3 R = reflect(-L, N);
         float specPow = 16.0;
         float specTerm = pow(max(dot(V, R), 0.0), specPow);
@@ -17,19 +17,37 @@ struct VS_OUT
     vec3 Normal;
 };
 
-layout(set = 0,binding = 0) uniform Transform
+layout(set = 0, binding = 0) uniform Frame
 {
-	mat4 model;
-	mat4 PV;
-	mat4 NormalMatrix;
-} transform;
+    mat4 view;
+    mat4 projection;
+    mat4 PV;
+    vec4 viewPos;
+    vec4 time;
+} frame;
+
+struct ObjectRecord
+{
+    mat4 model;
+    mat4 NormalMatrix;
+    ivec4 meta; // x=material index, y=diffuse texture index
+};
+
+// Record of the draw is selected through firstInstance
+layout(std430, set = 0, binding = 6) readonly buffer Objects
+{
+    ObjectRecord records[];
+} objects;
 
 layout(location = 0) out VS_OUT vs_out;
+layout(location = 5) flat out int textureIndex;
 
 void main()
 {
-    vs_out.FragPos = vec3(transform.model * vec4(position, 1.0));
-    vs_out.Normal = normalize((transform.NormalMatrix * vec4(vertexNormal, 0.0)).xyz);
+    ObjectRecord object = objects.records[gl_InstanceIndex];
+    vs_out.FragPos = vec3(object.model * vec4(position, 1.0));
+    vs_out.Normal = normalize((object.NormalMatrix * vec4(vertexNormal, 0.0)).xyz);
     vs_out.TexCoords = texCoord;
-    gl_Position = transform.PV * transform.model * vec4(position, 1.0);
+    textureIndex = object.meta.y;
+    gl_Position = frame.PV * object.model * vec4(position, 1.0);
 }
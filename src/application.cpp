@@ -5,8 +5,6 @@
 #include "configure.h"
 
 #include <filesystem>
-#include <chrono>
-#include <thread>
 
 namespace Multor
 {
@@ -33,8 +31,32 @@ Application::Application()
             pContr_    = std::make_shared<PositionController>();
             pLights_   = std::make_shared<LightManager>();
             pScene_    = std::make_shared<Scene>(pContr_);
+
+            headless_ = table_["rendering"]["headless"].value_or(false);
+            if (headless_)
+                {
+                    const VkExtent2D extent {
+                        table_["rendering"]["headless_width"].value_or(1280u),
+                        table_["rendering"]["headless_height"].value_or(720u)};
+                    headlessFrames_ =
+                        table_["rendering"]["headless_frames"].value_or(0u);
+                    pContr_->UpdateProjectionMatrix(
+                        static_cast<float>(extent.width),
+                        static_cast<float>(extent.height));
+                    pContr_->UpdateViewMatrix();
+                    pRenderer_ =
+                        std::make_shared<Vulkan::Renderer>(pContr_, extent);
+                    ApplyRenderingOptions();
+                    SyncLightsToRenderer();
+
+                    LOG_INFO(logger.get(), "Application was initializated in headless mode {}x{}",
+                             extent.width, extent.height);
+                    return;
+                }
+
             pWindow_   = std::make_shared<Window>(&signals_, pContr_);
             pRenderer_ = std::make_shared<Vulkan::Renderer>(pWindow_);
+            ApplyRenderingOptions();
             pGui_      = std::make_unique<ImGuiOverlay>();
             pGui_->AttachWindow(pWindow_.get());
             pGui_->AttachRenderer(pRenderer_);
@@ -124,6 +146,65 @@ void Application::InvalidateShadows()
     pRenderer_->InvalidateShadows();
 }
 
+void Application::ApplyRenderingOptions()
+{
+    pRenderer_->SetIndirectDrawsEnabled(
+        table_["rendering"]["indirect_draws"].value_or(false));
+    pRenderer_->SetShaderHotReloadEnabled(
+        table_["rendering"]["shader_hot_reload"].value_or(false));
+    pRenderer_->SetTextureCompressionEnabled(
+        table_["rendering"]["compress_textures"].value_or(false));
+    pRenderer_->SetTextureStreamingEnabled(
+        table_["rendering"]["stream_textures"].value_or(false));
+    const int64_t budgetMb =
+        table_["rendering"]["texture_budget_mb"].value_or(int64_t(0));
+    pRenderer_->SetTextureBudget(
+        budgetMb > 0 ? VkDeviceSize(budgetMb) << 20 : 0);
+
+    const std::string presentMode =
+        table_["rendering"]["present_mode"].value_or(std::string("MAILBOX"));
+    if (presentMode == "FIFO")
+        pRenderer_->SetPresentMode(VK_PRESENT_MODE_FIFO_KHR);
+    else if (presentMode == "IMMEDIATE")
+        pRenderer_->SetPresentMode(VK_PRESENT_MODE_IMMEDIATE_KHR);
+    else if (presentMode == "MAILBOX")
+        pRenderer_->SetPresentMode(VK_PRESENT_MODE_MAILBOX_KHR);
+    else
+        throw std::runtime_error("unknown present mode " + presentMode);
+
+    //Headless frames are not limited, they run as fast as possible
+    int maxFps = headless_ ? 0 : table_["rendering"]["max_fps"].value_or(30);
+    //FIFO presents already block on vertical blank, a limit at or above
+    //the refresh rate would only report the blocked frames as missed
+    if (maxFps > 0 && pRenderer_->GetPresentMode() == VK_PRESENT_MODE_FIFO_KHR)
+        {
+            const SDL_DisplayMode* dm = SDL_GetCurrentDisplayMode(
+                SDL_GetDisplayForWindow(pWindow_->GetWindow()));
+            if (dm && dm->refresh_rate > 0.0f &&
+                static_cast<float>(maxFps) >= dm->refresh_rate)
+                maxFps = 0;
+        }
+    pacer_.SetTargetFps(maxFps);
+}
+
+void Application::ReportFramePacing(Logging::Logger& logger)
+{
+    const double now = GetTime();
+    if (now - pacingReportTime_ < pacingReportPeriod_)
+        return;
+    pacingReportTime_ = now;
+
+    const FramePacingStats stats = pacer_.GetStats();
+    if (stats.frames_ == 0)
+        return;
+    LOG_INFO(logger.get(),
+             "Frame pacing: {} frames, {:.3f} ms mean, {:.3f} ms deviation, "
+             "{:.3f} ms max, {} missed deadlines (target {} FPS)",
+             stats.frames_, stats.meanMs_, stats.stdDevMs_, stats.maxMs_,
+             stats.missed_, pacer_.GetTargetFps());
+    pacer_.ResetStats();
+}
+
 void Application::SyncLightsToRenderer()
 {
     if (!pRenderer_)
@@ -204,13 +285,12 @@ void Application::UpdateSceneBindings()
     if (!pRenderer_)
         return;
 
-    const std::size_t frame = pRenderer_->GetCurFrame();
     for (auto& binding : sceneMeshBindings_)
         {
             auto node = binding.node_.lock();
             if (!node || !binding.vkMesh_ || !binding.vkMesh_->tr_)
                 continue;
-            binding.vkMesh_->tr_->updateModel(frame, node->GetTransform());
+            binding.vkMesh_->tr_->updateModel(node->GetTransform());
         }
 }
 
@@ -219,11 +299,28 @@ bool Application::MainLoop()
     static auto logger{Logging::LoggerFactory::GetLogger(table_["logging"]["filename"].value_or(DEFAULT_LOG_FILE))};
     try
         {
-            using clock = std::chrono::high_resolution_clock;
-            const int maxFps = table_["rendering"]["max_fps"].value_or(30);
-            const auto frameStart = clock::now();
-
             pContr_->dt_ = static_cast<float>(chron_());
+            if (headless_)
+                {
+                    if (pRenderer_->GetFrameCount() == 0)
+                        headlessStart_ = GetTime();
+                    if (headlessFrames_ &&
+                        pRenderer_->GetFrameCount() >= headlessFrames_)
+                        {
+                            LOG_INFO(logger.get(),
+                                     "Headless run finished: {} frames, {:.3f} ms per frame",
+                                     pRenderer_->GetFrameCount(),
+                                     1000.0 * (GetTime() - headlessStart_) /
+                                         static_cast<double>(pRenderer_->GetFrameCount()));
+                            return false;
+                        }
+                    UpdateSceneBindings();
+                    pRenderer_->Draw();
+                    pacer_.Wait();
+                    ReportFramePacing(logger);
+                    return true;
+                }
+
             if (!pWindow_->ProcEvents())
                 return false;
             pWindow_->SwapBuffer();
@@ -236,15 +333,8 @@ bool Application::MainLoop()
                 }
             pRenderer_->Draw();
 
-            if (maxFps > 0)
-                {
-                    const auto frameTarget =
-                        std::chrono::duration<double>(1.0 / static_cast<double>(maxFps));
-                    const auto frameTime = clock::now() - frameStart;
-                    if (frameTime < frameTarget)
-                        std::this_thread::sleep_for(frameTarget - frameTime);
-                }
-
+            pacer_.Wait();
+            ReportFramePacing(logger);
 
             return true;
         }
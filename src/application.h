@@ -13,6 +13,7 @@
 #include "scene_objects/light_manager.h"
 #include "transformation.h"
 #include "utils/time.h"
+#include "utils/frame_pacer.h"
 #include "logger/logger.h"
 #include "configure.h"
 
@@ -48,6 +49,11 @@ private:
 
     toml::table table_;
 
+    //Offscreen rendering without window and GUI
+    bool          headless_       = false;
+    std::uint64_t headlessFrames_ = 0;
+    double        headlessStart_  = 0.0;
+
     /// @brief Controller
     std::shared_ptr<PositionController> pContr_;
     //Pointer of window class
@@ -60,6 +66,11 @@ private:
     //std::shared_ptr<std::unique_ptr<Scene>> _ppScene;
     //Time
     Chronometr chron_;
+    //Frame rate limit, also measures frame time stability
+    FramePacer pacer_;
+    double     pacingReportTime_ = 0.0;
+    //Seconds between frame pacing log lines
+    static constexpr double pacingReportPeriod_ = 10.0;
     //GUI
     std::unique_ptr<ImGuiOverlay> pGui_;
 
@@ -76,6 +87,8 @@ private:
     };
     std::vector<SceneMeshBinding> sceneMeshBindings_;
 
+    void ApplyRenderingOptions();
+    void ReportFramePacing(Logging::Logger& logger);
     void SyncLightsToRenderer();
     void SyncSceneToRenderer();
     void UpdateSceneBindings();
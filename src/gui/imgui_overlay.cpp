@@ -160,7 +160,7 @@ bool ImGuiOverlay::EnsureInitialized()
     initInfo.Device         = renderer->GetVkDevice();
     initInfo.QueueFamily    = renderer->GetVkGraphicsQueueFamilyIndex();
     initInfo.Queue          = renderer->GetVkGraphicsQueue();
-    initInfo.PipelineCache  = VK_NULL_HANDLE;
+    initInfo.PipelineCache  = renderer->GetVkPipelineCache();
     initInfo.DescriptorPool = imguiDescriptorPool_;
     initInfo.RenderPass     = renderer->GetVkRenderPass();
     initInfo.Subpass        = 0;
@@ -392,6 +392,29 @@ void ImGuiOverlay::Draw(const std::shared_ptr<Scene>& scene,
                     if (renderer)
                         {
                             ImGui::Text("Frame idx: %zu", renderer->GetCurFrame());
+                            ImGui::Text("Samplers: %zu", renderer->GetSamplerCount());
+                            if (renderer->IsTextureStreamingEnabled())
+                                {
+                                    const auto streaming =
+                                        renderer->GetTextureStreamingStats();
+                                    ImGui::Text("Textures streaming: %u queued, %u uploading",
+                                                streaming.queued_, streaming.uploading_);
+                                }
+                            const auto residency =
+                                renderer->GetTextureResidencyStats();
+                            const double mib = 1024.0 * 1024.0;
+                            if (residency.budget_ > 0)
+                                {
+                                    ImGui::Text("Texture memory: %.1f / %.1f MiB (%.0f%%)",
+                                                residency.resident_ / mib,
+                                                residency.budget_ / mib,
+                                                residency.pressure_ * 100.0f);
+                                    ImGui::Text("Texture evictions: %.1f/s",
+                                                residency.evictionsPerSecond_);
+                                }
+                            else
+                                ImGui::Text("Texture memory: %.1f MiB",
+                                            residency.resident_ / mib);
                         }
                     ImGui::Separator();
                     ImGui::TextWrapped("%s", backendStatus_.c_str());
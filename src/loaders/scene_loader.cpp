@@ -400,7 +400,10 @@ SceneLoader::processTextures(aiMaterial* src, aiTextureType type,
                         }
                 }
 
+            //Encoded images are decoded when the texture is first used,
+            //so opening a scene does not wait for them
             std::shared_ptr<Image> image;
+            ImageSource            source;
             std::string resolvedPath = pathStr;
 
             if (scene_ && scene_->HasTextures())
@@ -409,9 +412,20 @@ SceneLoader::processTextures(aiMaterial* src, aiTextureType type,
                         {
                             if (embedded->mHeight == 0)
                                 {
-                                    image = ImageLoader::LoadTexture(
-                                        embedded->pcData,
-                                        static_cast<int>(embedded->mWidth));
+                                    //The importer frees its copy with the loader
+                                    const auto* bytes = reinterpret_cast<
+                                        const unsigned char*>(embedded->pcData);
+                                    auto encoded = std::make_shared<
+                                        std::vector<unsigned char> >(
+                                        bytes, bytes + embedded->mWidth);
+                                    source = [encoded]()
+                                    {
+                                        auto img = ImageLoader::LoadTexture(
+                                            encoded->data(),
+                                            static_cast<int>(encoded->size()));
+                                        return img ? std::vector<std::shared_ptr<Image> > {img}
+                                                   : std::vector<std::shared_ptr<Image> > {};
+                                    };
                                 }
                             else
                                 {
@@ -427,21 +441,32 @@ SceneLoader::processTextures(aiMaterial* src, aiTextureType type,
                         }
                 }
 
-            if (!image)
+            if (!image && !source)
                 {
                     std::filesystem::path fullPath = pathStr;
                     if (fullPath.is_relative() && !sceneDir_.empty())
                         fullPath = std::filesystem::path(sceneDir_) / fullPath;
                     resolvedPath = fullPath.string();
-                    image = ImageLoader::LoadTexture(resolvedPath.c_str());
+                    std::error_code error;
+                    if (!std::filesystem::is_regular_file(fullPath, error))
+                        continue;
+                    source = [resolvedPath]()
+                    {
+                        auto img = ImageLoader::LoadTexture(resolvedPath.c_str());
+                        return img ? std::vector<std::shared_ptr<Image> > {img}
+                                   : std::vector<std::shared_ptr<Image> > {};
+                    };
                 }
 
-            if (!image || image->empty())
+            if (image && image->empty())
                 continue;
 
-            auto texture = std::make_shared<BaseTexture>(
-                pathStr, resolvedPath, targetType,
-                std::vector<std::shared_ptr<Image> > {image});
+            auto texture =
+                image ? std::make_shared<BaseTexture>(
+                            pathStr, resolvedPath, targetType,
+                            std::vector<std::shared_ptr<Image> > {image})
+                      : std::make_shared<BaseTexture>(pathStr, resolvedPath,
+                                                      targetType, source);
             textureCache_[hashKey] = texture;
             result.push_back(std::move(texture));
         }
@@ -137,9 +137,8 @@ int main(int argc, char* args[])
                     std::tie(m1, m2) = spawnDebugCubes();
                     ground = spawnDebugGroundPlane();
                     if (m2 && m2->tr_)
-                        m2->tr_->updateModel(app.GetRenderer()->GetCurFrame(),
-                                             glm::translate(glm::mat4(1.0f),
-                                                            glm::vec3(1.2f, 0.0f, 0.0f)));
+                        m2->tr_->updateModel(glm::translate(
+                            glm::mat4(1.0f), glm::vec3(1.2f, 0.0f, 0.0f)));
                 }
             else
                 {
@@ -153,9 +152,8 @@ int main(int argc, char* args[])
                     std::tie(m1, m2) = spawnDebugCubes();
                     ground = spawnDebugGroundPlane();
                     if (m2 && m2->tr_)
-                        m2->tr_->updateModel(app.GetRenderer()->GetCurFrame(),
-                                             glm::translate(glm::mat4(1.0f),
-                                                            glm::vec3(1.2f, 0.0f, 0.0f)));
+                        m2->tr_->updateModel(glm::translate(
+                            glm::mat4(1.0f), glm::vec3(1.2f, 0.0f, 0.0f)));
                 }
 
             static auto startTime = std::chrono::high_resolution_clock::now();
@@ -173,11 +171,9 @@ int main(int argc, char* args[])
                             .count();
 
                     m1->tr_->updateModel(
-                        app.GetRenderer()->GetCurFrame(),
                         glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f),
                                     glm::vec3(0.0f, 1.0f, 0.0f)));
                     m2->tr_->updateModel(
-                        app.GetRenderer()->GetCurFrame(),
                         glm::translate(glm::mat4(1.0f),
                                        glm::vec3(1.2f, 0.0f, 0.0f)) *
                             glm::rotate(glm::mat4(1.0f),
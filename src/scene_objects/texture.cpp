@@ -14,6 +14,15 @@ BaseTexture::BaseTexture(const std::string& name, const std::string& path,
     imgs_ = images;
 }
 
+BaseTexture::BaseTexture(const std::string& name, const std::string& path,
+                         Texture_Types type, ImageSource source)
+{
+    SetName(name);
+    path_   = path;
+    type_   = type;
+    source_ = std::move(source);
+}
+
 bool BaseTexture::IsCreated()
 {
     return created_;
@@ -36,12 +45,23 @@ Texture_Types BaseTexture::GetType()
 
 std::vector<std::shared_ptr<Image>> BaseTexture::GetImages()
 {
+    std::lock_guard<std::mutex> lock(imagesMutex_);
+    if (imgs_.empty() && source_)
+        imgs_ = source_();
     return imgs_;
 }
 
 void BaseTexture::AddImage(std::shared_ptr<Image> img)
 {
+    std::lock_guard<std::mutex> lock(imagesMutex_);
     imgs_.emplace_back(std::move(img));
 }
 
+void BaseTexture::ReleaseImages()
+{
+    std::lock_guard<std::mutex> lock(imagesMutex_);
+    if (source_)
+        imgs_.clear();
+}
+
 } // namespace Multor
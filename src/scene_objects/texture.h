@@ -8,7 +8,9 @@
 #include "../utils/image.h"
 
 #include <vector>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 
 #include <glm/glm.hpp>
@@ -30,19 +32,30 @@ enum class Texture_Types : uint8_t
     Skybox             = 7
 };
 
+//Decodes the images of a texture, empty if they can not be loaded
+using ImageSource = std::function<std::vector<std::shared_ptr<Image> >()>;
+
 struct BaseTexture : public Entity
 {
     BaseTexture(const std::string& name, const std::string& path,
                 Texture_Types                        type,
                 std::vector<std::shared_ptr<Image> > images);
+    /// \brief Texture decoded by \p source on the first GetImages call
+    BaseTexture(const std::string& name, const std::string& path,
+                Texture_Types type, ImageSource source);
     virtual ~BaseTexture() {};
     //virtual bool createTexture();
     bool                                 IsCreated();
     unsigned int                         GetId();
     std::string                          GetPath();
     Texture_Types                        GetType();
+    /// \brief Decodes the images first if the texture has a source, safe
+    /// to call from any thread
     std::vector<std::shared_ptr<Image> > GetImages();
     void                                 AddImage(std::shared_ptr<Image> img);
+    /// \brief Drops decoded images, they are decoded again on the next
+    /// GetImages. Does nothing for textures without a source.
+    void                                 ReleaseImages();
 
 protected:
     bool                                 created_ {false};
@@ -50,6 +63,8 @@ protected:
     std::vector<std::shared_ptr<Image> > imgs_;
     Texture_Types                        type_;
     std::string                          path_;
+    ImageSource                          source_;
+    std::mutex                           imagesMutex_;
 
 private:
 };
@@ -0,0 +1,212 @@
+/// \file bc_encoder.cpp
+#include "bc_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace Multor
+{
+
+namespace
+{
+
+using Block = unsigned char[16][4];
+
+void fetchBlock(const unsigned char* rgba, uint32_t width, uint32_t height,
+                uint32_t bx, uint32_t by, Block& block)
+{
+    for (uint32_t y = 0; y < 4; ++y)
+        for (uint32_t x = 0; x < 4; ++x)
+            {
+                const uint32_t sx = std::min(bx * 4 + x, width - 1);
+                const uint32_t sy = std::min(by * 4 + y, height - 1);
+                std::memcpy(block[y * 4 + x],
+                            rgba + (std::size_t(sy) * width + sx) * 4, 4);
+            }
+}
+
+uint16_t to565(const unsigned char* c)
+{
+    return static_cast<uint16_t>(((c[0] * 31 + 127) / 255) << 11 |
+                                 ((c[1] * 63 + 127) / 255) << 5 |
+                                 ((c[2] * 31 + 127) / 255));
+}
+
+void from565(uint16_t c, int* out)
+{
+    const int r = (c >> 11) & 31;
+    const int g = (c >> 5) & 63;
+    const int b = c & 31;
+    out[0]      = (r << 3) | (r >> 2);
+    out[1]      = (g << 2) | (g >> 4);
+    out[2]      = (b << 3) | (b >> 2);
+}
+
+void encodeColor(const Block& block, unsigned char* out)
+{
+    float mean[3] = {};
+    for (const auto& px : block)
+        for (int c = 0; c < 3; ++c)
+            mean[c] += px[c] / 16.0f;
+
+    //Covariance rr, rg, rb, gg, gb, bb
+    float cov[6] = {};
+    for (const auto& px : block)
+        {
+            const float r = px[0] - mean[0];
+            const float g = px[1] - mean[1];
+            const float b = px[2] - mean[2];
+            cov[0] += r * r;
+            cov[1] += r * g;
+            cov[2] += r * b;
+            cov[3] += g * g;
+            cov[4] += g * b;
+            cov[5] += b * b;
+        }
+
+    //Power iteration converges to the principal axis in a few steps,
+    //seeded with the row of the channel varying most
+    float axis[3] = {cov[0], cov[1], cov[2]};
+    if (cov[3] > cov[0] && cov[3] >= cov[5])
+        axis[0] = cov[1], axis[1] = cov[3], axis[2] = cov[4];
+    else if (cov[5] > cov[0] && cov[5] > cov[3])
+        axis[0] = cov[2], axis[1] = cov[4], axis[2] = cov[5];
+    for (int i = 0; i < 4; ++i)
+        {
+            const float next[3] = {
+                cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+                cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+                cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]};
+            const float norm = std::max(
+                {std::abs(next[0]), std::abs(next[1]), std::abs(next[2])});
+            if (norm < 1e-6f)
+                break;
+            for (int c = 0; c < 3; ++c)
+                axis[c] = next[c] / norm;
+        }
+
+    int   lo = 0, hi = 0;
+    float loT = 0.0f, hiT = 0.0f;
+    for (int i = 0; i < 16; ++i)
+        {
+            const float t = (block[i][0] - mean[0]) * axis[0] +
+                            (block[i][1] - mean[1]) * axis[1] +
+                            (block[i][2] - mean[2]) * axis[2];
+            if (i == 0 || t < loT)
+                loT = t, lo = i;
+            if (i == 0 || t > hiT)
+                hiT = t, hi = i;
+        }
+
+    uint16_t c0 = to565(block[hi]);
+    uint16_t c1 = to565(block[lo]);
+    //c0 > c1 selects the four color mode
+    if (c0 < c1)
+        std::swap(c0, c1);
+    out[0] = static_cast<unsigned char>(c0);
+    out[1] = static_cast<unsigned char>(c0 >> 8);
+    out[2] = static_cast<unsigned char>(c1);
+    out[3] = static_cast<unsigned char>(c1 >> 8);
+
+    uint32_t indices = 0;
+    if (c0 != c1)
+        {
+            int palette[4][3];
+            from565(c0, palette[0]);
+            from565(c1, palette[1]);
+            for (int c = 0; c < 3; ++c)
+                {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+            for (int i = 0; i < 16; ++i)
+                {
+                    int best = 0, bestDist = 0;
+                    for (int p = 0; p < 4; ++p)
+                        {
+                            int dist = 0;
+                            for (int c = 0; c < 3; ++c)
+                                {
+                                    const int d = block[i][c] - palette[p][c];
+                                    dist += d * d;
+                                }
+                            if (p == 0 || dist < bestDist)
+                                best = p, bestDist = dist;
+                        }
+                    indices |= uint32_t(best) << (2 * i);
+                }
+        }
+    for (int i = 0; i < 4; ++i)
+        out[4 + i] = static_cast<unsigned char>(indices >> (8 * i));
+}
+
+void encodeChannel(const Block& block, int channel, unsigned char* out)
+{
+    int lo = 255, hi = 0;
+    for (const auto& px : block)
+        {
+            lo = std::min<int>(lo, px[channel]);
+            hi = std::max<int>(hi, px[channel]);
+        }
+    //hi > lo selects the eight value mode, equal endpoints need no indices
+    out[0] = static_cast<unsigned char>(hi);
+    out[1] = static_cast<unsigned char>(lo);
+
+    uint64_t bits = 0;
+    if (hi > lo)
+        for (int i = 0; i < 16; ++i)
+            {
+                //Step from hi towards lo, index 0 is hi, 1 is lo and
+                //2 to 7 the values in between
+                const int step =
+                    ((hi - block[i][channel]) * 7 + (hi - lo) / 2) / (hi - lo);
+                const int index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+                bits |= uint64_t(index) << (3 * i);
+            }
+    for (int i = 0; i < 6; ++i)
+        out[2 + i] = static_cast<unsigned char>(bits >> (8 * i));
+}
+
+} // namespace
+
+void EncodeBlocks(PixelFormat format, const unsigned char* rgba,
+                  uint32_t width, uint32_t height, unsigned char* out)
+{
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+    Block          block;
+    for (uint32_t by = 0; by < blocksY; ++by)
+        for (uint32_t bx = 0; bx < blocksX; ++bx)
+            {
+                fetchBlock(rgba, width, height, bx, by, block);
+                switch (format)
+                    {
+                    case PixelFormat::BC1:
+                        encodeColor(block, out);
+                        out += 8;
+                        break;
+                    case PixelFormat::BC3:
+                        encodeChannel(block, 3, out);
+                        encodeColor(block, out + 8);
+                        out += 16;
+                        break;
+                    case PixelFormat::BC4:
+                        encodeChannel(block, 0, out);
+                        out += 8;
+                        break;
+                    case PixelFormat::BC5:
+                        encodeChannel(block, 0, out);
+                        encodeChannel(block, 1, out + 8);
+                        out += 16;
+                        break;
+                    default:
+                        throw std::invalid_argument(
+                            "pixel format is not encoded by blocks!");
+                    }
+            }
+}
+
+} // namespace Multor
@@ -0,0 +1,29 @@
+/// \file bc_encoder.h
+/// \brief CPU encoder of BC1, BC3, BC4 and BC5 blocks
+
+#pragma once
+#ifndef BC_ENCODER_H
+#define BC_ENCODER_H
+
+#include "pixel_format.h"
+
+#include <cstdint>
+
+namespace Multor
+{
+
+/// \brief Compresses an RGBA8 level into 4x4 blocks of \p format.
+///
+/// Color endpoints are the extremes of the block colors along their
+/// principal axis, single channels use their minimum and maximum. This is
+/// a fast encoder for content without precompressed assets, not one
+/// that searches for the best endpoints. Blocks over the edge of the
+/// level repeat its last row and column.
+/// \param format BC1, BC3, BC4 (red) or BC5 (red and green)
+/// \param out Receives LevelSize(format, width, height) bytes
+void EncodeBlocks(PixelFormat format, const unsigned char* rgba,
+                  uint32_t width, uint32_t height, unsigned char* out);
+
+} // namespace Multor
+
+#endif // BC_ENCODER_H
@@ -0,0 +1,40 @@
+/// \file file_watcher.cpp
+#include "file_watcher.h"
+
+#include <system_error>
+
+namespace Multor
+{
+
+FileWatcher::FileWatcher(clock::duration interval)
+    : interval_(interval), nextCheck_(clock::now() + interval)
+{
+}
+
+void FileWatcher::Watch(const std::filesystem::path& path)
+{
+    std::error_code error;
+    files_.push_back({path, std::filesystem::last_write_time(path, error)});
+}
+
+bool FileWatcher::Poll()
+{
+    const clock::time_point now = clock::now();
+    if (now < nextCheck_)
+        return false;
+    nextCheck_ = now + interval_;
+
+    bool changed = false;
+    for (auto& file : files_)
+        {
+            std::error_code error;
+            const auto time = std::filesystem::last_write_time(file.path_, error);
+            if (error || time == file.time_)
+                continue;
+            file.time_ = time;
+            changed    = true;
+        }
+    return changed;
+}
+
+} // namespace Multor
@@ -0,0 +1,47 @@
+/// \file file_watcher.h
+/// \brief Detects modification of a set of files
+
+#pragma once
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <chrono>
+#include <filesystem>
+#include <vector>
+
+namespace Multor
+{
+
+/// \brief Polls the modification time of watched files.
+///
+/// Polling is throttled to one check per interval, so calling Poll every
+/// frame costs a clock read on most frames. A file that is missing or
+/// being replaced keeps its last known time, editors that save through a
+/// temporary file and rename are reported once the new file is in place.
+class FileWatcher
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit FileWatcher(
+        clock::duration interval = std::chrono::milliseconds(250));
+
+    void Watch(const std::filesystem::path& path);
+    /// \brief Whether any watched file changed since the previous call
+    bool Poll();
+
+private:
+    struct WatchedFile
+    {
+        std::filesystem::path           path_;
+        std::filesystem::file_time_type time_;
+    };
+
+    std::vector<WatchedFile> files_;
+    clock::duration          interval_;
+    clock::time_point        nextCheck_;
+};
+
+} // namespace Multor
+
+#endif // FILEWATCHER_H
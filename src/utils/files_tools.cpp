@@ -3,6 +3,19 @@
 #include "files_tools.h"
 
 #include <fstream>
+#include <system_error>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach-o/dyld.h>
+
+#include <cstdint>
+#include <vector>
+#endif
 
 namespace Multor
 {
@@ -34,4 +47,25 @@ std::string LoadTextFile(std::string_view path)
     return text;
 }
 
+std::filesystem::path GetExecutableDir()
+{
+    std::filesystem::path exe;
+#ifdef _WIN32
+    wchar_t     buffer[MAX_PATH];
+    const DWORD size = GetModuleFileNameW(nullptr, buffer, MAX_PATH);
+    if (size > 0 && size < MAX_PATH)
+        exe = std::filesystem::path(buffer, buffer + size);
+#elif defined(__APPLE__)
+    uint32_t size = 0;
+    _NSGetExecutablePath(nullptr, &size);
+    std::vector<char> buffer(size);
+    if (_NSGetExecutablePath(buffer.data(), &size) == 0)
+        exe = buffer.data();
+#else
+    std::error_code error;
+    exe = std::filesystem::read_symlink("/proc/self/exe", error);
+#endif
+    return exe.parent_path();
+}
+
 } // namespace Multor
\ No newline at end of file
@@ -5,6 +5,7 @@
 #ifndef FILESTOOLS_H
 #define FILESTOOLS_H
 
+#include <filesystem>
 #include <string_view>
 #include <string>
 
@@ -15,6 +16,10 @@ namespace Multor
 /// \param[in] path path to file
 std::string LoadTextFile(std::string_view path);
 
+/// \brief Directory of the running executable, independent of the
+/// working directory. Empty if it can not be determined.
+std::filesystem::path GetExecutableDir();
+
 } // namespace Multor
 
 #endif // FILESTOOLS_H
\ No newline at end of file
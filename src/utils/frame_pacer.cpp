@@ -0,0 +1,145 @@
+/// \file frame_pacer.cpp
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <cerrno>
+#include <ctime>
+#endif
+
+namespace Multor
+{
+
+FramePacer::FramePacer()
+{
+#ifdef _WIN32
+    //Plain waitable timers keep the default 15.6 ms resolution
+    timer_ = CreateWaitableTimerExW(nullptr, nullptr,
+                                    CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                    TIMER_ALL_ACCESS);
+#endif
+    lastFrame_ = deadline_ = clock::now();
+}
+
+FramePacer::~FramePacer()
+{
+#ifdef _WIN32
+    if (timer_)
+        CloseHandle(static_cast<HANDLE>(timer_));
+#endif
+}
+
+void FramePacer::SetTargetFps(int fps)
+{
+    fps_      = std::max(fps, 0);
+    period_   = fps_ > 0 ? std::chrono::duration_cast<clock::duration>(
+                               std::chrono::duration<double>(1.0 / fps_))
+                         : clock::duration::zero();
+    deadline_ = clock::now() + period_;
+}
+
+void FramePacer::Wait()
+{
+    if (fps_ > 0)
+        {
+            const clock::time_point now = clock::now();
+            if (now > deadline_)
+                {
+                    ++missed_;
+                    //Behind by a whole frame, start over instead of
+                    //presenting a burst of short frames
+                    if (now - deadline_ > period_)
+                        deadline_ = now;
+                }
+            else
+                sleepUntil(deadline_);
+            deadline_ += period_;
+        }
+
+    const clock::time_point frameEnd = clock::now();
+    const double            interval =
+        std::chrono::duration<double, std::milli>(frameEnd - lastFrame_).count();
+    lastFrame_ = frameEnd;
+
+    ++frames_;
+    const double delta = interval - mean_;
+    mean_ += delta / static_cast<double>(frames_);
+    m2_ += delta * (interval - mean_);
+    max_ = std::max(max_, interval);
+}
+
+FramePacingStats FramePacer::GetStats() const
+{
+    FramePacingStats stats;
+    stats.frames_ = frames_;
+    stats.missed_ = missed_;
+    stats.meanMs_ = mean_;
+    stats.stdDevMs_ =
+        frames_ > 1 ? std::sqrt(m2_ / static_cast<double>(frames_ - 1)) : 0.0;
+    stats.maxMs_ = max_;
+    return stats;
+}
+
+void FramePacer::ResetStats()
+{
+    frames_ = 0;
+    missed_ = 0;
+    mean_   = 0.0;
+    m2_     = 0.0;
+    max_    = 0.0;
+}
+
+void FramePacer::sleepUntil(clock::time_point deadline)
+{
+    const clock::time_point wake = deadline - spinTail_;
+    const clock::time_point now  = clock::now();
+    if (wake > now)
+        {
+#ifdef _WIN32
+            if (timer_)
+                {
+                    //Relative due time in 100 ns units
+                    LARGE_INTEGER due;
+                    due.QuadPart = -static_cast<LONGLONG>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            wake - now)
+                            .count() /
+                        100);
+                    if (SetWaitableTimerEx(static_cast<HANDLE>(timer_), &due, 0,
+                                           nullptr, nullptr, nullptr, 0))
+                        WaitForSingleObject(static_cast<HANDLE>(timer_), INFINITE);
+                }
+            else
+                std::this_thread::sleep_until(wake);
+#else
+            //steady_clock is CLOCK_MONOTONIC, an absolute wait does not
+            //drift when interrupted
+            const auto since =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    wake.time_since_epoch())
+                    .count();
+            timespec ts;
+            ts.tv_sec  = static_cast<time_t>(since / 1000000000);
+            ts.tv_nsec = static_cast<long>(since % 1000000000);
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+                                   nullptr) == EINTR)
+                ;
+#endif
+        }
+
+    while (clock::now() < deadline)
+        std::this_thread::yield();
+}
+
+} // namespace Multor
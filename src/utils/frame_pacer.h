@@ -0,0 +1,79 @@
+/// \file frame_pacer.h
+/// \brief Frame rate limiter targeting absolute frame deadlines
+
+#pragma once
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace Multor
+{
+
+/// \brief Statistics of the intervals between paced frames
+struct FramePacingStats
+{
+    std::uint64_t frames_   = 0;
+    //Frames whose work ended after their deadline
+    std::uint64_t missed_   = 0;
+    double        meanMs_   = 0.0;
+    double        stdDevMs_ = 0.0;
+    double        maxMs_    = 0.0;
+};
+
+/// \brief Paces frames to a fixed rate.
+///
+/// Deadlines advance by exactly one period, so an early or late frame
+/// does not shift the ones after it. The thread sleeps on a high
+/// resolution timer until shortly before the deadline and spins the
+/// rest, which a plain sleep would overshoot by up to a scheduler tick.
+/// A frame later than a whole period restarts the schedule from now
+/// instead of rushing to catch up.
+class FramePacer
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    FramePacer();
+    ~FramePacer();
+
+    FramePacer(const FramePacer&)            = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    /// \brief Sets the paced rate, 0 only measures the frame intervals
+    void SetTargetFps(int fps);
+    int  GetTargetFps() const { return fps_; }
+
+    /// \brief Ends the current frame, waits for its deadline if paced
+    void Wait();
+
+    FramePacingStats GetStats() const;
+    void             ResetStats();
+
+private:
+    void sleepUntil(clock::time_point deadline);
+
+private:
+    //Left to spinning, covers the timer wake up latency
+    static constexpr std::chrono::microseconds spinTail_ {1500};
+
+    int               fps_ = 0;
+    clock::duration   period_ {};
+    clock::time_point deadline_ {};
+    clock::time_point lastFrame_ {};
+
+    //Welford's running mean and variance of frame intervals in ms
+    std::uint64_t frames_ = 0;
+    std::uint64_t missed_ = 0;
+    double        mean_   = 0.0;
+    double        m2_     = 0.0;
+    double        max_    = 0.0;
+
+    //Waitable timer on Windows
+    void* timer_ = nullptr;
+};
+
+} // namespace Multor
+
+#endif // FRAMEPACER_H
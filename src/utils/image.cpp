@@ -8,7 +8,9 @@ namespace Multor
     Image::Image(Image&& img) noexcept : 
                                   w_(img.w_),
                                   h_(img.h_),
-                                  nrComponents_(img.nrComponents_)
+                                  nrComponents_(img.nrComponents_),
+                                  format_(img.format_),
+                                  levels_(std::move(img.levels_))
     {
         std::swap(mdata_, img.mdata_);
         std::swap(deleter_, img.deleter_);
@@ -19,6 +21,8 @@ namespace Multor
         w_            = img.w_;
         h_            = img.h_;
         nrComponents_ = img.nrComponents_;
+        format_       = img.format_;
+        levels_       = std::move(img.levels_);
         std::swap(mdata_, img.mdata_);
         std::swap(deleter_, img.deleter_);
 
@@ -5,6 +5,8 @@
 #ifndef IMAGE_H
 #define IMAGE_H
 
+#include "mip_chain.h"
+#include "pixel_format.h"
 #include "stb_image.h"
 
 #include <cstdint>
@@ -39,6 +41,10 @@ struct Image
 
     unsigned char* mdata_;
     int            w_, h_, nrComponents_;
+    //Layout of mdata_, anything but RGBA8 comes from a texture container
+    PixelFormat           format_ = PixelFormat::RGBA8;
+    //Mip levels packed in mdata_, empty for a single RGBA8 level
+    std::vector<MipLevel> levels_;
 
 private:
     PDelFun deleter_;
@@ -2,24 +2,315 @@
 
 #include "image_loader.h"
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string_view>
+
 namespace Multor
 {
 
+namespace
+{
+
+constexpr uint32_t ddsMagic = 0x20534444; //"DDS "
+
+constexpr unsigned char ktx2Identifier[12] = {0xAB, 'K',  'T',  'X',
+                                              ' ',  '2',  '0',  0xBB,
+                                              '\r', '\n', 0x1A, '\n'};
+
+bool isContainer(const unsigned char* data, std::size_t size)
+{
+    uint32_t magic = 0;
+    if (size >= sizeof(magic))
+        std::memcpy(&magic, data, sizeof(magic));
+    return magic == ddsMagic ||
+           (size >= sizeof(ktx2Identifier) &&
+            std::memcmp(data, ktx2Identifier, sizeof(ktx2Identifier)) == 0);
+}
+
+template<typename T>
+T read(const unsigned char* data, std::size_t offset)
+{
+    T value;
+    std::memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+constexpr uint32_t fourCC(const char (&code)[5])
+{
+    return uint32_t(uint8_t(code[0])) | uint32_t(uint8_t(code[1])) << 8 |
+           uint32_t(uint8_t(code[2])) << 16 | uint32_t(uint8_t(code[3])) << 24;
+}
+
+std::optional<PixelFormat> fromDxgi(uint32_t dxgi)
+{
+    switch (dxgi)
+        {
+        case 28: //R8G8B8A8_UNORM(_SRGB)
+        case 29:
+            return PixelFormat::RGBA8;
+        case 49: //R8G8_UNORM
+            return PixelFormat::RG8;
+        case 61: //R8_UNORM
+            return PixelFormat::R8;
+        case 71: //BC1_UNORM(_SRGB)
+        case 72:
+            return PixelFormat::BC1;
+        case 77: //BC3_UNORM(_SRGB)
+        case 78:
+            return PixelFormat::BC3;
+        case 80: //BC4_UNORM
+            return PixelFormat::BC4;
+        case 83: //BC5_UNORM
+            return PixelFormat::BC5;
+        case 98: //BC7_UNORM(_SRGB)
+        case 99:
+            return PixelFormat::BC7;
+        default:
+            return std::nullopt;
+        }
+}
+
+std::optional<PixelFormat> fromVkFormat(uint32_t format)
+{
+    switch (format)
+        {
+        case 37: //VK_FORMAT_R8G8B8A8_UNORM, _SRGB
+        case 43:
+            return PixelFormat::RGBA8;
+        case 16: //VK_FORMAT_R8G8_UNORM
+            return PixelFormat::RG8;
+        case 9: //VK_FORMAT_R8_UNORM
+            return PixelFormat::R8;
+        case 131: //VK_FORMAT_BC1_RGB(A)_UNORM_BLOCK, _SRGB_BLOCK
+        case 132:
+        case 133:
+        case 134:
+            return PixelFormat::BC1;
+        case 137: //VK_FORMAT_BC3_UNORM_BLOCK, _SRGB_BLOCK
+        case 138:
+            return PixelFormat::BC3;
+        case 139: //VK_FORMAT_BC4_UNORM_BLOCK
+            return PixelFormat::BC4;
+        case 141: //VK_FORMAT_BC5_UNORM_BLOCK
+            return PixelFormat::BC5;
+        case 145: //VK_FORMAT_BC7_UNORM_BLOCK, _SRGB_BLOCK
+        case 146:
+            return PixelFormat::BC7;
+        default:
+            return std::nullopt;
+        }
+}
+
+/// \brief Copies levels of a container into one buffer owned by an Image.
+/// Levels start at 16 byte offsets, a multiple of every texel block size.
+std::shared_ptr<Image>
+packLevels(PixelFormat format, uint32_t width, uint32_t height,
+           const std::vector<const unsigned char*>& sources)
+{
+    std::vector<MipLevel> levels;
+    std::size_t           total = 0;
+    for (std::size_t i = 0; i < sources.size(); ++i)
+        {
+            MipLevel level;
+            level.width_  = std::max(width >> i, 1u);
+            level.height_ = std::max(height >> i, 1u);
+            level.offset_ = total;
+            total = (total + LevelSize(format, level.width_, level.height_) +
+                     15) &
+                    ~std::size_t(15);
+            levels.push_back(level);
+        }
+
+    auto* data = new unsigned char[total];
+    for (std::size_t i = 0; i < sources.size(); ++i)
+        std::memcpy(data + levels[i].offset_, sources[i],
+                    LevelSize(format, levels[i].width_, levels[i].height_));
+
+    auto image = std::make_shared<Image>(
+        width, height, ChannelCount(format), data,
+        [](void* ptr) { delete[] static_cast<unsigned char*>(ptr); });
+    image->format_ = format;
+    image->levels_ = std::move(levels);
+    return image;
+}
+
+//Pointers to \p count levels stored back to back from \p offset
+std::vector<const unsigned char*>
+consecutiveLevels(const unsigned char* data, std::size_t size,
+                  std::size_t offset, PixelFormat format, uint32_t width,
+                  uint32_t height, uint32_t count)
+{
+    std::vector<const unsigned char*> sources;
+    for (uint32_t i = 0; i < count; ++i)
+        {
+            const std::size_t levelSize =
+                LevelSize(format, std::max(width >> i, 1u),
+                          std::max(height >> i, 1u));
+            if (offset > size || size - offset < levelSize)
+                return {};
+            sources.push_back(data + offset);
+            offset += levelSize;
+        }
+    return sources;
+}
+
+} // namespace
+
 std::shared_ptr<Image> ImageLoader::LoadTexture(const char* path)
 {
-    return std::make_shared<Image>(
-        w_, h_, chs_, stbi_load(path, &w_, &h_, &chs_, STBI_rgb_alpha),
-        STB_deleter);
+    std::string_view extension(path);
+    extension = extension.substr(std::min(extension.rfind('.'), extension.size()));
+    if (extension == ".dds" || extension == ".DDS" || extension == ".ktx2" ||
+        extension == ".KTX2")
+        {
+            std::ifstream file(path, std::ios::binary);
+            const std::vector<unsigned char> data(
+                (std::istreambuf_iterator<char>(file)),
+                std::istreambuf_iterator<char>());
+            return loadContainer(data.data(), data.size());
+        }
+
+    //Locals, textures stream in on several threads at once
+    int            w = 0, h = 0, chs = 0;
+    unsigned char* pixels = stbi_load(path, &w, &h, &chs, STBI_rgb_alpha);
+    if (!pixels)
+        return nullptr;
+    return std::make_shared<Image>(w, h, chs, pixels, STB_deleter);
 }
 
 std::shared_ptr<Image> ImageLoader::LoadTexture(const void* memoryPtr,
                                                 int         bytes)
 {
-    return std::make_shared<Image>(
-        w_, h_, chs_,
-        stbi_load_from_memory(static_cast<const stbi_uc*>(memoryPtr), bytes,
-                              &w_, &h_, &chs_, STBI_rgb_alpha),
-        STB_deleter);
+    const auto* data = static_cast<const stbi_uc*>(memoryPtr);
+    if (bytes > 0 && isContainer(data, static_cast<std::size_t>(bytes)))
+        return loadContainer(data, static_cast<std::size_t>(bytes));
+
+    int            w = 0, h = 0, chs = 0;
+    unsigned char* pixels =
+        stbi_load_from_memory(data, bytes, &w, &h, &chs, STBI_rgb_alpha);
+    if (!pixels)
+        return nullptr;
+    return std::make_shared<Image>(w, h, chs, pixels, STB_deleter);
+}
+
+std::shared_ptr<Image> ImageLoader::loadContainer(const unsigned char* data,
+                                                  std::size_t          size)
+{
+    if (size >= 4 && read<uint32_t>(data, 0) == ddsMagic)
+        return loadDds(data, size);
+    if (size >= sizeof(ktx2Identifier) &&
+        std::memcmp(data, ktx2Identifier, sizeof(ktx2Identifier)) == 0)
+        return loadKtx2(data, size);
+    return nullptr;
+}
+
+std::shared_ptr<Image> ImageLoader::loadDds(const unsigned char* data,
+                                            std::size_t          size)
+{
+    //Magic, 124 byte header, optional 20 byte DX10 header
+    constexpr std::size_t header = 4;
+    if (size < header + 124 || read<uint32_t>(data, header) != 124)
+        return nullptr;
+
+    const uint32_t flags  = read<uint32_t>(data, header + 4);
+    const uint32_t height = read<uint32_t>(data, header + 8);
+    const uint32_t width  = read<uint32_t>(data, header + 12);
+    const uint32_t mips =
+        (flags & 0x20000) ? std::max(read<uint32_t>(data, header + 24), 1u) : 1u;
+    const uint32_t pfFlags  = read<uint32_t>(data, header + 76);
+    const uint32_t pfFourCC = read<uint32_t>(data, header + 80);
+    const uint32_t bitCount = read<uint32_t>(data, header + 84);
+    const uint32_t rMask    = read<uint32_t>(data, header + 88);
+    const uint32_t caps2    = read<uint32_t>(data, header + 108);
+
+    //Cubemaps and volumes
+    if (width == 0 || height == 0 || (caps2 & (0x200 | 0x200000)))
+        return nullptr;
+
+    std::optional<PixelFormat> format;
+    std::size_t                offset = header + 124;
+    if ((pfFlags & 0x4) && pfFourCC == fourCC("DX10"))
+        {
+            if (size < offset + 20)
+                return nullptr;
+            const uint32_t dimension = read<uint32_t>(data, offset + 4);
+            const uint32_t arraySize = read<uint32_t>(data, offset + 12);
+            if (dimension != 3 || arraySize > 1) //TEXTURE2D
+                return nullptr;
+            format = fromDxgi(read<uint32_t>(data, offset));
+            offset += 20;
+        }
+    else if (pfFlags & 0x4)
+        {
+            if (pfFourCC == fourCC("DXT1"))
+                format = PixelFormat::BC1;
+            else if (pfFourCC == fourCC("DXT5"))
+                format = PixelFormat::BC3;
+            else if (pfFourCC == fourCC("ATI1") || pfFourCC == fourCC("BC4U"))
+                format = PixelFormat::BC4;
+            else if (pfFourCC == fourCC("ATI2") || pfFourCC == fourCC("BC5U"))
+                format = PixelFormat::BC5;
+        }
+    //RGB with alpha, masks of RGBA byte order
+    else if ((pfFlags & 0x41) == 0x41 && bitCount == 32 && rMask == 0xFF)
+        format = PixelFormat::RGBA8;
+    //Luminance
+    else if ((pfFlags & 0x20000) && bitCount == 8)
+        format = PixelFormat::R8;
+
+    if (!format)
+        return nullptr;
+
+    const auto sources = consecutiveLevels(
+        data, size, offset, *format, width, height,
+        std::min(mips, MipLevelCount(width, height)));
+    if (sources.empty())
+        return nullptr;
+    return packLevels(*format, width, height, sources);
+}
+
+std::shared_ptr<Image> ImageLoader::loadKtx2(const unsigned char* data,
+                                             std::size_t          size)
+{
+    //Identifier, header and level index start
+    constexpr std::size_t levelIndex = 80;
+    if (size < levelIndex)
+        return nullptr;
+
+    const uint32_t vkFormat         = read<uint32_t>(data, 12);
+    const uint32_t width            = read<uint32_t>(data, 20);
+    const uint32_t height           = read<uint32_t>(data, 24);
+    const uint32_t depth            = read<uint32_t>(data, 28);
+    const uint32_t layers           = read<uint32_t>(data, 32);
+    const uint32_t faces            = read<uint32_t>(data, 36);
+    const uint32_t levelCount       = std::max(read<uint32_t>(data, 40), 1u);
+    const uint32_t supercompression = read<uint32_t>(data, 44);
+
+    const auto format = fromVkFormat(vkFormat);
+    if (!format || width == 0 || height == 0 || depth > 1 || layers > 1 ||
+        faces != 1 || supercompression != 0 ||
+        levelCount > MipLevelCount(width, height) ||
+        size < levelIndex + std::size_t(levelCount) * 24)
+        return nullptr;
+
+    //Each level has its own offset, level 0 first in the index
+    std::vector<const unsigned char*> sources;
+    for (uint32_t i = 0; i < levelCount; ++i)
+        {
+            const uint64_t offset = read<uint64_t>(data, levelIndex + i * 24);
+            const uint64_t length = read<uint64_t>(data, levelIndex + i * 24 + 8);
+            const std::size_t levelSize =
+                LevelSize(*format, std::max(width >> i, 1u),
+                          std::max(height >> i, 1u));
+            if (length < levelSize || offset > size || size - offset < levelSize)
+                return nullptr;
+            sources.push_back(data + offset);
+        }
+    return packLevels(*format, width, height, sources);
 }
 
 } // namespace Multor
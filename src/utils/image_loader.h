@@ -14,13 +14,24 @@ namespace Multor
 
 using PDelFun = void (*)(void*);
 
+/// \brief Loads images through stb_image as RGBA8, DDS and KTX2 containers
+/// keep their format and mip levels. Returns nullptr if the image can not
+/// be loaded.
 struct ImageLoader
 {
     static std::shared_ptr<Image> LoadTexture(const char* path);
     static std::shared_ptr<Image> LoadTexture(const void* memoryPtr, int width);
 
 private:
-    static inline int     w_, h_, chs_;
+    //2D textures with one layer and face, uncompressed or BC formats
+    static std::shared_ptr<Image> loadContainer(const unsigned char* data,
+                                                std::size_t          size);
+    static std::shared_ptr<Image> loadDds(const unsigned char* data,
+                                          std::size_t          size);
+    static std::shared_ptr<Image> loadKtx2(const unsigned char* data,
+                                           std::size_t          size);
+
+private:
     static inline PDelFun STB_deleter = [](void* ptr) { stbi_image_free(ptr); };
 };
 
@@ -0,0 +1,122 @@
+/// \file mip_chain.cpp
+#include "mip_chain.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+namespace Multor
+{
+
+namespace
+{
+
+//Precision of the linear to sRGB table, finer than the 8 bit output
+constexpr int linearSteps = 4096;
+
+struct SrgbTables
+{
+    std::array<float, 256>                 toLinear_;
+    std::array<unsigned char, linearSteps> toSrgb_;
+
+    SrgbTables()
+    {
+        for (int i = 0; i < 256; ++i)
+            {
+                const float c = i / 255.0f;
+                toLinear_[i]  = c <= 0.04045f
+                                    ? c / 12.92f
+                                    : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+        for (int i = 0; i < linearSteps; ++i)
+            {
+                const float l = i / float(linearSteps - 1);
+                const float c = l <= 0.0031308f
+                                    ? l * 12.92f
+                                    : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                toSrgb_[i] = static_cast<unsigned char>(c * 255.0f + 0.5f);
+            }
+    }
+};
+
+const SrgbTables& srgbTables()
+{
+    static const SrgbTables tables;
+    return tables;
+}
+
+//Rows of the source pair are read once, edge texels repeat for odd sizes
+void downsample(const unsigned char* src, uint32_t srcWidth,
+                uint32_t srcHeight, unsigned char* dst, uint32_t width,
+                uint32_t height, bool srgb)
+{
+    const SrgbTables& tables = srgbTables();
+    for (uint32_t y = 0; y < height; ++y)
+        {
+            const unsigned char* row0 = src + std::size_t(2 * y) * srcWidth * 4;
+            const unsigned char* row1 =
+                src + std::size_t(std::min(2 * y + 1, srcHeight - 1)) *
+                          srcWidth * 4;
+            unsigned char* out = dst + std::size_t(y) * width * 4;
+            for (uint32_t x = 0; x < width; ++x)
+                {
+                    const uint32_t x0 = 2 * x * 4;
+                    const uint32_t x1 = std::min(2 * x + 1, srcWidth - 1) * 4;
+                    for (uint32_t c = 0; c < 4; ++c)
+                        {
+                            if (srgb && c < 3)
+                                {
+                                    const float sum =
+                                        tables.toLinear_[row0[x0 + c]] +
+                                        tables.toLinear_[row0[x1 + c]] +
+                                        tables.toLinear_[row1[x0 + c]] +
+                                        tables.toLinear_[row1[x1 + c]];
+                                    out[c] = tables.toSrgb_[static_cast<int>(
+                                        sum * 0.25f * (linearSteps - 1) + 0.5f)];
+                                }
+                            else
+                                out[c] = static_cast<unsigned char>(
+                                    (row0[x0 + c] + row0[x1 + c] +
+                                     row1[x0 + c] + row1[x1 + c] + 2) >>
+                                    2);
+                        }
+                    out += 4;
+                }
+        }
+}
+
+} // namespace
+
+uint32_t MipLevelCount(uint32_t width, uint32_t height)
+{
+    return static_cast<uint32_t>(std::bit_width(std::max({width, height, 1u})));
+}
+
+std::vector<unsigned char> BuildMipChain(const unsigned char* data,
+                                         uint32_t width, uint32_t height,
+                                         bool srgb,
+                                         std::vector<MipLevel>& levels)
+{
+    levels.clear();
+    std::size_t size = 0;
+    for (uint32_t w = width, h = height;; w = std::max(w / 2, 1u),
+                  h                     = std::max(h / 2, 1u))
+        {
+            levels.push_back({w, h, size});
+            size += std::size_t(w) * h * 4;
+            if (w == 1 && h == 1)
+                break;
+        }
+
+    std::vector<unsigned char> chain(size);
+    std::memcpy(chain.data(), data, std::size_t(width) * height * 4);
+    for (std::size_t i = 1; i < levels.size(); ++i)
+        downsample(chain.data() + levels[i - 1].offset_, levels[i - 1].width_,
+                   levels[i - 1].height_, chain.data() + levels[i].offset_,
+                   levels[i].width_, levels[i].height_, srgb);
+    return chain;
+}
+
+} // namespace Multor
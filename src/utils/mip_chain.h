@@ -0,0 +1,40 @@
+/// \file mip_chain.h
+/// \brief Mip chain generation for RGBA8 images
+
+#pragma once
+#ifndef MIP_CHAIN_H
+#define MIP_CHAIN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Multor
+{
+
+/// \brief Level of a mip chain packed into one buffer
+struct MipLevel
+{
+    uint32_t    width_  = 0;
+    uint32_t    height_ = 0;
+    std::size_t offset_ = 0;
+};
+
+/// \brief Levels of a full chain of a \p width x \p height image, down to 1x1
+uint32_t MipLevelCount(uint32_t width, uint32_t height);
+
+/// \brief Builds the full mip chain of an RGBA8 image with a 2x2 box filter.
+///
+/// Each level is filtered from the previous one. Color of \p srgb data is
+/// averaged in linear space, as the GPU does when blitting sRGB images,
+/// alpha is always linear.
+/// \param levels Receives size and offset of every level, level 0 first
+/// \return All levels packed, starting with a copy of \p data
+std::vector<unsigned char> BuildMipChain(const unsigned char* data,
+                                         uint32_t width, uint32_t height,
+                                         bool srgb,
+                                         std::vector<MipLevel>& levels);
+
+} // namespace Multor
+
+#endif // MIP_CHAIN_H
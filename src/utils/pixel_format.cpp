@@ -0,0 +1,96 @@
+/// \file pixel_format.cpp
+#include "pixel_format.h"
+#include "bc_encoder.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace Multor
+{
+
+bool IsBlockCompressed(PixelFormat format)
+{
+    switch (format)
+        {
+        case PixelFormat::BC1:
+        case PixelFormat::BC3:
+        case PixelFormat::BC4:
+        case PixelFormat::BC5:
+        case PixelFormat::BC7:
+            return true;
+        default:
+            return false;
+        }
+}
+
+uint8_t ChannelCount(PixelFormat format)
+{
+    switch (format)
+        {
+        case PixelFormat::R8:
+        case PixelFormat::BC4:
+            return 1;
+        case PixelFormat::RG8:
+        case PixelFormat::BC5:
+            return 2;
+        default:
+            return 4;
+        }
+}
+
+std::size_t LevelSize(PixelFormat format, uint32_t width, uint32_t height)
+{
+    const std::size_t blocks =
+        std::size_t((width + 3) / 4) * std::size_t((height + 3) / 4);
+    switch (format)
+        {
+        case PixelFormat::RGBA8:
+            return std::size_t(width) * height * 4;
+        case PixelFormat::RG8:
+            return std::size_t(width) * height * 2;
+        case PixelFormat::R8:
+            return std::size_t(width) * height;
+        case PixelFormat::BC1:
+        case PixelFormat::BC4:
+            return blocks * 8;
+        case PixelFormat::BC3:
+        case PixelFormat::BC5:
+        case PixelFormat::BC7:
+            return blocks * 16;
+        }
+    throw std::invalid_argument("unknown pixel format!");
+}
+
+void EncodeLevel(PixelFormat format, const unsigned char* rgba, uint32_t width,
+                 uint32_t height, unsigned char* out)
+{
+    const std::size_t texels = std::size_t(width) * height;
+    switch (format)
+        {
+        case PixelFormat::RGBA8:
+            std::memcpy(out, rgba, texels * 4);
+            return;
+        case PixelFormat::RG8:
+            for (std::size_t i = 0; i < texels; ++i)
+                {
+                    out[i * 2]     = rgba[i * 4];
+                    out[i * 2 + 1] = rgba[i * 4 + 1];
+                }
+            return;
+        case PixelFormat::R8:
+            for (std::size_t i = 0; i < texels; ++i)
+                out[i] = rgba[i * 4];
+            return;
+        case PixelFormat::BC1:
+        case PixelFormat::BC3:
+        case PixelFormat::BC4:
+        case PixelFormat::BC5:
+            EncodeBlocks(format, rgba, width, height, out);
+            return;
+        case PixelFormat::BC7:
+            break;
+        }
+    throw std::invalid_argument("pixel format can not be encoded!");
+}
+
+} // namespace Multor
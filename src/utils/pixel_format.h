@@ -0,0 +1,42 @@
+/// \file pixel_format.h
+/// \brief Texel layouts of image data
+
+#pragma once
+#ifndef PIXEL_FORMAT_H
+#define PIXEL_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Multor
+{
+
+/// \brief Layout of image data. Whether color is sRGB encoded is decided
+/// by the type of the texture using it, not by the data.
+enum class PixelFormat : uint8_t
+{
+    RGBA8 = 0,
+    RG8   = 1,
+    R8    = 2,
+    //4x4 texel blocks, BC1 and BC4 take 8 bytes per block, the others 16
+    BC1   = 3,
+    BC3   = 4,
+    BC4   = 5,
+    BC5   = 6,
+    BC7   = 7
+};
+
+bool        IsBlockCompressed(PixelFormat format);
+uint8_t     ChannelCount(PixelFormat format);
+/// \brief Bytes of a tightly packed \p width x \p height level
+std::size_t LevelSize(PixelFormat format, uint32_t width, uint32_t height);
+
+/// \brief Converts an RGBA8 level to \p format. RG8 and BC5 keep red and
+/// green, R8 and BC4 red. BC7 can not be encoded.
+/// \param out Receives LevelSize(format, width, height) bytes
+void EncodeLevel(PixelFormat format, const unsigned char* rgba, uint32_t width,
+                 uint32_t height, unsigned char* out);
+
+} // namespace Multor
+
+#endif // PIXEL_FORMAT_H
@@ -2,24 +2,34 @@
 
 #include "buffer_factory.h"
 
-#include "objects/vertex.h"
+#include <algorithm>
+#include <cstring>
 
 namespace Multor::Vulkan
 {
 
-uint32_t BufferFactory::findMemoryType(uint32_t              typeFilter,
-                                         VkMemoryPropertyFlags properties)
+void BufferFactory::SetUploadService(std::shared_ptr<UploadService> uploads,
+                                     uint32_t graphicsFamily)
 {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(physDev_, &memProperties);
+    uploads_ = std::move(uploads);
+    sharedFamilies_.clear();
+    if (uploads_ && uploads_->GetQueueFamily() != graphicsFamily)
+        sharedFamilies_ = {graphicsFamily, uploads_->GetQueueFamily()};
+}
 
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
-        if ((typeFilter & (1 << i)) &&
-            (memProperties.memoryTypes[i].propertyFlags & properties) ==
-                properties)
-            return i;
+uint64_t BufferFactory::uploadBuffer(VkBuffer dst, const void* data,
+                                     VkDeviceSize size, VkDeviceSize dstOffset)
+{
+    if (uploads_)
+        return lastUpload_ = uploads_->UploadBuffer(dst, data, size, dstOffset);
 
-    throw std::runtime_error("failed to find suitable memory type!");
+    std::unique_ptr<Buffer> stBuf =
+        CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    std::memcpy(stBuf->allocation_.mapped_, data, size);
+    executer_->CopyBuffer(stBuf->buffer_, dst, size, dstOffset);
+    return 0;
 }
 
 std::unique_ptr<Buffer>
@@ -33,77 +43,28 @@ BufferFactory::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
     bufferInfo.size        = size;
     bufferInfo.usage       = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    //Written by the transfer queue, read by the graphics queue
+    if ((usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) && !sharedFamilies_.empty())
+        {
+            bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            bufferInfo.queueFamilyIndexCount =
+                static_cast<uint32_t>(sharedFamilies_.size());
+            bufferInfo.pQueueFamilyIndices = sharedFamilies_.data();
+        }
 
     if (vkCreateBuffer(dev_, &bufferInfo, nullptr, &buf->buffer_) != VK_SUCCESS)
         throw std::runtime_error("failed to create vertex buffer!");
 
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(dev_, buf->buffer_, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo {};
-    allocInfo.sType          = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex =
-        findMemoryType(memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(dev_, &allocInfo, nullptr, &buf->bufferMemory_) !=
-        VK_SUCCESS)
-        throw std::runtime_error("failed to allocate vertex buffer memory!");
-
-    vkBindBufferMemory(dev_, buf->buffer_, buf->bufferMemory_, 0);
-
     buf->dev_ = dev_;
-    return buf;
-}
-
-std::unique_ptr<VertexBuffer>
-BufferFactory::CreateVertexBuffer(Vertexes* vert)
-{
-    VkDeviceSize bufferSize = sizeof(Vertex) * vert->GetSize();
-
-    std::unique_ptr<Buffer> stBuf =
-        CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    void* data;
-    vkMapMemory(dev_, stBuf->bufferMemory_, 0, bufferSize, 0, &data);
-    std::memcpy(data, vert->GetVertexes(), bufferSize);
-    vkUnmapMemory(dev_, stBuf->bufferMemory_);
-
-    std::unique_ptr<Buffer> vertBuf = CreateBuffer(
-        bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    executer_->CopyBuffer(stBuf->buffer_, vertBuf->buffer_, bufferSize);
 
-    return std::unique_ptr<VertexBuffer>(
-        new VertexBuffer({std::move(vertBuf), Vertex::getBindingDescription(),
-                          Vertex::getAttributeDescriptions()}));
-}
-
-std::unique_ptr<Buffer> BufferFactory::CreateIndexBuffer(Vertexes* vert)
-{
-    VkDeviceSize bufferSize = sizeof(uint32_t) * vert->GetIndices().size();
-
-    std::unique_ptr<Buffer> stBuf =
-        CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    void* data;
-    vkMapMemory(dev_, stBuf->bufferMemory_, 0, bufferSize, 0, &data);
-    std::memcpy(data, vert->GetIndices().data(), bufferSize);
-    vkUnmapMemory(dev_, stBuf->bufferMemory_);
-
-    std::unique_ptr<Buffer> IndexBuf = CreateBuffer(
-        bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    executer_->CopyBuffer(stBuf->buffer_, IndexBuf->buffer_, bufferSize);
-
-    return IndexBuf;
+    //Staging buffers die right after their copy, a bump allocator fits them
+    const AllocationStrategy strategy =
+        usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT ? AllocationStrategy::Linear
+                                                  : AllocationStrategy::Buddy;
+    buf->allocation_ = allocator_->AllocateBuffer(buf->buffer_, properties,
+                                                  strategy);
+    buf->allocator_  = allocator_;
+    return buf;
 }
 
 std::unique_ptr<Buffer>
@@ -114,26 +75,40 @@ BufferFactory::CreateUniformBuffer(VkDeviceSize bufferSize)
                             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 }
 
+std::unique_ptr<UniformRing>
+BufferFactory::CreateUniformRing(uint32_t segments, VkDeviceSize segmentSize)
+{
+    VkPhysicalDeviceProperties properties {};
+    vkGetPhysicalDeviceProperties(physDev_, &properties);
+    //Ranges are bound as uniform and as storage buffers
+    const VkDeviceSize alignment = std::max<VkDeviceSize>(
+        {properties.limits.minUniformBufferOffsetAlignment,
+         properties.limits.minStorageBufferOffsetAlignment, 16});
+    //Every segment has to start on an aligned offset too
+    segmentSize = (std::max<VkDeviceSize>(segmentSize, alignment) + alignment - 1) /
+                  alignment * alignment;
+
+    std::unique_ptr<Buffer> buf = CreateBuffer(
+        segmentSize * segments,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    void* data = buf->allocation_.mapped_;
+    return std::make_unique<UniformRing>(std::move(buf), data, segments,
+                                         segmentSize, alignment);
+}
+
 std::unique_ptr<Buffer>
 BufferFactory::CreateMaterialBuffer(Material* mat)
 {
     VkDeviceSize bufferSize = sizeof(*mat);
 
-    std::unique_ptr<Buffer> stBuf =
-        CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    void* data;
-    vkMapMemory(dev_, stBuf->bufferMemory_, 0, bufferSize, 0, &data);
-    std::memcpy(data, mat, sizeof(*mat));
-    vkUnmapMemory(dev_, stBuf->bufferMemory_);
-
     std::unique_ptr<Buffer> materialBuf = CreateBuffer(
         bufferSize,
         VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    executer_->CopyBuffer(stBuf->buffer_, materialBuf->buffer_, bufferSize);
+    uploadBuffer(materialBuf->buffer_, mat, bufferSize);
 
     return materialBuf;
 }
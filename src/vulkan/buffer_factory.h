@@ -5,10 +5,13 @@
 #include "command_executer.h"
 #include "../scene_objects/vertexes.h"
 #include "../scene_objects/material.h"
-#include "objects/vertex_buffer.h"
 #include "objects/buffer.h"
+#include "uniform_ring.h"
+#include "memory_allocator.h"
+#include "upload_service.h"
 
 #include <memory>
+#include <vector>
 
 #include <vulkan/vulkan.h>
 
@@ -20,24 +23,49 @@ class BufferFactory
 public:
     BufferFactory(VkDevice dev, VkPhysicalDevice PhysDev,
                     std::shared_ptr<CommandExecuter> ex)
-        : dev_(dev), physDev_(PhysDev), executer_(ex)
+        : dev_(dev), physDev_(PhysDev), executer_(ex),
+          allocator_(std::make_shared<MemoryAllocator>(dev, PhysDev))
     {
     }
 
     std::unique_ptr<Buffer>
     CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
                  VkMemoryPropertyFlags properties);
-    std::unique_ptr<VertexBuffer> CreateVertexBuffer(Vertexes* vert);
-    std::unique_ptr<Buffer> CreateIndexBuffer(Vertexes* vert);
     std::unique_ptr<Buffer> CreateUniformBuffer(VkDeviceSize bufferSize);
+    std::unique_ptr<UniformRing> CreateUniformRing(uint32_t     segments,
+                                                   VkDeviceSize segmentSize);
     std::unique_ptr<Buffer> CreateMaterialBuffer(Material* mat);
 
+    const std::shared_ptr<MemoryAllocator>& GetAllocator() const
+    {
+        return allocator_;
+    }
+    /// \brief Routes uploads through \p uploads instead of blocking copies
+    /// on the graphics queue. Upload destinations are shared with
+    /// \p graphicsFamily if the uploads run on another queue family.
+    void SetUploadService(std::shared_ptr<UploadService> uploads,
+                          uint32_t                       graphicsFamily);
+    //Null while uploads block on the graphics queue
+    const std::shared_ptr<UploadService>& GetUploadService() const
+    {
+        return uploads_;
+    }
+    uint64_t GetLastUpload() const { return lastUpload_; }
+
 protected:
     VkDevice                         dev_;
     VkPhysicalDevice                 physDev_;
     std::shared_ptr<CommandExecuter> executer_;
-    uint32_t                         findMemoryType(uint32_t              typeFilter,
-                                                    VkMemoryPropertyFlags properties);
+    //Shared with every buffer and texture so they outlive the factory
+    std::shared_ptr<MemoryAllocator> allocator_;
+    std::shared_ptr<UploadService>   uploads_;
+    //Families sharing upload destinations, empty while exclusive
+    std::vector<uint32_t>            sharedFamilies_;
+    //Upload value of the last resource filled by this factory
+    uint64_t                         lastUpload_ = 0;
+
+    uint64_t uploadBuffer(VkBuffer dst, const void* data, VkDeviceSize size,
+                          VkDeviceSize dstOffset = 0);
 };
 
 } // namespace Multor::Vulkan
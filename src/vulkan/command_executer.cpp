@@ -15,12 +15,13 @@ bool hasStencilComponent(VkFormat format)
 } // namespace
 
 void CommandExecuter::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer,
-                                 VkDeviceSize size)
+                                 VkDeviceSize size, VkDeviceSize dstOffset)
 {
     VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
     VkBufferCopy copyRegion {};
-    copyRegion.size = size;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size      = size;
     vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
     endSingleTimeCommands(commandBuffer);
@@ -0,0 +1,41 @@
+/// \file deletion_queue.cpp
+
+#include "deletion_queue.h"
+
+namespace Multor::Vulkan
+{
+
+DeletionQueue::~DeletionQueue()
+{
+    FlushAll();
+}
+
+void DeletionQueue::Push(uint64_t retiredAt, std::function<void()> deleter)
+{
+    //Frames are submitted in order, so tags never decrease
+    pending_.emplace_back(retiredAt, std::move(deleter));
+}
+
+void DeletionQueue::Flush(uint64_t completedFrames)
+{
+    while (!pending_.empty() && pending_.front().first <= completedFrames)
+        {
+            auto deleter = std::move(pending_.front().second);
+            pending_.pop_front();
+            if (deleter)
+                deleter();
+        }
+}
+
+void DeletionQueue::FlushAll()
+{
+    while (!pending_.empty())
+        {
+            auto deleter = std::move(pending_.front().second);
+            pending_.pop_front();
+            if (deleter)
+                deleter();
+        }
+}
+
+} // namespace Multor::Vulkan
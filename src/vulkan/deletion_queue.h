@@ -0,0 +1,41 @@
+/// \file deletion_queue.h
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+namespace Multor::Vulkan
+{
+
+/// \brief Defers destruction of GPU resources until the frames that may
+/// still reference them have completed.
+///
+/// Deleters are tagged with the number of frames submitted when the
+/// resource was retired and run once that many frames are known to be
+/// finished on the GPU.
+class DeletionQueue
+{
+public:
+    DeletionQueue() = default;
+    ~DeletionQueue();
+
+    DeletionQueue(const DeletionQueue&)            = delete;
+    DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+    void Push(uint64_t retiredAt, std::function<void()> deleter);
+    /// \brief Runs deleters of resources unused by the first
+    /// \p completedFrames frames
+    void Flush(uint64_t completedFrames);
+    /// \brief Runs every deleter, the caller guarantees the device is idle
+    void FlushAll();
+
+    bool Empty() const { return pending_.empty(); }
+
+private:
+    std::deque<std::pair<uint64_t, std::function<void()> > > pending_;
+};
+
+} // namespace Multor::Vulkan
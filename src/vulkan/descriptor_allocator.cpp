@@ -0,0 +1,149 @@
+/// \file descriptor_allocator.cpp
+
+#include "descriptor_allocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace Multor::Vulkan
+{
+
+DescriptorAllocator::DescriptorAllocator(
+    VkDevice device, VkDescriptorSetLayout layout,
+    const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+    uint32_t setsPerPool)
+    : device_(device), layout_(layout), bindings_(bindings),
+      setsPerPool_(std::clamp(setsPerPool, 1u, maxSetsPerPool))
+{
+    std::sort(bindings_.begin(), bindings_.end(),
+              [](const auto& a, const auto& b) { return a.binding < b.binding; });
+
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    entries.reserve(bindings_.size());
+    for (const auto& binding : bindings_)
+        {
+            if (binding.descriptorCount == 0)
+                throw std::runtime_error(
+                    "descriptor allocator needs sized bindings");
+            VkDescriptorUpdateTemplateEntry entry {};
+            entry.dstBinding      = binding.binding;
+            entry.dstArrayElement = 0;
+            entry.descriptorCount = binding.descriptorCount;
+            entry.descriptorType  = binding.descriptorType;
+            entry.offset          = descriptorCount_ * sizeof(DescriptorData);
+            entry.stride          = sizeof(DescriptorData);
+            entries.push_back(entry);
+            descriptorCount_ += binding.descriptorCount;
+        }
+
+    if (entries.empty())
+        return;
+    VkDescriptorUpdateTemplateCreateInfo templateInfo {};
+    templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    templateInfo.pNext = nullptr;
+    templateInfo.descriptorUpdateEntryCount =
+        static_cast<uint32_t>(entries.size());
+    templateInfo.pDescriptorUpdateEntries = entries.data();
+    templateInfo.templateType =
+        VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    templateInfo.descriptorSetLayout = layout_;
+    if (vkCreateDescriptorUpdateTemplate(device_, &templateInfo, nullptr,
+                                         &template_) != VK_SUCCESS)
+        throw std::runtime_error("failed to create descriptor update template!");
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+    for (auto pool : pools_)
+        vkDestroyDescriptorPool(device_, pool, nullptr);
+    if (template_ != VK_NULL_HANDLE)
+        vkDestroyDescriptorUpdateTemplate(device_, template_, nullptr);
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate()
+{
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    if (!freeSets_.empty())
+        {
+            set = freeSets_.back();
+            freeSets_.pop_back();
+            ++live_;
+            return set;
+        }
+
+    VkDescriptorSetAllocateInfo allocInfo {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.pNext = nullptr;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &layout_;
+
+    VkResult result = VK_ERROR_OUT_OF_POOL_MEMORY;
+    if (!pools_.empty())
+        {
+            allocInfo.descriptorPool = pools_.back();
+            result = vkAllocateDescriptorSets(device_, &allocInfo, &set);
+        }
+    //Earlier pools are full, sets only return to them through the free list
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY ||
+        result == VK_ERROR_FRAGMENTED_POOL)
+        {
+            addPool();
+            allocInfo.descriptorPool = pools_.back();
+            result = vkAllocateDescriptorSets(device_, &allocInfo, &set);
+        }
+    if (result != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate descriptor sets!");
+    ++live_;
+    return set;
+}
+
+void DescriptorAllocator::Free(VkDescriptorSet set)
+{
+    if (set == VK_NULL_HANDLE)
+        return;
+    freeSets_.push_back(set);
+    --live_;
+}
+
+void DescriptorAllocator::Write(VkDescriptorSet                    set,
+                                const std::vector<DescriptorData>& data) const
+{
+    if (data.size() != descriptorCount_)
+        throw std::runtime_error("descriptor data does not match the layout");
+    if (template_ != VK_NULL_HANDLE)
+        vkUpdateDescriptorSetWithTemplate(device_, set, template_, data.data());
+}
+
+void DescriptorAllocator::addPool()
+{
+    //The first pool is created at the requested size
+    if (!pools_.empty())
+        setsPerPool_ = std::min(setsPerPool_ * 2, maxSetsPerPool);
+
+    std::unordered_map<VkDescriptorType, uint32_t> descriptorCounts;
+    for (const auto& binding : bindings_)
+        descriptorCounts[binding.descriptorType] +=
+            binding.descriptorCount * setsPerPool_;
+
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    poolSizes.reserve(descriptorCounts.size());
+    for (const auto& [type, count] : descriptorCounts)
+        poolSizes.push_back(VkDescriptorPoolSize {type, count});
+
+    VkDescriptorPoolCreateInfo poolInfo {};
+    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.pNext         = nullptr;
+    poolInfo.flags         = 0;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes    = poolSizes.empty() ? nullptr : poolSizes.data();
+    poolInfo.maxSets       = setsPerPool_;
+
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    if (vkCreateDescriptorPool(device_, &poolInfo, nullptr, &pool) !=
+        VK_SUCCESS)
+        throw std::runtime_error("failed to create descriptor pool!");
+    pools_.push_back(pool);
+}
+
+} // namespace Multor::Vulkan
@@ -0,0 +1,79 @@
+/// \file descriptor_allocator.h
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace Multor::Vulkan
+{
+
+/// \brief Descriptor of one array element, the data layout of
+/// DescriptorAllocator::Write
+union DescriptorData
+{
+    VkDescriptorBufferInfo buffer_;
+    VkDescriptorImageInfo  image_;
+};
+
+/// \brief Allocates descriptor sets of one layout from a growing list of
+/// pools.
+///
+/// Pools are sized for whole sets of the layout, so they never fragment,
+/// and each new pool holds twice the sets of the previous one up to a
+/// limit. Freed sets go to a free list and are handed out again without
+/// touching the pools. Sets are written through an update template built
+/// from the layout bindings.
+class DescriptorAllocator
+{
+public:
+    /// \param bindings Bindings \p layout was created from, all sized
+    /// \param setsPerPool Sets of the first pool
+    DescriptorAllocator(VkDevice device, VkDescriptorSetLayout layout,
+                        const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+                        uint32_t setsPerPool);
+    ~DescriptorAllocator();
+
+    DescriptorAllocator(const DescriptorAllocator&)            = delete;
+    DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+    VkDescriptorSet Allocate();
+    /// \brief Returns \p set for reuse, no pending frame may use it
+    void Free(VkDescriptorSet set);
+
+    /// \brief Writes every binding of \p set. \p data holds one element
+    /// per descriptor in binding order, see GetDescriptorCount.
+    void Write(VkDescriptorSet set, const std::vector<DescriptorData>& data) const;
+    //Descriptors of a set, the size Write expects
+    uint32_t GetDescriptorCount() const { return descriptorCount_; }
+    /// \brief Bindings in the order of the Write data
+    const std::vector<VkDescriptorSetLayoutBinding>& GetBindings() const
+    {
+        return bindings_;
+    }
+
+    uint32_t GetPoolCount() const { return static_cast<uint32_t>(pools_.size()); }
+    //Sets handed out and not freed
+    uint32_t GetLiveCount() const { return live_; }
+
+private:
+    void addPool();
+
+private:
+    static constexpr uint32_t maxSetsPerPool = 4096;
+
+    VkDevice                                  device_;
+    VkDescriptorSetLayout                     layout_;
+    std::vector<VkDescriptorSetLayoutBinding> bindings_;
+    uint32_t                                  descriptorCount_ = 0;
+    VkDescriptorUpdateTemplate                template_ = VK_NULL_HANDLE;
+
+    std::vector<VkDescriptorPool> pools_;
+    uint32_t                      setsPerPool_;
+    std::vector<VkDescriptorSet>  freeSets_;
+    uint32_t                      live_ = 0;
+};
+
+} // namespace Multor::Vulkan
@@ -11,9 +11,36 @@ FrameChain::FrameChain(std::shared_ptr<Window> pWnd)
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
 
+    initChain();
+}
+
+FrameChain::FrameChain(VkExtent2D extent)
+    : BaseStructs(nullptr),
+      logger_(Logging::LoggerFactory::GetLogger("vulkan.log"))
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    swapChainExtent_ = extent;
+    initChain();
+}
+
+void FrameChain::initChain()
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
     executer_ =
         std::make_shared<CommandExecuter>(device, commandPool, graphicsQueue);
     meshFactory_ = std::make_unique<MeshFactory>(device, physicDev, executer_);
+    //A dedicated transfer family has no graphics support and can not blit
+    uploads_     = std::make_shared<UploadService>(
+        device, meshFactory_->GetAllocator(), transferQueue,
+        physicDevIndices.transferFamily.value_or(
+            physicDevIndices.graphicsFamily.value()),
+        uploadStagingSize_, !physicDevIndices.transferFamily.has_value());
+    meshFactory_->SetUploadService(uploads_,
+                                   physicDevIndices.graphicsFamily.value());
+    pipelineCache_ =
+        std::make_shared<PipelineCache>(device, physicDev, pipelineCacheDir_);
     createSwapChain();
     createImageViews();
     createRenderPass();
@@ -24,20 +51,41 @@ FrameChain::FrameChain(std::shared_ptr<Window> pWnd)
 
 FrameChain::~FrameChain()
 {
+    pipelineCache_.reset();
+    uploads_.reset();
     meshFactory_.reset();
     executer_.reset();
     CleanUpSwapChain();
 }
 
 VkPresentModeKHR chooseSwapPresentMode(
-    const std::vector<VkPresentModeKHR>& availablePresentModes)
+    const std::vector<VkPresentModeKHR>& availablePresentModes,
+    VkPresentModeKHR                     preferred)
 {
     if (std::find(availablePresentModes.cbegin(), availablePresentModes.cend(),
-                  VK_PRESENT_MODE_MAILBOX_KHR) != availablePresentModes.cend())
-        return VK_PRESENT_MODE_MAILBOX_KHR;
+                  preferred) != availablePresentModes.cend())
+        return preferred;
+    //The only mode every device supports
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+const char* presentModeName(VkPresentModeKHR mode)
+{
+    switch (mode)
+        {
+            case VK_PRESENT_MODE_IMMEDIATE_KHR:
+                return "IMMEDIATE";
+            case VK_PRESENT_MODE_MAILBOX_KHR:
+                return "MAILBOX";
+            case VK_PRESENT_MODE_FIFO_KHR:
+                return "FIFO";
+            case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+                return "FIFO_RELAXED";
+            default:
+                return "UNKNOWN";
+        }
+}
+
 VkSurfaceFormatKHR
 chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
 {
@@ -79,6 +127,12 @@ void FrameChain::createSwapChain()
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
 
+    if (headless_)
+        {
+            createOffscreenImages();
+            return;
+        }
+
     //Looking for physical device parametrs - formats
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport();
     //Choose needing surface format
@@ -86,7 +140,12 @@ void FrameChain::createSwapChain()
         chooseSwapSurfaceFormat(swapChainSupport.formats);
     //Set present mode
     VkPresentModeKHR presentMode =
-        chooseSwapPresentMode(swapChainSupport.presentModes);
+        chooseSwapPresentMode(swapChainSupport.presentModes, preferredPresentMode_);
+    if (presentMode != preferredPresentMode_)
+        LOG_WARNING(logger_.get(), "Present mode {} is not supported, using {}",
+                    presentModeName(preferredPresentMode_),
+                    presentModeName(presentMode));
+    presentMode_ = presentMode;
     //Set resolution of window
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
     //Set amount swap buffers
@@ -139,6 +198,24 @@ void FrameChain::createSwapChain()
     swapChainExtent_      = extent;
 }
 
+void FrameChain::createOffscreenImages()
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    //Same format as preferred surface format, so pipelines are identical
+    swapChainImageFormat_ = VK_FORMAT_B8G8R8A8_SRGB;
+    swapChainImages_.resize(headlessImageCount_);
+    offscreenMemory_.resize(headlessImageCount_);
+    for (uint32_t i = 0; i < headlessImageCount_; ++i)
+        std::tie(swapChainImages_[i], offscreenMemory_[i]) =
+            meshFactory_->CreateImage(
+                swapChainExtent_.width, swapChainExtent_.height,
+                swapChainImageFormat_, VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
 void FrameChain::createImageViews()
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
@@ -164,7 +241,10 @@ void FrameChain::createRenderPass()
     colorAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    //Offscreen images are left ready for readback instead of presenting
+    colorAttachment.finalLayout    = headless_
+                                         ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                         : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
     //Set first index for colour output
     VkAttachmentReference colorAttachmentRef {};
     colorAttachmentRef.attachment = 0;
@@ -271,8 +351,19 @@ void FrameChain::CleanUpSwapChain()
         vkDestroyImageView(device, imageView, nullptr),
             imageView = VK_NULL_HANDLE;
 
-    vkDestroySwapchainKHR(device, swapChain_, nullptr),
-        swapChain_ = VK_NULL_HANDLE;
+    if (headless_)
+        {
+            for (std::size_t i = 0; i < swapChainImages_.size(); ++i)
+                {
+                    vkDestroyImage(device, swapChainImages_[i], nullptr);
+                    meshFactory_->GetAllocator()->Free(offscreenMemory_[i]);
+                }
+            swapChainImages_.clear();
+            offscreenMemory_.clear();
+        }
+    else
+        vkDestroySwapchainKHR(device, swapChain_, nullptr),
+            swapChain_ = VK_NULL_HANDLE;
 }
 
 void FrameChain::RecreateSwapChain()
@@ -4,6 +4,7 @@
 
 #include "general_options.h"
 #include "mesh_factory.h"
+#include "pipeline_cache.h"
 
 #include <algorithm>
 #include <vector>
@@ -16,12 +17,18 @@ class FrameChain : public BaseStructs
 {
 public:
     FrameChain(std::shared_ptr<Window>          pWnd);
+    /// \brief Headless chain: renders into offscreen color images of the
+    /// given size instead of swapchain images
+    FrameChain(VkExtent2D extent);
 
     ~FrameChain();
 
     void CleanUpSwapChain();
     void RecreateSwapChain();
 
+    //Mode of the current swapchain
+    VkPresentModeKHR GetPresentMode() const { return presentMode_; }
+
 protected:
     Logging::Logger& logger_;
 
@@ -35,11 +42,28 @@ protected:
     std::vector<VkImage>       swapChainImages_;
     std::vector<VkImageView>   swapChainImageViews_;
     std::vector<VkFramebuffer> swapChainFramebuffers_;
+    //Backing memory of offscreen images in headless mode
+    std::vector<MemoryAllocation> offscreenMemory_;
+
+    static constexpr uint32_t headlessImageCount_ = 3;
+
+    //Used if the surface supports it, FIFO otherwise
+    VkPresentModeKHR preferredPresentMode_ = VK_PRESENT_MODE_MAILBOX_KHR;
+    VkPresentModeKHR presentMode_          = VK_PRESENT_MODE_FIFO_KHR;
 
     std::shared_ptr<CommandExecuter> executer_;
+    std::shared_ptr<UploadService>   uploads_;
     std::unique_ptr<MeshFactory>     meshFactory_;
+    //Used by every pipeline of the device, saved on destruction
+    std::shared_ptr<PipelineCache>   pipelineCache_;
+
+    //Staging ring of the upload service
+    static constexpr VkDeviceSize uploadStagingSize_ = 32ull * 1024 * 1024;
+    static constexpr const char*  pipelineCacheDir_  = "./cache";
 
+    void initChain();
     void createSwapChain();
+    void createOffscreenImages();
     void createImageViews();
     void createRenderPass();
     void createFramebuffers();
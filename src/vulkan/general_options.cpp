@@ -8,7 +8,9 @@ BaseStructs::BaseStructs(std::shared_ptr<Window>          pWnd)
     : _pWnd(std::move(pWnd))
     , logger_(Logging::LoggerFactory::GetLogger("vulkan.log"))
     , physicDev(VK_NULL_HANDLE)
+    , surface(VK_NULL_HANDLE)
 {
+    headless_ = !_pWnd;
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
 
     CreateInstance();
@@ -25,7 +27,8 @@ BaseStructs::~BaseStructs()
     vkDestroyCommandPool(device, commandPool, nullptr),
         commandPool = VK_NULL_HANDLE;
 
-    vkDestroySurfaceKHR(instance, surface, nullptr), surface = VK_NULL_HANDLE;
+    if (surface != VK_NULL_HANDLE)
+        vkDestroySurfaceKHR(instance, surface, nullptr), surface = VK_NULL_HANDLE;
     vkDestroyDevice(device, nullptr), device                 = VK_NULL_HANDLE;
     if (enableValidationLayers)
         DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
@@ -104,6 +107,14 @@ std::vector<const char*> BaseStructs::getRequiredExtensions()
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
 
+    std::vector<const char*> extensions;
+    if (headless_)
+        {
+            if (enableValidationLayers)
+                extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+            return extensions;
+        }
+
     uint32_t extensionCount = 0;
     const char* const* extensionNames =
         SDL_Vulkan_GetInstanceExtensions(&extensionCount);
@@ -111,7 +122,7 @@ std::vector<const char*> BaseStructs::getRequiredExtensions()
         throw std::runtime_error(std::string("SDL_Vulkan_GetInstanceExtensions failed: ") +
                                  SDL_GetError());
 
-    std::vector<const char*> extensions(extensionNames, extensionNames + extensionCount);
+    extensions.assign(extensionNames, extensionNames + extensionCount);
 
     if (enableValidationLayers)
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -119,6 +130,14 @@ std::vector<const char*> BaseStructs::getRequiredExtensions()
     return extensions;
 }
 
+std::vector<const char*> BaseStructs::getDeviceExtensions() const
+{
+    //Offscreen rendering never presents, so the swapchain is not needed
+    if (headless_)
+        return {};
+    return deviceExtensions;
+}
+
 void BaseStructs::InitPhysicalDevice()
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
@@ -151,8 +170,19 @@ bool BaseStructs::isDeviceSuitable(VkPhysicalDevice device)
 
     VkPhysicalDeviceFeatures supportedFeatures;
     vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
+    //Uploads signal their completion with a timeline semaphore
+    VkPhysicalDeviceVulkan12Features features12 {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 features2 {};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &features12;
+    vkGetPhysicalDeviceFeatures2(device, &features2);
     //Check can device execute required operations?
-    bool extensionsSupported = checkDeviceExtensionSupport(device);
+    bool extensionsSupported = checkDeviceExtensionSupport(device) &&
+                               features12.timelineSemaphore;
+
+    if (headless_)
+        return extensionsSupported && supportedFeatures.samplerAnisotropy;
 
     //Check capability surface formats
     bool swapChainAdequate = false;
@@ -183,6 +213,9 @@ void BaseStructs::InitLogicalDevice()
         quequeNums = {physicDevIndices.graphicsFamily.value(),
                       physicDevIndices.presentFamily.value()};
 
+    if (physicDevIndices.transferFamily.has_value())
+        quequeNums.push_back(physicDevIndices.transferFamily.value());
+
     for (uint32_t queueFamily : quequeNums)
         {
             VkDeviceQueueCreateInfo queueCreateInfo {};
@@ -200,17 +233,51 @@ void BaseStructs::InitLogicalDevice()
     VkPhysicalDeviceFeatures devFeatures {};
     devFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
     devFeatures.imageCubeArray    = supportedFeatures.imageCubeArray;
+    //Optional, the renderer falls back to direct draws without them
+    devFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    devFeatures.drawIndirectFirstInstance =
+        supportedFeatures.drawIndirectFirstInstance;
+    //Optional, textures stay uncompressed without it
+    devFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
+    VkPhysicalDeviceVulkan12Features supported12 {};
+    supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 supported2 {};
+    supported2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supported2.pNext = &supported12;
+    vkGetPhysicalDeviceFeatures2(physicDev, &supported2);
+    //Optional, meshes bind their own texture sets without the bindless
+    //texture table. Vulkan 1.3 devices support all of it.
+    descriptorIndexing_ =
+        supported12.runtimeDescriptorArray &&
+        supported12.shaderSampledImageArrayNonUniformIndexing &&
+        supported12.descriptorBindingPartiallyBound &&
+        supported12.descriptorBindingSampledImageUpdateAfterBind &&
+        supported12.descriptorBindingUpdateUnusedWhilePending;
+
+    VkPhysicalDeviceVulkan12Features features12 {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.timelineSemaphore = VK_TRUE;
+    if (descriptorIndexing_)
+        {
+            features12.runtimeDescriptorArray                       = VK_TRUE;
+            features12.shaderSampledImageArrayNonUniformIndexing    = VK_TRUE;
+            features12.descriptorBindingPartiallyBound              = VK_TRUE;
+            features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            features12.descriptorBindingUpdateUnusedWhilePending    = VK_TRUE;
+        }
 
     VkDeviceCreateInfo createInfo {};
     createInfo.sType             = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    createInfo.pNext             = nullptr;
+    createInfo.pNext             = &features12;
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.queueCreateInfoCount =
         static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pEnabledFeatures = &devFeatures;
+    const auto extensions = getDeviceExtensions();
     createInfo.enabledExtensionCount =
-        static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
     //Create logical device
     if (vkCreateDevice(physicDev, &createInfo, nullptr, &device) != VK_SUCCESS)
         throw std::runtime_error("Don't create physical device!");
@@ -219,12 +286,25 @@ void BaseStructs::InitLogicalDevice()
                      &graphicsQueue);
     vkGetDeviceQueue(device, physicDevIndices.presentFamily.value(), 0,
                      &presentQueue);
+    transferQueue = graphicsQueue;
+    if (physicDevIndices.transferFamily.has_value())
+        vkGetDeviceQueue(device, physicDevIndices.transferFamily.value(), 0,
+                         &transferQueue);
+    LOG_INFO(logger_.get(), "Mesh textures use {}",
+             descriptorIndexing_ ? "the bindless texture table"
+                                 : "per mesh descriptor sets");
+    LOG_INFO(logger_.get(), "Uploads use {} queue",
+             physicDevIndices.transferFamily.has_value() ? "a dedicated transfer"
+                                                        : "the graphics");
 }
 
 void BaseStructs::CreateSurface()
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
 
+    if (headless_)
+        return;
+
     if (!SDL_Vulkan_CreateSurface(_pWnd->GetWindow().get(), instance, nullptr,
                                   &surface))
         throw std::runtime_error(std::string("Don't create surface: ") + SDL_GetError());
@@ -266,6 +346,13 @@ QueueFamilyIndices BaseStructs::findQueueFamilies(VkPhysicalDevice device)
             if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
                 indices.graphicsFamily = i;
 
+            //Without surface the graphics queue stands in for presentation
+            if (headless_ && indices.graphicsFamily.has_value())
+                {
+                    indices.presentFamily = indices.graphicsFamily;
+                    break;
+                }
+
             VkBool32 presentSupport = false;
             vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface,
                                                  &presentSupport);
@@ -279,9 +366,33 @@ QueueFamilyIndices BaseStructs::findQueueFamilies(VkPhysicalDevice device)
             i++;
         }
 
+    indices.transferFamily = findTransferFamily(device);
     return indices;
 }
 
+std::optional<uint32_t> BaseStructs::findTransferFamily(VkPhysicalDevice device)
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount,
+                                             nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount,
+                                             queueFamilies.data());
+
+    //A family without graphics and compute is the copy engine on
+    //discrete GPUs and runs beside rendering
+    for (uint32_t i = 0; i < queueFamilyCount; ++i)
+        if ((queueFamilies[i].queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+            !(queueFamilies[i].queueFlags &
+              (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+            return i;
+
+    return std::nullopt;
+}
+
 bool BaseStructs::checkValidationLayerSupport()
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
@@ -322,7 +433,7 @@ bool BaseStructs::checkDeviceExtensionSupport(VkPhysicalDevice device)
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount,
                                          availableExtensions.data());
 
-    for (const auto& Extension : deviceExtensions)
+    for (const auto& Extension : getDeviceExtensions())
         if (std::find_if(
                 availableExtensions.cbegin(), availableExtensions.cend(),
                 [&Extension](const auto& pr) {
@@ -32,6 +32,8 @@ struct QueueFamilyIndices
 {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    //Transfer only family, uploads use the graphics queue without it
+    std::optional<uint32_t> transferFamily;
 
     bool isComplete()
     {
@@ -48,9 +50,21 @@ struct SwapChainSupportDetails
 
 struct BaseStructs
 {
+    /// \brief Creates instance and device. A null window selects headless
+    /// mode: no surface is created and no present support is required.
     BaseStructs(std::shared_ptr<Window>          pWnd);
     ~BaseStructs();
 
+    bool IsHeadless() const
+    {
+        return headless_;
+    }
+    //Whether the features of the bindless texture table are enabled
+    bool SupportsDescriptorIndexing() const
+    {
+        return descriptorIndexing_;
+    }
+
 protected:
 
     Logging::Logger& logger_;
@@ -60,11 +74,13 @@ protected:
     VkPhysicalDevice         physicDev;
     QueueFamilyIndices       physicDevIndices;
     VkDevice                 device;
-    VkQueue                  graphicsQueue, presentQueue;
+    VkQueue                  graphicsQueue, presentQueue, transferQueue;
     VkCommandPool            commandPool;
     VkSurfaceKHR             surface;
 
     std::shared_ptr<Window>          _pWnd;
+    bool                             headless_;
+    bool                             descriptorIndexing_ = false;
 
     SwapChainSupportDetails querySwapChainSupport();
 
@@ -77,7 +93,9 @@ private:
 
     bool                     isDeviceSuitable(VkPhysicalDevice device);
     QueueFamilyIndices       findQueueFamilies(VkPhysicalDevice device);
+    std::optional<uint32_t>  findTransferFamily(VkPhysicalDevice device);
     std::vector<const char*> getRequiredExtensions();
+    std::vector<const char*> getDeviceExtensions() const;
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
     bool checkValidationLayerSupport();
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
@@ -0,0 +1,176 @@
+/// \file geometry_pool.cpp
+
+#include "geometry_pool.h"
+#include "objects/vertex.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace Multor::Vulkan
+{
+
+MeshGeometry::~MeshGeometry()
+{
+    if (pool_)
+        pool_->Free(*this);
+}
+
+GeometryPool::FreeList::FreeList(uint32_t capacity)
+{
+    free_.emplace(0u, capacity);
+}
+
+bool GeometryPool::FreeList::Allocate(uint32_t count, uint32_t& offset)
+{
+    for (auto it = free_.begin(); it != free_.end(); ++it)
+        {
+            if (it->second < count)
+                continue;
+
+            offset                = it->first;
+            const uint32_t remain = it->second - count;
+            free_.erase(it);
+            if (remain > 0)
+                free_.emplace(offset + count, remain);
+            return true;
+        }
+    return false;
+}
+
+void GeometryPool::FreeList::Release(uint32_t offset, uint32_t count)
+{
+    auto next = free_.lower_bound(offset);
+    //Merge with the range ending where this one starts
+    if (next != free_.begin())
+        {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset)
+                {
+                    offset = prev->first;
+                    count += prev->second;
+                    free_.erase(prev);
+                }
+        }
+    //And with the one starting where it ends
+    if (next != free_.end() && offset + count == next->first)
+        {
+            count += next->second;
+            free_.erase(next);
+        }
+    free_.emplace(offset, count);
+}
+
+GeometryPool::GeometryPool(VkDevice                         device,
+                           std::shared_ptr<MemoryAllocator> allocator,
+                           std::vector<uint32_t>            sharedFamilies)
+    : logger_(Logging::LoggerFactory::GetLogger("vulkan.log")),
+      device_(device),
+      allocator_(std::move(allocator)),
+      sharedFamilies_(std::move(sharedFamilies))
+{
+}
+
+std::unique_ptr<MeshGeometry> GeometryPool::Allocate(uint32_t vertexCount,
+                                                     uint32_t indexCount)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::unique_ptr<MeshGeometry> geometry = std::make_unique<MeshGeometry>();
+    geometry->vertexCount_ = vertexCount;
+    geometry->indexCount_  = indexCount;
+
+    auto fits = [&](Page& page, uint32_t pageIndex)
+    {
+        uint32_t vertexOffset = 0;
+        uint32_t indexOffset  = 0;
+        if (!page.freeVertices_.Allocate(vertexCount, vertexOffset))
+            return false;
+        if (!page.freeIndices_.Allocate(indexCount, indexOffset))
+            {
+                page.freeVertices_.Release(vertexOffset, vertexCount);
+                return false;
+            }
+        geometry->vertexBuffer_ = page.vertices_->buffer_;
+        geometry->indexBuffer_  = page.indices_->buffer_;
+        geometry->page_         = pageIndex;
+        geometry->baseVertex_   = vertexOffset;
+        geometry->firstIndex_   = indexOffset;
+        return true;
+    };
+
+    for (uint32_t i = 0; i < pages_.size(); ++i)
+        if (fits(pages_[i], i))
+            {
+                geometry->pool_ = shared_from_this();
+                return geometry;
+            }
+
+    addPage(std::max(vertexCount, pageVertices_),
+            std::max(indexCount, pageIndices_));
+    if (!fits(pages_.back(), static_cast<uint32_t>(pages_.size() - 1)))
+        throw std::runtime_error("failed to allocate mesh geometry!");
+    geometry->pool_ = shared_from_this();
+    return geometry;
+}
+
+void GeometryPool::Free(const MeshGeometry& geometry)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Page& page = pages_.at(geometry.page_);
+    page.freeVertices_.Release(geometry.baseVertex_, geometry.vertexCount_);
+    page.freeIndices_.Release(geometry.firstIndex_, geometry.indexCount_);
+}
+
+std::size_t GeometryPool::GetPageCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pages_.size();
+}
+
+std::unique_ptr<Buffer> GeometryPool::createBuffer(VkDeviceSize       size,
+                                                   VkBufferUsageFlags usage)
+{
+    std::unique_ptr<Buffer> buf = std::make_unique<Buffer>();
+    VkBufferCreateInfo      bufferInfo {};
+    bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.pNext       = nullptr;
+    bufferInfo.size        = size;
+    bufferInfo.usage       = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    //Filled by the transfer queue, read by the graphics queue
+    if (sharedFamilies_.size() > 1)
+        {
+            bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            bufferInfo.queueFamilyIndexCount =
+                static_cast<uint32_t>(sharedFamilies_.size());
+            bufferInfo.pQueueFamilyIndices = sharedFamilies_.data();
+        }
+
+    if (vkCreateBuffer(device_, &bufferInfo, nullptr, &buf->buffer_) !=
+        VK_SUCCESS)
+        throw std::runtime_error("failed to create geometry buffer!");
+    buf->dev_ = device_;
+
+    buf->allocation_ = allocator_->AllocateBuffer(
+        buf->buffer_, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    buf->allocator_ = allocator_;
+    return buf;
+}
+
+void GeometryPool::addPage(uint32_t vertexCapacity, uint32_t indexCapacity)
+{
+    LOG_INFO(logger_.get(),
+             "Adding geometry page {} for {} vertices and {} indices",
+             pages_.size(), vertexCapacity, indexCapacity);
+
+    pages_.push_back(
+        {createBuffer(VkDeviceSize(vertexCapacity) * sizeof(Vertex),
+                      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT),
+         createBuffer(VkDeviceSize(indexCapacity) * sizeof(uint32_t),
+                      VK_BUFFER_USAGE_INDEX_BUFFER_BIT),
+         FreeList(vertexCapacity), FreeList(indexCapacity)});
+}
+
+} // namespace Multor::Vulkan
@@ -0,0 +1,106 @@
+/// \file geometry_pool.h
+
+#pragma once
+
+#include "../logger/logger.h"
+#include "memory_allocator.h"
+#include "objects/buffer.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace Multor::Vulkan
+{
+
+class GeometryPool;
+
+/// \brief Vertices and indices of one mesh inside a page of the geometry
+/// pool. The range goes back to the pool when this is destroyed.
+struct MeshGeometry
+{
+    VkBuffer      vertexBuffer_ = VK_NULL_HANDLE;
+    VkBuffer      indexBuffer_  = VK_NULL_HANDLE;
+    std::uint32_t page_         = 0;
+    //Added to every index, vertexOffset of the draw
+    std::uint32_t baseVertex_   = 0;
+    std::uint32_t vertexCount_  = 0;
+    std::uint32_t firstIndex_   = 0;
+    std::uint32_t indexCount_   = 0;
+    std::shared_ptr<GeometryPool> pool_;
+
+    ~MeshGeometry();
+};
+
+/// \brief Packs the geometry of all meshes into a few large device local
+/// vertex and index buffers.
+///
+/// Buffers come in pages holding one vertex and one index buffer. Each
+/// page keeps a first fit free list per buffer whose neighbouring ranges
+/// are merged on release. Meshes larger than a page get a page of their
+/// own size. Meshes of one page can be drawn with a single buffer bind.
+class GeometryPool : public std::enable_shared_from_this<GeometryPool>
+{
+public:
+    /// \param sharedFamilies Queue families accessing the buffers
+    /// concurrently, exclusive if fewer than two
+    GeometryPool(VkDevice device, std::shared_ptr<MemoryAllocator> allocator,
+                 std::vector<uint32_t> sharedFamilies);
+
+    GeometryPool(const GeometryPool&)            = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    /// \brief Reserves space for a mesh, its data still has to be uploaded
+    std::unique_ptr<MeshGeometry> Allocate(uint32_t vertexCount,
+                                           uint32_t indexCount);
+    void                          Free(const MeshGeometry& geometry);
+
+    std::size_t GetPageCount() const;
+
+private:
+    class FreeList
+    {
+    public:
+        explicit FreeList(uint32_t capacity);
+
+        bool Allocate(uint32_t count, uint32_t& offset);
+        void Release(uint32_t offset, uint32_t count);
+
+    private:
+        //Offset to size of every free range
+        std::map<uint32_t, uint32_t> free_;
+    };
+
+    struct Page
+    {
+        std::unique_ptr<Buffer> vertices_;
+        std::unique_ptr<Buffer> indices_;
+        FreeList                freeVertices_;
+        FreeList                freeIndices_;
+    };
+
+    std::unique_ptr<Buffer> createBuffer(VkDeviceSize size,
+                                         VkBufferUsageFlags usage);
+    void                    addPage(uint32_t vertexCapacity,
+                                    uint32_t indexCapacity);
+
+private:
+    //About 28 MiB of vertices and 6 MiB of indices per page
+    static constexpr uint32_t pageVertices_ = 512u * 1024;
+    static constexpr uint32_t pageIndices_  = 1536u * 1024;
+
+    Logging::Logger& logger_;
+
+    VkDevice                         device_;
+    std::shared_ptr<MemoryAllocator> allocator_;
+    std::vector<uint32_t>            sharedFamilies_;
+
+    std::vector<Page>  pages_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace Multor::Vulkan
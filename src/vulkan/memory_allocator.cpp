@@ -0,0 +1,452 @@
+/// \file memory_allocator.cpp
+
+#include "memory_allocator.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+namespace Multor::Vulkan
+{
+
+namespace
+{
+
+//Blocks never exceed this, smaller heaps get an eighth of their size
+constexpr VkDeviceSize maxBlockSize = 64ull * 1024 * 1024;
+//Smallest buddy range, keeps the split tree shallow
+constexpr VkDeviceSize minBuddySize = 256;
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+/// \brief One VkDeviceMemory handed out in pieces
+class MemoryBlock
+{
+public:
+    MemoryBlock(VkDevice device, VkDeviceMemory memory, VkDeviceSize size,
+                void* mapped)
+        : device_(device), memory_(memory), size_(size), mapped_(mapped)
+    {
+    }
+    virtual ~MemoryBlock()
+    {
+        if (mapped_)
+            vkUnmapMemory(device_, memory_);
+        vkFreeMemory(device_, memory_, nullptr);
+    }
+
+    MemoryBlock(const MemoryBlock&)            = delete;
+    MemoryBlock& operator=(const MemoryBlock&) = delete;
+
+    /// \brief Returns offset and reserved size, nothing if there is no room
+    virtual std::optional<std::pair<VkDeviceSize, VkDeviceSize> >
+    Allocate(VkDeviceSize size, VkDeviceSize alignment) = 0;
+    virtual void Free(VkDeviceSize offset, VkDeviceSize size) = 0;
+
+    bool           Empty() const { return live_ == 0; }
+    VkDeviceMemory GetMemory() const { return memory_; }
+    VkDeviceSize   GetSize() const { return size_; }
+    void*          MappedAt(VkDeviceSize offset) const
+    {
+        return mapped_ ? static_cast<std::byte*>(mapped_) + offset : nullptr;
+    }
+
+protected:
+    VkDevice       device_;
+    VkDeviceMemory memory_;
+    VkDeviceSize   size_;
+    void*          mapped_;
+    uint32_t       live_ = 0;
+};
+
+namespace
+{
+
+class BuddyBlock final : public MemoryBlock
+{
+public:
+    BuddyBlock(VkDevice device, VkDeviceMemory memory, VkDeviceSize size,
+               void* mapped)
+        : MemoryBlock(device, memory, size, mapped),
+          free_(std::countr_zero(size / minBuddySize) + 1)
+    {
+        free_[0].insert(0);
+    }
+
+    std::optional<std::pair<VkDeviceSize, VkDeviceSize> >
+    Allocate(VkDeviceSize size, VkDeviceSize alignment) override
+    {
+        //Ranges are aligned to their own size, which covers the alignment
+        const VkDeviceSize need = std::bit_ceil(
+            std::max({size, alignment, minBuddySize}));
+        if (need > size_)
+            return std::nullopt;
+
+        const auto level = levelOf(need);
+        std::size_t from = level + 1;
+        while (from > 0 && free_[from - 1].empty())
+            --from;
+        if (from == 0)
+            return std::nullopt;
+        --from;
+
+        VkDeviceSize offset = *free_[from].begin();
+        free_[from].erase(free_[from].begin());
+        //Split down keeping the lower half, the upper one becomes free
+        for (std::size_t l = from + 1; l <= level; ++l)
+            free_[l].insert(offset + (size_ >> l));
+
+        ++live_;
+        return std::make_pair(offset, need);
+    }
+
+    void Free(VkDeviceSize offset, VkDeviceSize size) override
+    {
+        auto level = levelOf(size);
+        while (level > 0)
+            {
+                const VkDeviceSize buddy = offset ^ (size_ >> level);
+                if (free_[level].erase(buddy) == 0)
+                    break;
+                offset = std::min(offset, buddy);
+                --level;
+            }
+        free_[level].insert(offset);
+        --live_;
+    }
+
+private:
+    std::size_t levelOf(VkDeviceSize size) const
+    {
+        return static_cast<std::size_t>(std::countr_zero(size_) -
+                                        std::countr_zero(size));
+    }
+
+    //Free range offsets per level, level 0 is the whole block
+    std::vector<std::set<VkDeviceSize> > free_;
+};
+
+class LinearBlock final : public MemoryBlock
+{
+public:
+    using MemoryBlock::MemoryBlock;
+
+    std::optional<std::pair<VkDeviceSize, VkDeviceSize> >
+    Allocate(VkDeviceSize size, VkDeviceSize alignment) override
+    {
+        const VkDeviceSize offset = alignUp(head_, alignment);
+        if (offset + size > size_)
+            return std::nullopt;
+        head_ = offset + size;
+        ++live_;
+        return std::make_pair(offset, size);
+    }
+
+    void Free(VkDeviceSize, VkDeviceSize) override
+    {
+        //Space comes back only when everything in the block is released
+        if (--live_ == 0)
+            head_ = 0;
+    }
+
+private:
+    VkDeviceSize head_ = 0;
+};
+
+} // namespace
+
+MemoryAllocator::MemoryAllocator(VkDevice device, VkPhysicalDevice physDev)
+    : logger_(Logging::LoggerFactory::GetLogger("vulkan.log")), device_(device)
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    vkGetPhysicalDeviceMemoryProperties(physDev, &memProperties_);
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    LOG_INFO(logger_.get(),
+             "Device memory: {} allocations, {} blocks, {} dedicated, "
+             "peak {} MB reserved",
+             stats_.deviceAllocations_, stats_.blocks_, stats_.dedicated_,
+             stats_.peakReservedBytes_ / (1024 * 1024));
+    pools_.clear();
+}
+
+uint32_t MemoryAllocator::FindMemoryType(uint32_t              typeFilter,
+                                         VkMemoryPropertyFlags properties) const
+{
+    for (uint32_t i = 0; i < memProperties_.memoryTypeCount; i++)
+        if ((typeFilter & (1 << i)) &&
+            (memProperties_.memoryTypes[i].propertyFlags & properties) ==
+                properties)
+            return i;
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+MemoryAllocation MemoryAllocator::AllocateBuffer(VkBuffer              buffer,
+                                                 VkMemoryPropertyFlags properties,
+                                                 AllocationStrategy    strategy)
+{
+    VkMemoryDedicatedRequirements dedicated {};
+    dedicated.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+    VkMemoryRequirements2 requirements {};
+    requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    requirements.pNext = &dedicated;
+    VkBufferMemoryRequirementsInfo2 info {};
+    info.sType  = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+    info.buffer = buffer;
+    vkGetBufferMemoryRequirements2(device_, &info, &requirements);
+
+    const auto& memRequirements = requirements.memoryRequirements;
+    const uint32_t memoryType =
+        FindMemoryType(memRequirements.memoryTypeBits, properties);
+
+    MemoryAllocation allocation;
+    if (dedicated.requiresDedicatedAllocation ||
+        memRequirements.size > blockSizeFor(memoryType) / 2)
+        allocation =
+            allocateDedicated(memRequirements, memoryType, buffer, VK_NULL_HANDLE);
+    else
+        allocation = allocate(memRequirements, memoryType, false, strategy);
+
+    if (vkBindBufferMemory(device_, buffer, allocation.memory_,
+                           allocation.offset_) != VK_SUCCESS)
+        {
+            Free(allocation);
+            throw std::runtime_error("failed to bind buffer memory!");
+        }
+    return allocation;
+}
+
+MemoryAllocation MemoryAllocator::AllocateImage(VkImage               image,
+                                                VkMemoryPropertyFlags properties)
+{
+    VkMemoryDedicatedRequirements dedicated {};
+    dedicated.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+    VkMemoryRequirements2 requirements {};
+    requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    requirements.pNext = &dedicated;
+    VkImageMemoryRequirementsInfo2 info {};
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+    info.image = image;
+    vkGetImageMemoryRequirements2(device_, &info, &requirements);
+
+    const auto& memRequirements = requirements.memoryRequirements;
+    const uint32_t memoryType =
+        FindMemoryType(memRequirements.memoryTypeBits, properties);
+
+    //Render targets usually report prefersDedicatedAllocation
+    MemoryAllocation allocation;
+    if (dedicated.requiresDedicatedAllocation ||
+        dedicated.prefersDedicatedAllocation ||
+        memRequirements.size > blockSizeFor(memoryType) / 2)
+        allocation =
+            allocateDedicated(memRequirements, memoryType, VK_NULL_HANDLE, image);
+    else
+        allocation = allocate(memRequirements, memoryType, true,
+                              AllocationStrategy::Buddy);
+
+    if (vkBindImageMemory(device_, image, allocation.memory_,
+                          allocation.offset_) != VK_SUCCESS)
+        {
+            Free(allocation);
+            throw std::runtime_error("failed to bind image memory!");
+        }
+    return allocation;
+}
+
+void MemoryAllocator::Free(const MemoryAllocation& allocation)
+{
+    if (allocation.memory_ == VK_NULL_HANDLE)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!allocation.block_)
+        {
+            if (allocation.mapped_)
+                vkUnmapMemory(device_, allocation.memory_);
+            vkFreeMemory(device_, allocation.memory_, nullptr);
+            --stats_.deviceAllocations_;
+            --stats_.dedicated_;
+            stats_.reservedBytes_ -= allocation.size_;
+            stats_.usedBytes_ -= allocation.size_;
+            return;
+        }
+
+    allocation.block_->Free(allocation.offset_, allocation.size_);
+    --stats_.subAllocations_;
+    stats_.usedBytes_ -= allocation.size_;
+    if (allocation.block_->Empty())
+        releaseEmptyBlock(allocation.block_);
+}
+
+MemoryStats MemoryAllocator::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+MemoryAllocation
+MemoryAllocator::allocate(const VkMemoryRequirements& requirements,
+                          uint32_t memoryType, bool images,
+                          AllocationStrategy strategy)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Pool& pool = poolFor(memoryType, images, strategy);
+    auto  take = [this](MemoryBlock& block, VkDeviceSize offset,
+                       VkDeviceSize size)
+    {
+        ++stats_.subAllocations_;
+        stats_.usedBytes_ += size;
+        return MemoryAllocation {block.GetMemory(), offset, size,
+                                 block.MappedAt(offset), &block};
+    };
+
+    for (auto& block : pool.blocks_)
+        if (auto range =
+                block->Allocate(requirements.size, requirements.alignment))
+            return take(*block, range->first, range->second);
+
+    const VkDeviceSize blockSize = blockSizeFor(memoryType);
+    void*              mapped    = nullptr;
+    VkDeviceMemory memory = allocateMemory(blockSize, memoryType, nullptr, &mapped);
+    if (strategy == AllocationStrategy::Linear)
+        pool.blocks_.push_back(
+            std::make_unique<LinearBlock>(device_, memory, blockSize, mapped));
+    else
+        pool.blocks_.push_back(
+            std::make_unique<BuddyBlock>(device_, memory, blockSize, mapped));
+    ++stats_.blocks_;
+    stats_.reservedBytes_ += blockSize;
+    stats_.peakReservedBytes_ =
+        std::max(stats_.peakReservedBytes_, stats_.reservedBytes_);
+    LOG_TRACE_L1(logger_.get(), "New {} MB block for memory type {}",
+                 blockSize / (1024 * 1024), memoryType);
+
+    auto& block = *pool.blocks_.back();
+    auto  range = block.Allocate(requirements.size, requirements.alignment);
+    if (!range)
+        throw std::runtime_error("allocation does not fit a fresh block");
+    return take(block, range->first, range->second);
+}
+
+MemoryAllocation
+MemoryAllocator::allocateDedicated(const VkMemoryRequirements& requirements,
+                                   uint32_t memoryType, VkBuffer buffer,
+                                   VkImage image)
+{
+    VkMemoryDedicatedAllocateInfo dedicatedInfo {};
+    dedicatedInfo.sType  = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+    dedicatedInfo.pNext  = nullptr;
+    dedicatedInfo.buffer = buffer;
+    dedicatedInfo.image  = image;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    MemoryAllocation allocation;
+    allocation.memory_ = allocateMemory(requirements.size, memoryType,
+                                        &dedicatedInfo, &allocation.mapped_);
+    allocation.size_   = requirements.size;
+    ++stats_.dedicated_;
+    stats_.reservedBytes_ += requirements.size;
+    stats_.usedBytes_ += requirements.size;
+    stats_.peakReservedBytes_ =
+        std::max(stats_.peakReservedBytes_, stats_.reservedBytes_);
+    return allocation;
+}
+
+MemoryAllocator::Pool& MemoryAllocator::poolFor(uint32_t           memoryType,
+                                                bool               images,
+                                                AllocationStrategy strategy)
+{
+    for (auto& pool : pools_)
+        if (pool->memoryType_ == memoryType && pool->images_ == images &&
+            pool->strategy_ == strategy)
+            return *pool;
+
+    pools_.push_back(std::make_unique<Pool>(Pool {memoryType, images, strategy, {}}));
+    return *pools_.back();
+}
+
+VkDeviceMemory MemoryAllocator::allocateMemory(VkDeviceSize size,
+                                               uint32_t     memoryType,
+                                               const void*  pNext,
+                                               void**       mapped)
+{
+    VkMemoryAllocateInfo allocInfo {};
+    allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext           = pNext;
+    allocInfo.allocationSize  = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    if (vkAllocateMemory(device_, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate device memory!");
+    ++stats_.deviceAllocations_;
+
+    *mapped = nullptr;
+    if (memProperties_.memoryTypes[memoryType].propertyFlags &
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        if (vkMapMemory(device_, memory, 0, VK_WHOLE_SIZE, 0, mapped) !=
+            VK_SUCCESS)
+            {
+                vkFreeMemory(device_, memory, nullptr);
+                --stats_.deviceAllocations_;
+                throw std::runtime_error("failed to map device memory!");
+            }
+    return memory;
+}
+
+VkDeviceSize MemoryAllocator::blockSizeFor(uint32_t memoryType) const
+{
+    const VkDeviceSize heapSize =
+        memProperties_.memoryHeaps[memProperties_.memoryTypes[memoryType].heapIndex]
+            .size;
+    //Buddy blocks have to be a power of two
+    return std::min(maxBlockSize,
+                    std::bit_floor(std::max<VkDeviceSize>(heapSize / 8,
+                                                          minBuddySize)));
+}
+
+void MemoryAllocator::releaseEmptyBlock(MemoryBlock* block)
+{
+    for (auto& pool : pools_)
+        {
+            auto it = std::find_if(pool->blocks_.begin(), pool->blocks_.end(),
+                                   [block](const auto& candidate)
+                                   { return candidate.get() == block; });
+            if (it == pool->blocks_.end())
+                continue;
+
+            //One empty block per pool stays around to avoid churn
+            const bool otherEmpty = std::any_of(
+                pool->blocks_.begin(), pool->blocks_.end(),
+                [block](const auto& candidate)
+                { return candidate.get() != block && candidate->Empty(); });
+            if (!otherEmpty)
+                return;
+
+            stats_.reservedBytes_ -= block->GetSize();
+            --stats_.blocks_;
+            --stats_.deviceAllocations_;
+            pool->blocks_.erase(it);
+            return;
+        }
+}
+
+} // namespace Multor::Vulkan
@@ -0,0 +1,115 @@
+/// \file memory_allocator.h
+
+#pragma once
+
+#include "../logger/logger.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace Multor::Vulkan
+{
+
+class MemoryBlock;
+
+enum class AllocationStrategy
+{
+    //Power of two ranges merged back on free, for long lived resources
+    Buddy,
+    //Bump pointer reset once the block is empty, for staging data
+    Linear
+};
+
+/// \brief Sub-allocation handle. Resources own one of these instead of a
+/// VkDeviceMemory and return it to the allocator when destroyed.
+struct MemoryAllocation
+{
+    VkDeviceMemory memory_ = VK_NULL_HANDLE;
+    VkDeviceSize   offset_ = 0;
+    //Reserved size, may exceed the requested one
+    VkDeviceSize   size_   = 0;
+    //Host address of offset_ for host visible memory, null otherwise
+    void*          mapped_ = nullptr;
+    //Owning block, null for dedicated allocations
+    MemoryBlock*   block_  = nullptr;
+};
+
+struct MemoryStats
+{
+    //vkAllocateMemory calls alive, bounded by maxMemoryAllocationCount
+    uint32_t     deviceAllocations_ = 0;
+    uint32_t     blocks_            = 0;
+    uint32_t     dedicated_         = 0;
+    uint32_t     subAllocations_    = 0;
+    VkDeviceSize reservedBytes_     = 0;
+    VkDeviceSize usedBytes_         = 0;
+    VkDeviceSize peakReservedBytes_ = 0;
+};
+
+/// \brief Block based device memory allocator.
+///
+/// Keeps one pool per memory type, resource kind and strategy. Buffers and
+/// images never share a block, so bufferImageGranularity does not need to
+/// be honoured between neighbours. Large resources and images the driver
+/// prefers dedicated get a VkDeviceMemory of their own. Host visible
+/// blocks are mapped once for their whole lifetime.
+class MemoryAllocator
+{
+public:
+    MemoryAllocator(VkDevice device, VkPhysicalDevice physDev);
+    ~MemoryAllocator();
+
+    MemoryAllocator(const MemoryAllocator&)            = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+    /// \brief Allocates memory for \p buffer and binds it
+    MemoryAllocation
+    AllocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties,
+                   AllocationStrategy strategy = AllocationStrategy::Buddy);
+    /// \brief Allocates memory for \p image and binds it
+    MemoryAllocation AllocateImage(VkImage image,
+                                   VkMemoryPropertyFlags properties);
+    void Free(const MemoryAllocation& allocation);
+
+    MemoryStats GetStats() const;
+    uint32_t    FindMemoryType(uint32_t              typeFilter,
+                               VkMemoryPropertyFlags properties) const;
+
+private:
+    struct Pool
+    {
+        uint32_t           memoryType_;
+        bool               images_;
+        AllocationStrategy strategy_;
+        std::vector<std::unique_ptr<MemoryBlock> > blocks_;
+    };
+
+    MemoryAllocation allocate(const VkMemoryRequirements& requirements,
+                              uint32_t memoryType, bool images,
+                              AllocationStrategy strategy);
+    MemoryAllocation allocateDedicated(const VkMemoryRequirements& requirements,
+                                       uint32_t memoryType, VkBuffer buffer,
+                                       VkImage image);
+    Pool&          poolFor(uint32_t memoryType, bool images,
+                           AllocationStrategy strategy);
+    VkDeviceMemory allocateMemory(VkDeviceSize size, uint32_t memoryType,
+                                  const void* pNext, void** mapped);
+    VkDeviceSize   blockSizeFor(uint32_t memoryType) const;
+    void           releaseEmptyBlock(MemoryBlock* block);
+
+private:
+    Logging::Logger& logger_;
+
+    VkDevice                         device_;
+    VkPhysicalDeviceMemoryProperties memProperties_ {};
+
+    std::vector<std::unique_ptr<Pool> > pools_;
+    MemoryStats                         stats_;
+    mutable std::mutex                  mutex_;
+};
+
+} // namespace Multor::Vulkan
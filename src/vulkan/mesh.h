@@ -2,11 +2,13 @@
 
 #pragma once
 
-#include "objects/vertex_buffer.h"
+#include "geometry_pool.h"
 #include "structures/transform_ubo.h"
 #include "shader.h"
 #include "objects/texture.h"
+#include "../scene_objects/texture.h"
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -16,11 +18,18 @@ namespace Multor::Vulkan
 struct Mesh
 {
     /* Static object */
-    std::unique_ptr<VertexBuffer> vertBuffer_;
-    std::uint32_t                 indexesSize_;
-    std::unique_ptr<Buffer> indexBuffer_;
+    //Range of the shared vertex and index buffers
+    std::unique_ptr<MeshGeometry> geometry_;
     /* Textures */
     std::vector<std::shared_ptr<Texture> > textures_;
+    //Scene texture of each entry of textures_, placeholders are replaced
+    //once their source has streamed in
+    std::vector<std::shared_ptr<BaseTexture> > sources_;
+    //Upload semaphore value the buffers and textures are complete at
+    std::uint64_t                          uploadValue_ = 0;
+    //TextureTable slot of the diffuse texture, bindless shaders only
+    static constexpr std::uint32_t         noTextureSlot = UINT32_MAX;
+    std::uint32_t                          textureSlot_  = noTextureSlot;
     
     /*  Dynamic object  */
     std::shared_ptr<Shader> sh_;
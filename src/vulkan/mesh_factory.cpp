@@ -1,36 +1,37 @@
 /// \file mesh_factory.cpp
 
 #include "mesh_factory.h"
+#include "../logger/logger.h"
+
+#include <chrono>
 
 namespace Multor::Vulkan
 {
 
-std::unique_ptr<Mesh>
-MeshFactory::CreateMesh(std::unique_ptr<BaseMesh> mesh)
+namespace
 {
-    std::unique_ptr<Mesh> vk_mesh = std::make_unique<Mesh>();
 
-    constexpr VkDeviceSize MatBufObj   = sizeof(Material);
-    constexpr VkDeviceSize TransBufObj = sizeof(UBOs::Transform);
-    constexpr VkDeviceSize ViewBufObj  = sizeof(UBOs::ViewPosition);
+double elapsedMs(std::chrono::steady_clock::time_point from,
+                 std::chrono::steady_clock::time_point to)
+{
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
 
-    vk_mesh->vertBuffer_  = CreateVertexBuffer(mesh->GetVertexes());
-    vk_mesh->indexBuffer_ = CreateIndexBuffer(mesh->GetVertexes());
-    vk_mesh->indexesSize_ = static_cast<std::uint32_t>(mesh->GetVertexes()->GetIndices().size());
+double throughputMBs(VkDeviceSize bytes, double ms)
+{
+    return ms > 0 ? bytes / (ms * 1e3) : 0.0;
+}
 
-    auto [texBegin, texEnd] = mesh->GetTextures();
-    for (auto it = texBegin; it != texEnd; ++it)
-        {
-            if (!(*it))
-                continue;
+} // namespace
 
-            auto images = (*it)->GetImages();
-            if (images.empty() || !images[0])
-                continue;
+std::unique_ptr<Mesh>
+MeshFactory::CreateMesh(std::unique_ptr<BaseMesh> mesh)
+{
+    std::unique_ptr<Mesh> vk_mesh = std::make_unique<Mesh>();
+    lastUpload_                   = 0;
 
-            vk_mesh->textures_.push_back(
-                std::shared_ptr<Texture>(CreateTexture(images[0].get())));
-        }
+    createGeometry(*vk_mesh, *mesh);
+    createTextures(*vk_mesh, *mesh);
     /*
 	Vkmesh->matrixes_ = createBuffer(TransBufObj, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
@@ -42,38 +43,190 @@ MeshFactory::CreateMesh(std::unique_ptr<BaseMesh> mesh)
 	Vkmesh->viewPosUBO_ = createBuffer(ViewBufObj, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
 		VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);*/
+    vk_mesh->uploadValue_ = lastUpload_;
 
     return vk_mesh;
 }
 
+std::vector<std::unique_ptr<Mesh> >
+MeshFactory::CreateMeshes(std::vector<std::unique_ptr<BaseMesh> > meshes)
+{
+    Logging::Logger& logger = Logging::LoggerFactory::GetLogger("vulkan.log");
+
+    std::vector<std::unique_ptr<Mesh> > result;
+    result.reserve(meshes.size());
+    std::vector<BaseMesh*> sources;
+    sources.reserve(meshes.size());
+
+    //Geometry and textures are staged in separate passes, so the batch
+    //copies buffers first and transitions all images together
+    const auto   start         = std::chrono::steady_clock::now();
+    VkDeviceSize geometryBytes = 0;
+    for (auto& mesh : meshes)
+        {
+            if (!mesh)
+                continue;
+            result.push_back(std::make_unique<Mesh>());
+            geometryBytes += createGeometry(*result.back(), *mesh);
+            sources.push_back(mesh.get());
+        }
+
+    const auto   geometryEnd  = std::chrono::steady_clock::now();
+    VkDeviceSize textureBytes = 0;
+    pruneTextures();
+    for (std::size_t i = 0; i < result.size(); ++i)
+        textureBytes += createTextures(*result[i], *sources[i]);
+
+    const auto texturesEnd = std::chrono::steady_clock::now();
+    //Every copy of the call is complete once the last batch is
+    const uint64_t uploadValue = uploads_ ? uploads_->Flush() : 0;
+    for (auto& mesh : result)
+        mesh->uploadValue_ = uploadValue;
+    const auto submitEnd = std::chrono::steady_clock::now();
+
+    const double geometryMs = elapsedMs(start, geometryEnd);
+    const double texturesMs = elapsedMs(geometryEnd, texturesEnd);
+    LOG_INFO(logger.get(),
+             "Staged {} meshes: geometry {:.2f} MiB in {:.2f} ms ({:.1f} "
+             "MB/s), textures {:.2f} MiB in {:.2f} ms ({:.1f} MB/s), submit "
+             "{:.2f} ms, {} unique textures alive",
+             result.size(), geometryBytes / (1024.0 * 1024.0), geometryMs,
+             throughputMBs(geometryBytes, geometryMs),
+             textureBytes / (1024.0 * 1024.0), texturesMs,
+             throughputMBs(textureBytes, texturesMs),
+             elapsedMs(texturesEnd, submitEnd), textures_.size());
+
+    return result;
+}
+
 std::unique_ptr<TransformUBO>
-MeshFactory::CreateUBOBuffers(std::size_t nFrames)
+MeshFactory::CreateUBOBuffers(ObjectTable& objects)
 {
-    std::unique_ptr<TransformUBO> ubo = std::make_unique<TransformUBO>(dev_);
-    for (std::size_t i = 0; i < nFrames; ++i)
+    //Fresh slots start with identity matrices
+    return std::make_unique<TransformUBO>(objects);
+}
+
+VkDeviceSize MeshFactory::createGeometry(Mesh& vkMesh, BaseMesh& mesh)
+{
+    Vertexes* vert = mesh.GetVertexes();
+
+    if (!geometry_)
+        geometry_ = std::make_shared<GeometryPool>(dev_, allocator_,
+                                                   sharedFamilies_);
+
+    const auto& indices = vert->GetIndices();
+    vkMesh.geometry_ = geometry_->Allocate(
+        static_cast<std::uint32_t>(vert->GetSize()),
+        static_cast<std::uint32_t>(indices.size()));
+
+    const MeshGeometry& geometry   = *vkMesh.geometry_;
+    const VkDeviceSize  vertBytes  = sizeof(Vertex) * vert->GetSize();
+    const VkDeviceSize  indexBytes = sizeof(uint32_t) * indices.size();
+    uploadBuffer(geometry.vertexBuffer_, vert->GetVertexes(), vertBytes,
+                 sizeof(Vertex) * VkDeviceSize(geometry.baseVertex_));
+    uploadBuffer(geometry.indexBuffer_, indices.data(), indexBytes,
+                 sizeof(uint32_t) * VkDeviceSize(geometry.firstIndex_));
+
+    return vertBytes + indexBytes;
+}
+
+VkDeviceSize MeshFactory::createTextures(Mesh& vkMesh, BaseMesh& mesh)
+{
+    VkDeviceSize bytes = 0;
+
+    auto [texBegin, texEnd] = mesh.GetTextures();
+    for (auto it = texBegin; it != texEnd; ++it)
         {
-            ubo->matrixes_.push_back(CreateBuffer(
-                ubo->TransBufObj, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
-            ubo->viewPosUBO_.push_back(CreateBuffer(
-                ubo->ViewBufObj, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
-            /*
-		mesh->materialUBO_.push_back(MeshFac->createBuffer(MatBufObj, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
-
-		mesh->viewPosUBO_.push_back(MeshFac->createBuffer(ViewBufObj, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));*/
-            ubo->updateModel(i, glm::mat4(1.0f));
-            ubo->updatePV(i, glm::mat4(1.0f));
-            ubo->updateView(i, glm::vec3(0.0f));
+            if (!(*it))
+                continue;
+
+            if (auto texture = acquireTexture(*it, bytes))
+                {
+                    vkMesh.textures_.push_back(std::move(texture));
+                    vkMesh.sources_.push_back(*it);
+                }
         }
+    return bytes;
+}
+
+std::shared_ptr<Texture>
+MeshFactory::acquireTexture(const std::shared_ptr<BaseTexture>& source,
+                            VkDeviceSize&                       bytes)
+{
+    auto cached = textures_.find(source.get());
+    if (cached != textures_.end() &&
+        cached->second.source_.lock() == source)
+        if (auto texture = cached->second.texture_.lock())
+            return texture;
+
+    if (streaming_)
+        return streamer_->Request(source);
+
+    auto images = source->GetImages();
+    if (images.empty() || !images[0])
+        return nullptr;
 
-    return ubo;
+    std::shared_ptr<Texture> texture(CreateTexture(images, source->GetType()));
+    bytes += texture->bytes_;
+    textures_[source.get()] = {source, texture};
+    return texture;
+}
+
+void MeshFactory::SetStreaming(bool enabled)
+{
+    if (enabled && !streamer_)
+        streamer_ = std::make_unique<TextureStreamer>(*this);
+    streaming_ = enabled;
+}
+
+bool MeshFactory::RestreamTexture(const std::shared_ptr<BaseTexture>& source,
+                                  uint32_t                            skipLevels)
+{
+    if (!streamer_)
+        streamer_ = std::make_unique<TextureStreamer>(*this);
+    return streamer_->Restream(source, skipLevels);
+}
+
+bool MeshFactory::IsStreaming(const BaseTexture* source) const
+{
+    return streamer_ && streamer_->IsStreaming(source);
+}
+
+std::vector<std::pair<std::shared_ptr<BaseTexture>, std::shared_ptr<Texture> > >
+MeshFactory::GetTextures() const
+{
+    std::vector<std::pair<std::shared_ptr<BaseTexture>, std::shared_ptr<Texture> > >
+        textures;
+    textures.reserve(textures_.size());
+    for (const auto& [key, cached] : textures_)
+        {
+            auto source  = cached.source_.lock();
+            auto texture = cached.texture_.lock();
+            if (source && texture && source.get() == key)
+                textures.emplace_back(std::move(source), std::move(texture));
+        }
+    return textures;
+}
+
+std::vector<TextureStreamer::Arrival>
+MeshFactory::PollStreamedTextures(VkDeviceSize budget)
+{
+    if (!streamer_)
+        return {};
+
+    auto arrivals = streamer_->Poll(budget);
+    for (const auto& arrival : arrivals)
+        textures_[arrival.source_.get()] = {arrival.source_, arrival.texture_};
+    return arrivals;
+}
+
+void MeshFactory::pruneTextures()
+{
+    std::erase_if(textures_, [](const auto& entry)
+    {
+        return entry.second.source_.expired() ||
+               entry.second.texture_.expired();
+    });
 }
 
 } // namespace Multor::Vulkan
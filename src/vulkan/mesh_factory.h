@@ -8,6 +8,13 @@
 #include "objects/vertex.h"
 #include "texture_factory.h"
 #include "command_executer.h"
+#include "geometry_pool.h"
+#include "texture_streamer.h"
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
 
 namespace Multor::Vulkan
 {
@@ -21,7 +28,65 @@ public:
     {
     }
     std::unique_ptr<Mesh>       CreateMesh(std::unique_ptr<BaseMesh> mesh);
-    std::unique_ptr<TransformUBO> CreateUBOBuffers(std::size_t nFrames);
+    /// \brief Stages all copies of \p meshes and submits them together,
+    /// null entries are skipped
+    std::vector<std::unique_ptr<Mesh> >
+    CreateMeshes(std::vector<std::unique_ptr<BaseMesh> > meshes);
+    std::unique_ptr<TransformUBO> CreateUBOBuffers(ObjectTable& objects);
+
+    //Null until the first mesh is created
+    const std::shared_ptr<GeometryPool>& GetGeometryPool() const
+    {
+        return geometry_;
+    }
+
+    /// \brief Streams textures of meshes created afterwards in the
+    /// background, they sample placeholders until then. Textures already
+    /// requested keep streaming when this is turned off.
+    void SetStreaming(bool enabled);
+    bool IsStreamingEnabled() const { return streaming_; }
+    //Null until streaming is first enabled or a texture restreamed
+    TextureStreamer* GetStreamer() const { return streamer_.get(); }
+    /// \brief Streams the texture of \p source again without its first
+    /// \p skipLevels levels, see TextureStreamer::Restream
+    bool RestreamTexture(const std::shared_ptr<BaseTexture>& source,
+                         uint32_t                            skipLevels);
+    bool IsStreaming(const BaseTexture* source) const;
+    /// \brief Textures alive in the cache, with their sources
+    std::vector<std::pair<std::shared_ptr<BaseTexture>, std::shared_ptr<Texture> > >
+    GetTextures() const;
+    /// \brief Textures streamed in since the last call, see
+    /// TextureStreamer::Poll. They are shared with meshes created later.
+    std::vector<TextureStreamer::Arrival>
+    PollStreamedTextures(VkDeviceSize budget);
+
+private:
+    //Return the bytes uploaded for the mesh
+    VkDeviceSize createGeometry(Mesh& vkMesh, BaseMesh& mesh);
+    VkDeviceSize createTextures(Mesh& vkMesh, BaseMesh& mesh);
+    /// \brief Texture of \p source, uploaded on first use or a placeholder
+    /// while it streams. Adds the bytes uploaded to \p bytes.
+    std::shared_ptr<Texture>
+    acquireTexture(const std::shared_ptr<BaseTexture>& source,
+                   VkDeviceSize&                       bytes);
+    void pruneTextures();
+
+    //Created lazily, so it shares its buffers with the upload queue family
+    std::shared_ptr<GeometryPool> geometry_;
+
+    struct CachedTexture
+    {
+        //Guards against a new BaseTexture at the address of a freed one
+        std::weak_ptr<BaseTexture> source_;
+        std::weak_ptr<Texture>     texture_;
+    };
+    //Meshes sharing a BaseTexture share its GPU copy, which is released
+    //with the last mesh holding it
+    std::map<const BaseTexture*, CachedTexture> textures_;
+
+    bool streaming_ = false;
+    //Last member, its workers prepare textures through this factory
+    std::unique_ptr<TextureStreamer> streamer_;
 };
 
 } // namespace Multor::Vulkan
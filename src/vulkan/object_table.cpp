@@ -0,0 +1,110 @@
+/// \file object_table.cpp
+
+#include "object_table.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Multor::Vulkan
+{
+
+ObjectTable::ObjectTable(UniformRing& ring, uint32_t capacity)
+    : ring_(ring),
+      range_(ring.Allocate(sizeof(UBOs::ObjectRecord) *
+                           std::max(capacity, 1u))),
+      capacity_(std::max(capacity, 1u)),
+      records_(capacity_),
+      staleSegments_(capacity_, 0)
+{
+    if (ring_.GetSegmentCount() > 32)
+        throw std::runtime_error("object table supports up to 32 segments");
+}
+
+ObjectTable::~ObjectTable()
+{
+    ring_.Free(range_);
+}
+
+uint32_t ObjectTable::Allocate()
+{
+    uint32_t slot = 0;
+    if (!freeSlots_.empty())
+        {
+            slot = freeSlots_.back();
+            freeSlots_.pop_back();
+        }
+    else if (nextSlot_ < capacity_)
+        slot = nextSlot_++;
+    else
+        throw std::runtime_error("object table is exhausted");
+
+    records_[slot] = UBOs::ObjectRecord {};
+    markDirty(slot);
+    return slot;
+}
+
+void ObjectTable::Free(uint32_t slot)
+{
+    if (slot >= capacity_)
+        throw std::out_of_range("object slot out of range");
+    freeSlots_.push_back(slot);
+}
+
+void ObjectTable::Update(uint32_t slot, const glm::mat4& model)
+{
+    if (slot >= capacity_)
+        throw std::out_of_range("object slot out of range");
+
+    records_[slot].model_        = model;
+    records_[slot].normalMatrix_ = glm::transpose(glm::inverse(model));
+    markDirty(slot);
+}
+
+void ObjectTable::SetTexture(uint32_t slot, uint32_t texture)
+{
+    if (slot >= capacity_)
+        throw std::out_of_range("object slot out of range");
+
+    records_[slot].meta_.y = static_cast<int32_t>(texture);
+    markDirty(slot);
+}
+
+const glm::mat4& ObjectTable::GetModel(uint32_t slot) const
+{
+    return records_.at(slot).model_;
+}
+
+void ObjectTable::Flush(uint32_t segment)
+{
+    const uint32_t bit = 1u << segment;
+    auto           out = dirtySlots_.begin();
+    for (const uint32_t slot : dirtySlots_)
+        {
+            if (staleSegments_[slot] & bit)
+                {
+                    ring_.Write(segment, range_, &records_[slot],
+                                sizeof(UBOs::ObjectRecord),
+                                slot * sizeof(UBOs::ObjectRecord));
+                    staleSegments_[slot] &= ~bit;
+                }
+            //Keep the slot listed until every segment has its copy
+            if (staleSegments_[slot] != 0)
+                *out++ = slot;
+        }
+    dirtySlots_.erase(out, dirtySlots_.end());
+}
+
+VkDescriptorBufferInfo ObjectTable::DescriptorInfo(uint32_t segment) const
+{
+    return ring_.DescriptorInfo(segment, range_);
+}
+
+void ObjectTable::markDirty(uint32_t slot)
+{
+    if (staleSegments_[slot] == 0)
+        dirtySlots_.push_back(slot);
+    const uint32_t segments = ring_.GetSegmentCount();
+    staleSegments_[slot] = segments >= 32 ? ~0u : (1u << segments) - 1u;
+}
+
+} // namespace Multor::Vulkan
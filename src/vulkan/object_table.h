@@ -0,0 +1,72 @@
+/// \file object_table.h
+
+#pragma once
+
+#include "uniform_ring.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+namespace Multor::Vulkan
+{
+
+namespace UBOs
+{
+//Matches ObjectRecord of the std430 Objects buffer in Base.vs
+struct ObjectRecord
+{
+    alignas(16) glm::mat4 model_ {1.0f};
+    alignas(16) glm::mat4 normalMatrix_ {1.0f};
+    //x = material index, y = diffuse slot in the TextureTable,
+    //zw = reserved
+    alignas(16) glm::ivec4 meta_ {};
+};
+} // namespace UBOs
+
+/// \brief Packed array of per object records living in one range of the
+/// uniform ring, bound as a storage buffer once per frame.
+///
+/// Draws select their record through firstInstance. Records are kept on
+/// the CPU and copied into a frame segment only while that segment still
+/// holds an older version of them.
+class ObjectTable
+{
+public:
+    ObjectTable(UniformRing& ring, uint32_t capacity);
+    ~ObjectTable();
+
+    ObjectTable(const ObjectTable&)            = delete;
+    ObjectTable& operator=(const ObjectTable&) = delete;
+
+    uint32_t Allocate();
+    void     Free(uint32_t slot);
+
+    void Update(uint32_t slot, const glm::mat4& model);
+    void SetTexture(uint32_t slot, uint32_t texture);
+    const glm::mat4& GetModel(uint32_t slot) const;
+    /// \brief Copies records changed since the last flush of \p segment
+    void Flush(uint32_t segment);
+
+    VkDescriptorBufferInfo DescriptorInfo(uint32_t segment) const;
+    uint32_t GetCapacity() const { return capacity_; }
+
+private:
+    void markDirty(uint32_t slot);
+
+private:
+    UniformRing& ring_;
+    UniformRange range_;
+    uint32_t     capacity_;
+    uint32_t     nextSlot_ = 0;
+
+    std::vector<UBOs::ObjectRecord> records_;
+    //Bit per frame segment still holding an outdated copy of the record
+    std::vector<uint32_t> staleSegments_;
+    std::vector<uint32_t> dirtySlots_;
+    std::vector<uint32_t> freeSlots_;
+};
+
+} // namespace Multor::Vulkan
@@ -2,6 +2,10 @@
 
 #pragma once
 
+#include "../memory_allocator.h"
+
+#include <memory>
+
 #include <vulkan/vulkan.h>
 
 namespace Multor::Vulkan
@@ -11,13 +15,15 @@ struct Buffer
 {
     //Buffer(VkDevice dev, VkBuffer buf, VkDeviceMemory bufmem) :dev_(dev), buffer_(buf), bufferMemory_(bufmem) {}
     //Buffer(Buffer&& _r) :dev_(_r.dev_), buffer_(_r.buffer_), bufferMemory_(_r.bufferMemory_) {}
-    VkDevice       dev_;
-    VkBuffer       buffer_;
-    VkDeviceMemory bufferMemory_;
+    VkDevice                         dev_    = VK_NULL_HANDLE;
+    VkBuffer                         buffer_ = VK_NULL_HANDLE;
+    MemoryAllocation                 allocation_;
+    std::shared_ptr<MemoryAllocator> allocator_;
     ~Buffer()
     {
         vkDestroyBuffer(dev_, buffer_, nullptr);
-        vkFreeMemory(dev_, bufferMemory_, nullptr);
+        if (allocator_)
+            allocator_->Free(allocation_);
     }
 };
 
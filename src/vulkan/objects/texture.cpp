@@ -7,14 +7,14 @@ namespace Multor::Vulkan
 
 Texture::~Texture()
 {
-    vkDestroySampler(dev_, sampler_, nullptr);
     vkDestroyImageView(dev_, view_, nullptr);
     vkDestroyImage(dev_, img_, nullptr);
-    vkFreeMemory(dev_, devMem_, nullptr);
+    if (allocator_)
+        allocator_->Free(allocation_);
     sampler_ = VK_NULL_HANDLE;
     view_    = VK_NULL_HANDLE;
     img_     = VK_NULL_HANDLE;
-    devMem_  = VK_NULL_HANDLE;
+    allocation_ = {};
 }
 
 } // namespace Multor::Vulkan
\ No newline at end of file
@@ -2,6 +2,11 @@
 
 #pragma once
 
+#include "../memory_allocator.h"
+#include "../sampler_cache.h"
+
+#include <memory>
+
 #include <vulkan/vulkan.h>
 
 namespace Multor::Vulkan
@@ -9,11 +14,26 @@ namespace Multor::Vulkan
 
 struct Texture
 {
-    VkDevice       dev_;
-    VkImage        img_;
-    VkImageView    view_;
-    VkSampler      sampler_;
-    VkDeviceMemory devMem_;
+    VkDevice                         dev_     = VK_NULL_HANDLE;
+    VkImage                          img_     = VK_NULL_HANDLE;
+    VkImageView                      view_    = VK_NULL_HANDLE;
+    VkFormat                         format_  = VK_FORMAT_UNDEFINED;
+    uint32_t                         mipLevels_ = 1;
+    //Texel data of all levels
+    VkDeviceSize                     bytes_   = 0;
+    //Stand-in sampled while the texture streams in
+    bool                             placeholder_ = false;
+    //Top levels of the source left out to stay within the texture budget
+    uint32_t                         skippedLevels_ = 0;
+    //Frame the texture was last drawn in and its camera distance then,
+    //kept by TextureResidency
+    uint64_t                         lastUsed_ = 0;
+    float                            distance_ = 0.0f;
+    //Owned by samplers_
+    VkSampler                        sampler_ = VK_NULL_HANDLE;
+    std::shared_ptr<SamplerCache>    samplers_;
+    MemoryAllocation                 allocation_;
+    std::shared_ptr<MemoryAllocator> allocator_;
     ~Texture();
 };
 
@@ -0,0 +1,203 @@
+/// \file parallel_recorder.cpp
+
+#include "parallel_recorder.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Multor::Vulkan
+{
+
+ParallelRecorder::ParallelRecorder(VkDevice device, uint32_t queueFamily,
+                                   uint32_t slots, uint32_t workers)
+    : device_(device), slots_(slots), workers_(workers)
+{
+    if (workers_ == 0)
+        workers_ = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+
+    pools_.resize(static_cast<std::size_t>(slots_) * (workers_ + 1));
+    for (Pool& p : pools_)
+        {
+            VkCommandPoolCreateInfo poolInfo {};
+            poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.pNext            = nullptr;
+            poolInfo.queueFamilyIndex = queueFamily;
+            poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            if (vkCreateCommandPool(device_, &poolInfo, nullptr, &p.pool_) !=
+                VK_SUCCESS)
+                throw std::runtime_error("failed to create recording command pool!");
+        }
+
+    threads_.reserve(workers_);
+    for (uint32_t i = 0; i < workers_; ++i)
+        threads_.emplace_back(&ParallelRecorder::workerLoop, this, i);
+}
+
+ParallelRecorder::~ParallelRecorder()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_)
+        thread.join();
+
+    //Frees every command buffer of the pools as well
+    for (Pool& p : pools_)
+        vkDestroyCommandPool(device_, p.pool_, nullptr);
+}
+
+void ParallelRecorder::Reset(uint32_t slot)
+{
+    for (uint32_t thread = 0; thread <= workers_; ++thread)
+        {
+            Pool& p = pool(slot, thread);
+            if (p.used_ == 0)
+                continue;
+            vkResetCommandPool(device_, p.pool_, 0);
+            p.used_ = 0;
+        }
+}
+
+void ParallelRecorder::Split(std::vector<Job>& jobs, std::size_t count,
+                             const VkCommandBufferInheritanceInfo& inheritance,
+                             std::size_t pass) const
+{
+    const std::size_t threads = workers_ + 1;
+    const std::size_t size =
+        std::max(minJobSize_, (count + threads - 1) / threads);
+    for (std::size_t begin = 0; begin < count; begin += size)
+        jobs.push_back({inheritance, pass, begin, std::min(begin + size, count)});
+}
+
+std::vector<VkCommandBuffer>
+ParallelRecorder::Record(uint32_t slot, const std::vector<Job>& jobs,
+                         const RecordFunc& record, VkCommandBufferUsageFlags usage)
+{
+    std::vector<VkCommandBuffer> result(jobs.size(), VK_NULL_HANDLE);
+    if (jobs.empty())
+        return result;
+
+    jobs_   = &jobs;
+    record_ = &record;
+    out_    = &result;
+    slot_   = slot;
+    usage_  = usage;
+    error_  = nullptr;
+    nextJob_.store(0);
+
+    //Waking the workers costs more than a single job
+    if (jobs.size() == 1 || workers_ == 0)
+        runJobs(workers_);
+    else
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                busy_ = workers_;
+                ++generation_;
+            }
+            wake_.notify_all();
+            runJobs(workers_);
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [this]() { return busy_ == 0; });
+        }
+
+    if (error_)
+        std::rethrow_exception(error_);
+    return result;
+}
+
+VkCommandBuffer
+ParallelRecorder::BeginSecondary(uint32_t slot,
+                                 const VkCommandBufferInheritanceInfo& inheritance,
+                                 VkCommandBufferUsageFlags usage)
+{
+    return begin(pool(slot, workers_), inheritance, usage);
+}
+
+ParallelRecorder::Pool& ParallelRecorder::pool(uint32_t slot, uint32_t thread)
+{
+    if (slot >= slots_)
+        throw std::out_of_range("recording slot out of range");
+    return pools_[static_cast<std::size_t>(slot) * (workers_ + 1) + thread];
+}
+
+VkCommandBuffer
+ParallelRecorder::begin(Pool& p, const VkCommandBufferInheritanceInfo& inheritance,
+                        VkCommandBufferUsageFlags usage)
+{
+    if (p.used_ == p.buffers_.size())
+        {
+            VkCommandBufferAllocateInfo allocInfo {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.pNext = nullptr;
+            allocInfo.commandPool        = p.pool_;
+            allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 1;
+
+            VkCommandBuffer cmd = VK_NULL_HANDLE;
+            if (vkAllocateCommandBuffers(device_, &allocInfo, &cmd) != VK_SUCCESS)
+                throw std::runtime_error(
+                    "failed to allocate secondary command buffer!");
+            p.buffers_.push_back(cmd);
+        }
+    VkCommandBuffer cmd = p.buffers_[p.used_++];
+
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.pNext = nullptr;
+    beginInfo.flags = usage | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+    if (vkBeginCommandBuffer(cmd, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("failed to begin secondary command buffer!");
+    return cmd;
+}
+
+void ParallelRecorder::workerLoop(uint32_t worker)
+{
+    uint64_t seen = 0;
+    for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock,
+                           [&]() { return stop_ || generation_ != seen; });
+                if (stop_)
+                    return;
+                seen = generation_;
+            }
+
+            runJobs(worker);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--busy_ == 0)
+                done_.notify_one();
+        }
+}
+
+void ParallelRecorder::runJobs(uint32_t thread)
+{
+    Pool& p = pool(slot_, thread);
+    for (std::size_t i = nextJob_++; i < jobs_->size(); i = nextJob_++)
+        {
+            try
+                {
+                    VkCommandBuffer cmd = begin(p, (*jobs_)[i].inheritance_, usage_);
+                    (*record_)(cmd, (*jobs_)[i]);
+                    if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+                        throw std::runtime_error(
+                            "failed to record secondary command buffer!");
+                    (*out_)[i] = cmd;
+                }
+            catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (!error_)
+                        error_ = std::current_exception();
+                }
+        }
+}
+
+} // namespace Multor::Vulkan
@@ -0,0 +1,118 @@
+/// \file parallel_recorder.h
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace Multor::Vulkan
+{
+
+/// \brief Records secondary command buffers on a set of worker threads.
+///
+/// Draw lists are split into contiguous ranges (jobs), each recorded into
+/// its own secondary command buffer by whichever thread picks it up; the
+/// calling thread records too. Every thread owns one command pool per
+/// slot, so no pool is ever used by two threads. A slot has to be Reset
+/// before reuse, once the GPU is done with the buffers recorded into it.
+/// Buffers recorded without ONE_TIME_SUBMIT may be submitted again until
+/// then.
+class ParallelRecorder
+{
+public:
+    struct Job
+    {
+        VkCommandBufferInheritanceInfo inheritance_;
+        //Render pass instance the job draws into
+        std::size_t pass_;
+        //Range of the draw list recorded by the job
+        std::size_t begin_;
+        std::size_t end_;
+    };
+
+    using RecordFunc = std::function<void(VkCommandBuffer, const Job&)>;
+
+    /// \param workers Threads besides the caller, one less than the
+    /// hardware threads if 0
+    ParallelRecorder(VkDevice device, uint32_t queueFamily, uint32_t slots,
+                     uint32_t workers = 0);
+    ~ParallelRecorder();
+
+    ParallelRecorder(const ParallelRecorder&)            = delete;
+    ParallelRecorder& operator=(const ParallelRecorder&) = delete;
+
+    /// \brief Makes the command buffers of \p slot available again
+    void Reset(uint32_t slot);
+    /// \brief Appends jobs covering \p count draws of render pass instance
+    /// \p pass to \p jobs
+    void Split(std::vector<Job>& jobs, std::size_t count,
+               const VkCommandBufferInheritanceInfo& inheritance,
+               std::size_t pass) const;
+    /// \brief Records every job, blocks until all are done
+    /// \return Ended secondary command buffers in job order
+    std::vector<VkCommandBuffer>
+    Record(uint32_t slot, const std::vector<Job>& jobs, const RecordFunc& record,
+           VkCommandBufferUsageFlags usage =
+               VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    /// \brief Begins a secondary command buffer of the calling thread,
+    /// the caller records and ends it
+    VkCommandBuffer
+    BeginSecondary(uint32_t slot, const VkCommandBufferInheritanceInfo& inheritance,
+                   VkCommandBufferUsageFlags usage =
+                       VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+    uint32_t GetSlotCount() const { return slots_; }
+    uint32_t GetWorkerCount() const { return workers_; }
+
+private:
+    struct Pool
+    {
+        VkCommandPool                pool_ = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> buffers_;
+        std::size_t                  used_ = 0;
+    };
+
+    Pool&           pool(uint32_t slot, uint32_t thread);
+    VkCommandBuffer begin(Pool& pool,
+                          const VkCommandBufferInheritanceInfo& inheritance,
+                          VkCommandBufferUsageFlags usage);
+    void            workerLoop(uint32_t worker);
+    void            runJobs(uint32_t thread);
+
+private:
+    //Draws below this are not worth another command buffer
+    static constexpr std::size_t minJobSize_ = 64;
+
+    VkDevice device_;
+    uint32_t slots_;
+    uint32_t workers_;
+    //workers_ + 1 pools per slot, the last one belongs to the caller
+    std::vector<Pool>        pools_;
+    std::vector<std::thread> threads_;
+
+    std::mutex              mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    //Work of the running Record call
+    const std::vector<Job>*       jobs_   = nullptr;
+    const RecordFunc*             record_ = nullptr;
+    std::vector<VkCommandBuffer>* out_    = nullptr;
+    uint32_t                      slot_   = 0;
+    VkCommandBufferUsageFlags     usage_  = 0;
+    std::atomic<std::size_t>      nextJob_ {0};
+    uint32_t                      busy_       = 0;
+    uint64_t                      generation_ = 0;
+    bool                          stop_       = false;
+    std::exception_ptr            error_;
+};
+
+} // namespace Multor::Vulkan
@@ -0,0 +1,155 @@
+/// \file pipeline_cache.cpp
+
+#include "pipeline_cache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Multor::Vulkan
+{
+
+namespace
+{
+
+std::string toHex(const uint8_t* data, std::size_t size)
+{
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string           result;
+    result.reserve(size * 2);
+    for (std::size_t i = 0; i < size; ++i)
+        {
+            result.push_back(digits[data[i] >> 4]);
+            result.push_back(digits[data[i] & 0xF]);
+        }
+    return result;
+}
+
+} // namespace
+
+PipelineCache::PipelineCache(VkDevice device, VkPhysicalDevice physDev,
+                             const std::filesystem::path& directory)
+    : logger_(Logging::LoggerFactory::GetLogger("vulkan.log")), device_(device)
+{
+    VkPhysicalDeviceIDProperties idProperties {};
+    idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &idProperties;
+    vkGetPhysicalDeviceProperties2(physDev, &properties);
+    properties_ = properties.properties;
+
+    char ids[32];
+    std::snprintf(ids, sizeof(ids), "%04x_%04x_", properties_.vendorID,
+                  properties_.deviceID);
+    path_ = directory / ("pipelines_" + std::string(ids) +
+                         toHex(idProperties.driverUUID, VK_UUID_SIZE) + ".bin");
+
+    std::vector<char> data;
+    std::ifstream     file(path_, std::ios::binary);
+    if (file)
+        data.assign(std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+    if (!data.empty() && !validateHeader(data))
+        {
+            LOG_WARNING(logger_.get(), "Ignoring invalid pipeline cache {}",
+                        path_.string());
+            data.clear();
+        }
+
+    VkPipelineCacheCreateInfo createInfo {};
+    createInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.pNext           = nullptr;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData    = data.empty() ? nullptr : data.data();
+    if (vkCreatePipelineCache(device_, &createInfo, nullptr, &cache_) !=
+        VK_SUCCESS)
+        throw std::runtime_error("failed to create pipeline cache!");
+
+    warm_ = !data.empty();
+    LOG_INFO(logger_.get(), "Pipeline cache {}: {} bytes loaded",
+             path_.string(), data.size());
+}
+
+PipelineCache::~PipelineCache()
+{
+    try
+        {
+            Save();
+        }
+    catch (const std::exception& err)
+        {
+            LOG_ERROR(logger_.get(), "Failed to save pipeline cache: {}",
+                      err.what());
+        }
+    vkDestroyPipelineCache(device_, cache_, nullptr);
+}
+
+VkPipeline
+PipelineCache::CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& info,
+                                      std::string_view                    name)
+{
+    const auto start    = std::chrono::steady_clock::now();
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(device_, cache_, 1, &info, nullptr,
+                                  &pipeline) != VK_SUCCESS)
+        throw std::runtime_error("failed to create " + std::string(name) +
+                                 " pipeline!");
+
+    LOG_INFO(logger_.get(), "Created {} pipeline in {:.3f} ms ({} cache)", name,
+             std::chrono::duration<double, std::milli>(
+                 std::chrono::steady_clock::now() - start)
+                 .count(),
+             warm_ ? "warm" : "cold");
+    return pipeline;
+}
+
+void PipelineCache::Save()
+{
+    std::size_t size = 0;
+    if (vkGetPipelineCacheData(device_, cache_, &size, nullptr) != VK_SUCCESS ||
+        size == 0)
+        return;
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(device_, cache_, &size, data.data()) !=
+        VK_SUCCESS)
+        throw std::runtime_error("failed to read pipeline cache data!");
+    data.resize(size);
+
+    //Written aside and renamed, a crash never leaves half a file behind
+    std::filesystem::create_directories(path_.parent_path());
+    std::filesystem::path temp = path_;
+    temp += ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        if (!file.write(data.data(), static_cast<std::streamsize>(size)))
+            throw std::runtime_error("failed to write " + temp.string());
+    }
+    std::filesystem::rename(temp, path_);
+
+    LOG_INFO(logger_.get(), "Saved {} bytes of pipeline cache to {}", size,
+             path_.string());
+}
+
+bool PipelineCache::validateHeader(const std::vector<char>& data) const
+{
+    VkPipelineCacheHeaderVersionOne header {};
+    if (data.size() < sizeof(header))
+        return false;
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    return header.headerSize >= sizeof(header) &&
+           header.headerSize <= data.size() &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID == properties_.vendorID &&
+           header.deviceID == properties_.deviceID &&
+           std::memcmp(header.pipelineCacheUUID, properties_.pipelineCacheUUID,
+                       VK_UUID_SIZE) == 0;
+}
+
+} // namespace Multor::Vulkan
@@ -0,0 +1,58 @@
+/// \file pipeline_cache.h
+
+#pragma once
+
+#include "../logger/logger.h"
+
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace Multor::Vulkan
+{
+
+/// \brief VkPipelineCache shared by every pipeline of the device and kept
+/// on disk between runs.
+///
+/// The file name carries vendor ID, device ID and driver UUID, so
+/// different GPUs and driver versions never read each other's data. The
+/// header of a loaded file is validated as well, a mismatching or broken
+/// file is ignored and overwritten on Save.
+class PipelineCache
+{
+public:
+    PipelineCache(VkDevice device, VkPhysicalDevice physDev,
+                  const std::filesystem::path& directory);
+    /// \brief Saves the cache, the device has to be alive
+    ~PipelineCache();
+
+    PipelineCache(const PipelineCache&)            = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+
+    VkPipelineCache Get() const { return cache_; }
+    //Whether data of a previous run was loaded
+    bool IsWarm() const { return warm_; }
+
+    /// \brief Creates a graphics pipeline through the cache, its creation
+    /// time is logged under \p name
+    VkPipeline CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& info,
+                                      std::string_view name);
+    /// \brief Writes the cache data to its file
+    void Save();
+
+private:
+    bool validateHeader(const std::vector<char>& data) const;
+
+private:
+    Logging::Logger& logger_;
+
+    VkDevice                   device_;
+    VkPhysicalDeviceProperties properties_ {};
+    std::filesystem::path      path_;
+    VkPipelineCache            cache_ = VK_NULL_HANDLE;
+    bool                       warm_  = false;
+};
+
+} // namespace Multor::Vulkan
@@ -3,9 +3,12 @@
 #include "renderer.h"
 
 #include <chrono>
+#include <tuple>
 #include <cstring>
+#include <filesystem>
 #include <functional>
 #include <unordered_map>
+#include <utility>
 
 namespace Multor::Vulkan
 {
@@ -15,16 +18,40 @@ Renderer::Renderer(std::shared_ptr<Window> pWnd)
     , logger_(Logging::LoggerFactory::GetLogger("vulkan.log"))
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
-    
+
+    controller_ = _pWnd->GetController();
+    init();
+}
+
+Renderer::Renderer(std::shared_ptr<PositionController> contr,
+                   VkExtent2D                          extent)
+    : FrameChain(extent)
+    , logger_(Logging::LoggerFactory::GetLogger("vulkan.log"))
+    , controller_(std::move(contr))
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    init();
+}
+
+void Renderer::init()
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
     shFactory_   = std::make_unique<ShaderFactory>(device);
-    shadowResources_ = std::make_unique<ShadowResources>(device, physicDev);
+    residency_   = std::make_unique<TextureResidency>(*meshFactory_);
+    bindlessCapacity_ =
+        std::min(bindlessCapacity_, TextureTable::MaxCapacity(physicDev));
+    shadowResources_ = std::make_unique<ShadowResources>(
+        device, physicDev, meshFactory_->GetSamplerCache());
     directionalShadowMaps_ =
         shadowResources_->CreateDirectionalShadowArray();
     pointShadowMaps_ = shadowResources_->CreatePointShadowCubeArray();
     shadowPass_ =
         std::make_unique<ShadowPass>(device, directionalShadowMaps_.format_);
     shadowRenderer_ =
-        std::make_unique<ShadowRenderer>(device, commandPool, graphicsQueue, executer_);
+        std::make_unique<ShadowRenderer>(device, commandPool, graphicsQueue, executer_,
+                                         pipelineCache_);
     shadowPass_->BuildFramebuffers(*shadowResources_, directionalShadowMaps_,
                                    pointShadowMaps_);
     executer_->TransitionImageLayoutLayers(
@@ -35,18 +62,24 @@ Renderer::Renderer(std::shared_ptr<Window> pWnd)
         pointShadowMaps_.image_, pointShadowMaps_.format_,
         VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0,
         pointShadowMaps_.layers_);
-    activeShader_ =
-        CreateShaderFromFiles("../../shaders/Base.vs", "../../shaders/Base.frag");
-    shadowDirectionalShader_ = CreateShaderFromFiles(
-        "../../shaders/ShadowDirectional.vs",
-        "../../shaders/ShadowDirectional.frag");
+    //Both sets compile concurrently
+    auto mainShader = shFactory_->CreateShaderAsync(
+        loadShaderSource(mainShaderFiles_.vertex_),
+        loadShaderSource(mainShaderFiles_.fragment_));
+    auto shadowShader = shFactory_->CreateShaderAsync(
+        LoadTextFile(shadowShaderFiles_.vertex_),
+        LoadTextFile(shadowShaderFiles_.fragment_));
+    activeShader_            = mainShader.get();
+    shadowDirectionalShader_ = shadowShader.get();
+    shaders_.push_back(activeShader_);
+    shaders_.push_back(shadowDirectionalShader_);
 
     createDescriptorSetLayout();
     createShadowPipeline();
     createGraphicsPipeline();
-    createDescriptorPool();
-    createDescriptorSets();
     createUniformBuffers();
+    createDescriptorAllocators();
+    createDescriptorSets();
     createCommandBuffers();
     createSyncObjects();
     shadowCommandBuffersInFlight_.assign(maxFramesInFlight_, VK_NULL_HANDLE);
@@ -125,6 +158,87 @@ bool Renderer::IsShadowsEnabled() const
     return shadowsEnabled_;
 }
 
+void Renderer::SetIndirectDrawsEnabled(bool enabled)
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    if (enabled)
+        {
+            VkPhysicalDeviceFeatures features {};
+            vkGetPhysicalDeviceFeatures(physicDev, &features);
+            if (!features.multiDrawIndirect ||
+                !features.drawIndirectFirstInstance)
+                {
+                    LOG_WARNING(logger_.get(),
+                                "Indirect draws are not supported by the device");
+                    enabled = false;
+                }
+        }
+    if (indirectDraws_ == enabled)
+        return;
+    indirectDraws_ = enabled;
+    invalidateCommandBuffers();
+}
+
+bool Renderer::IsIndirectDrawsEnabled() const
+{
+    return indirectDraws_;
+}
+
+void Renderer::SetTextureCompressionEnabled(bool enabled)
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    if (!meshFactory_->SetCompression(enabled))
+        LOG_WARNING(logger_.get(),
+                    "Texture compression is not supported by the device");
+}
+
+bool Renderer::IsTextureCompressionEnabled() const
+{
+    return meshFactory_->IsCompressionEnabled();
+}
+
+void Renderer::SetTextureStreamingEnabled(bool enabled)
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    meshFactory_->SetStreaming(enabled);
+}
+
+bool Renderer::IsTextureStreamingEnabled() const
+{
+    return meshFactory_->IsStreamingEnabled();
+}
+
+TextureStreamingStats Renderer::GetTextureStreamingStats() const
+{
+    const TextureStreamer* streamer = meshFactory_->GetStreamer();
+    return streamer ? streamer->GetStats() : TextureStreamingStats {};
+}
+
+void Renderer::SetTextureBudget(VkDeviceSize bytes)
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    residency_->SetBudget(bytes);
+}
+
+TextureResidencyStats Renderer::GetTextureResidencyStats() const
+{
+    return residency_->GetStats();
+}
+
+void Renderer::SetPresentMode(VkPresentModeKHR mode)
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    if (headless_ || preferredPresentMode_ == mode)
+        return;
+    preferredPresentMode_ = mode;
+    Update();
+}
+
 const std::vector<std::shared_ptr<Multor::BLight> >& Renderer::GetLights() const
 {
     return lights_;
@@ -163,6 +277,8 @@ void Renderer::UseShader(const std::shared_ptr<ShaderLayout>& shader)
     if (shader->GetStages()->empty())
         throw std::runtime_error("shader layout has no stages");
 
+    //An explicitly chosen shader wins over a reload of the edited files
+    discardShaderReload(false);
     activeShader_ = shader;
 
     for (auto& mesh : meshes_)
@@ -170,7 +286,18 @@ void Renderer::UseShader(const std::shared_ptr<ShaderLayout>& shader)
 
     vkDeviceWaitIdle(device);
     clearIncludePart();
+    //Sets of the previous layouts, the new shader gets fresh ones
+    frameSets_.reset();
+    meshSets_.reset();
+    textureTable_.reset();
+    for (auto& mesh : meshes_)
+        mesh->textureSlot_ = Mesh::noTextureSlot;
 
+    if (frameSetLayout_ != VK_NULL_HANDLE)
+        {
+            vkDestroyDescriptorSetLayout(device, frameSetLayout_, nullptr);
+            frameSetLayout_ = VK_NULL_HANDLE;
+        }
     if (descriptorSetLayout_ != VK_NULL_HANDLE)
         {
             vkDestroyDescriptorSetLayout(device, descriptorSetLayout_, nullptr);
@@ -190,11 +317,275 @@ void Renderer::UseShader(const std::shared_ptr<ShaderLayout>& shader)
     createShadowPipeline();
     createGraphicsPipeline();
     createUniformBuffers();
-    createDescriptorPool();
+    createDescriptorAllocators();
     createDescriptorSets();
     createCommandBuffers();
 }
 
+void Renderer::SetShaderHotReloadEnabled(bool enabled)
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    if (!enabled)
+        {
+            shaderWatcher_.reset();
+            return;
+        }
+    if (shaderWatcher_)
+        return;
+    shaderWatcher_ = std::make_unique<FileWatcher>();
+    for (const auto* files : {&mainShaderFiles_, &shadowShaderFiles_})
+        {
+            shaderWatcher_->Watch(files->vertex_);
+            shaderWatcher_->Watch(files->fragment_);
+        }
+}
+
+bool Renderer::IsShaderHotReloadEnabled() const
+{
+    return shaderWatcher_ != nullptr;
+}
+
+std::string Renderer::loadShaderSource(const std::string& path) const
+{
+    std::string source = LoadTextFile(path);
+    if (!SupportsDescriptorIndexing())
+        return source;
+
+    //Defines have to follow the #version directive
+    const std::size_t version = source.find("#version");
+    const std::size_t line    = version == std::string::npos
+                                    ? std::string::npos
+                                    : source.find('\n', version);
+    source.insert(line == std::string::npos ? 0 : line + 1,
+                  "#define BINDLESS\n");
+    return source;
+}
+
+Renderer::ShaderFiles Renderer::shaderFiles(std::string_view vertex,
+                                            std::string_view fragment)
+{
+    //The shader directory sits two levels above the executable in build
+    //trees. The working directory is the fallback if that fails.
+    std::filesystem::path       dir    = "../../shaders";
+    const std::filesystem::path exeDir = GetExecutableDir();
+    std::error_code             error;
+    if (!exeDir.empty() && std::filesystem::is_directory(exeDir / dir, error))
+        dir = (exeDir / dir).lexically_normal();
+    return {(dir / vertex).string(), (dir / fragment).string()};
+}
+
+void Renderer::pollShaderReload()
+{
+    if (shaderReload_.valid())
+        {
+            if (shaderReload_.wait_for(std::chrono::seconds(0)) !=
+                std::future_status::ready)
+                return;
+            ShaderReload reload;
+            try
+                {
+                    reload = shaderReload_.get();
+                }
+            catch (const std::exception& err)
+                {
+                    LOG_ERROR(logger_.get(),
+                              "Shader reload failed, keeping the current "
+                              "shaders: {}",
+                              err.what());
+                    return;
+                }
+            applyShaderReload(std::move(reload));
+        }
+    //Files edited during a reload are seen by the next poll
+    else if (shaderWatcher_)
+        {
+            const bool restart = std::exchange(restartShaderReload_, false);
+            if (shaderWatcher_->Poll() || restart)
+                startShaderReload();
+        }
+}
+
+void Renderer::startShaderReload()
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    std::future<std::shared_ptr<ShaderLayout> > mainSet;
+    std::future<std::shared_ptr<ShaderLayout> > shadowSet;
+    try
+        {
+            mainSet = shFactory_->CreateShaderAsync(
+                loadShaderSource(mainShaderFiles_.vertex_),
+                loadShaderSource(mainShaderFiles_.fragment_));
+            shadowSet = shFactory_->CreateShaderAsync(
+                LoadTextFile(shadowShaderFiles_.vertex_),
+                LoadTextFile(shadowShaderFiles_.fragment_));
+        }
+    catch (const std::exception& err)
+        {
+            LOG_ERROR(logger_.get(), "Shader reload skipped: {}", err.what());
+            return;
+        }
+    LOG_INFO(logger_.get(), "Reloading shaders");
+
+    //The background task only reads copies, handles whose destruction
+    //discards it first and the shadow pipeline layout that UseShader
+    //replaces after discarding as well
+    std::array<std::vector<VkDescriptorSetLayoutBinding>, 2> bindings = {
+        *activeShader_->GetLayoutBindings(0),
+        *activeShader_->GetLayoutBindings(1)};
+    shaderReload_ = std::async(
+        std::launch::async,
+        [this, mainSet = std::move(mainSet), shadowSet = std::move(shadowSet),
+         bindings = std::move(bindings), layout = pipelineLayout_,
+         renderPass = renderPass_,
+         shadowRenderPass = shadowPass_->GetRenderPass()]() mutable
+        {
+            auto sameBindings = [](const std::vector<VkDescriptorSetLayoutBinding>& a,
+                                   const std::vector<VkDescriptorSetLayoutBinding>& b)
+            {
+                return std::equal(
+                    a.begin(), a.end(), b.begin(), b.end(),
+                    [](const auto& l, const auto& r)
+                    {
+                        return l.binding == r.binding &&
+                               l.descriptorType == r.descriptorType &&
+                               l.descriptorCount == r.descriptorCount &&
+                               l.stageFlags == r.stageFlags;
+                    });
+            };
+
+            ShaderReload reload;
+            reload.main_   = mainSet.get();
+            reload.shadow_ = shadowSet.get();
+            reload.layoutChanged_ =
+                reload.main_->GetSetCount() > 2 ||
+                !sameBindings(*reload.main_->GetLayoutBindings(0), bindings[0]) ||
+                !sameBindings(*reload.main_->GetLayoutBindings(1), bindings[1]);
+            if (reload.layoutChanged_)
+                return reload;
+
+            reload.mainPipeline_ =
+                buildGraphicsPipeline(reload.main_, layout, renderPass);
+            try
+                {
+                    reload.shadowPipeline_ = shadowRenderer_->BuildDirectionalPipeline(
+                        reload.shadow_, shadowRenderPass);
+                }
+            catch (...)
+                {
+                    vkDestroyPipeline(device, reload.mainPipeline_, nullptr);
+                    throw;
+                }
+            return reload;
+        });
+}
+
+void Renderer::applyShaderReload(ShaderReload reload)
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    if (reload.layoutChanged_)
+        {
+            LOG_WARNING(logger_.get(), "Reloaded shaders changed descriptor "
+                                       "bindings, rebuilding descriptor state");
+            swapShaderLayouts(std::move(reload.main_),
+                              std::move(reload.shadow_));
+            LOG_INFO(logger_.get(), "Shaders reloaded");
+            return;
+        }
+
+    //Submitted frames keep the old pipelines until they complete, the
+    //mesh descriptor sets stay valid as the set layouts are unchanged
+    VkPipeline oldMain = std::exchange(graphicsPipeline_, reload.mainPipeline_);
+    VkPipeline oldShadow =
+        shadowRenderer_->SwapDirectionalPipeline(reload.shadowPipeline_);
+    deletionQueue_.Push(frameCounter_, [device = device, oldMain, oldShadow]()
+    {
+        vkDestroyPipeline(device, oldMain, nullptr);
+        vkDestroyPipeline(device, oldShadow, nullptr);
+    });
+    activeShader_            = std::move(reload.main_);
+    shadowDirectionalShader_ = std::move(reload.shadow_);
+    invalidateCommandBuffers();
+    markShadowsDirty();
+    LOG_INFO(logger_.get(), "Shaders reloaded");
+}
+
+void Renderer::swapShaderLayouts(std::shared_ptr<ShaderLayout> main,
+                                 std::shared_ptr<ShaderLayout> shadow)
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    if (main->GetSetCount() > 2)
+        throw std::runtime_error(
+            "shader uses descriptor sets beyond the frame and mesh sets");
+
+    //Submitted frames keep the old layouts, sets and pipelines until they
+    //complete. The shadow pipeline layout does not depend on the shader.
+    std::shared_ptr<DescriptorAllocator> oldFrameSets(std::move(frameSets_));
+    std::shared_ptr<DescriptorAllocator> oldMeshSets(std::move(meshSets_));
+    std::shared_ptr<TextureTable>        oldTable(std::move(textureTable_));
+    const VkDescriptorSetLayout          oldFrameLayout =
+        std::exchange(frameSetLayout_, VK_NULL_HANDLE);
+    const VkDescriptorSetLayout oldMeshLayout =
+        std::exchange(descriptorSetLayout_, VK_NULL_HANDLE);
+    const VkPipelineLayout oldPipelineLayout =
+        std::exchange(pipelineLayout_, VK_NULL_HANDLE);
+    const VkPipeline oldMain = std::exchange(graphicsPipeline_, VK_NULL_HANDLE);
+    const VkPipeline oldShadow = shadowRenderer_->SwapDirectionalPipeline(
+        shadowRenderer_->BuildDirectionalPipeline(shadow,
+                                                  shadowPass_->GetRenderPass()));
+    //Released with the pools of the old allocator
+    frameDescriptorSets_.clear();
+
+    activeShader_            = std::move(main);
+    shadowDirectionalShader_ = std::move(shadow);
+    for (auto& mesh : meshes_)
+        {
+            mesh->sh_          = std::make_shared<Shader>(activeShader_);
+            mesh->textureSlot_ = Mesh::noTextureSlot;
+        }
+    createDescriptorSetLayout();
+    createGraphicsPipeline();
+    createDescriptorAllocators();
+    createDescriptorSets();
+    invalidateCommandBuffers();
+    markShadowsDirty();
+
+    deletionQueue_.Push(
+        frameCounter_,
+        [device = device, oldFrameSets, oldMeshSets, oldTable, oldFrameLayout,
+         oldMeshLayout, oldPipelineLayout, oldMain, oldShadow]() mutable
+        {
+            oldTable.reset();
+            oldMeshSets.reset();
+            oldFrameSets.reset();
+            vkDestroyPipeline(device, oldMain, nullptr);
+            vkDestroyPipeline(device, oldShadow, nullptr);
+            vkDestroyPipelineLayout(device, oldPipelineLayout, nullptr);
+            vkDestroyDescriptorSetLayout(device, oldMeshLayout, nullptr);
+            vkDestroyDescriptorSetLayout(device, oldFrameLayout, nullptr);
+        });
+}
+
+void Renderer::discardShaderReload(bool restart)
+{
+    if (!shaderReload_.valid())
+        return;
+    try
+        {
+            ShaderReload reload = shaderReload_.get();
+            vkDestroyPipeline(device, reload.mainPipeline_, nullptr);
+            vkDestroyPipeline(device, reload.shadowPipeline_, nullptr);
+        }
+    catch (const std::exception&)
+        {
+            //A failed reload built no pipelines
+        }
+    restartShaderReload_ = restart;
+}
+
 void Renderer::SetOverlayDrawCallback(std::function<void(VkCommandBuffer)> callback)
 {
     overlayDrawCallback_ = std::move(callback);
@@ -204,6 +595,29 @@ void Renderer::createGraphicsPipeline()
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
 
+    const std::array<VkDescriptorSetLayout, 2> setLayouts = {
+        frameSetLayout_, descriptorSetLayout_};
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pNext = nullptr;
+    pipelineLayoutInfo.setLayoutCount =
+        static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts            = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = 0;
+    pipelineLayoutInfo.pPushConstantRanges    = nullptr;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr,
+                               &pipelineLayout_) != VK_SUCCESS)
+        throw std::runtime_error("failed to create pipeline layout!");
+
+    graphicsPipeline_ =
+        buildGraphicsPipeline(activeShader_, pipelineLayout_, renderPass_);
+}
+
+VkPipeline
+Renderer::buildGraphicsPipeline(const std::shared_ptr<ShaderLayout>& shader,
+                                VkPipelineLayout layout,
+                                VkRenderPass     renderPass) const
+{
     auto bindingDescription    = Vertex::getBindingDescription();
     auto attributeDescriptions = Vertex::getAttributeDescriptions();
     VkPipelineVertexInputStateCreateInfo vertexInputInfo {};
@@ -307,24 +721,13 @@ void Renderer::createGraphicsPipeline()
     dynamicState.dynamicStateCount = 2;
     dynamicState.pDynamicStates    = dynamicStates;
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo {};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.pNext = nullptr;
-    pipelineLayoutInfo.setLayoutCount         = 1;
-    pipelineLayoutInfo.pSetLayouts            = &descriptorSetLayout_;
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
-    pipelineLayoutInfo.pPushConstantRanges    = nullptr;
-    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr,
-                               &pipelineLayout_) != VK_SUCCESS)
-        throw std::runtime_error("failed to create pipeline layout!");
-
     VkGraphicsPipelineCreateInfo pipelineInfo {};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipelineInfo.pNext = nullptr;
     //pipelineInfo.stageCount = 2;
     //pipelineInfo.pStages = stgs;
-    pipelineInfo.stageCount          = static_cast<std::uint32_t>(activeShader_->GetStages()->size());
-    pipelineInfo.pStages             = activeShader_->GetStages()->data();
+    pipelineInfo.stageCount          = static_cast<std::uint32_t>(shader->GetStages()->size());
+    pipelineInfo.pStages             = shader->GetStages()->data();
     pipelineInfo.pVertexInputState   = &vertexInputInfo;
     pipelineInfo.pInputAssemblyState = &inputAssembly;
     pipelineInfo.pViewportState      = &viewportState;
@@ -333,16 +736,13 @@ void Renderer::createGraphicsPipeline()
     pipelineInfo.pDepthStencilState  = &depthStencil;
     pipelineInfo.pColorBlendState    = &colorBlending;
     pipelineInfo.pDynamicState       = &dynamicState;
-    pipelineInfo.layout              = pipelineLayout_;
-    pipelineInfo.renderPass          = renderPass_;
+    pipelineInfo.layout              = layout;
+    pipelineInfo.renderPass          = renderPass;
     pipelineInfo.subpass             = 0;
     pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex   = -1;
 
-    //Create pip
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo,
-                                  nullptr, &graphicsPipeline_) != VK_SUCCESS)
-        throw std::runtime_error("failed to create graphics pipeline!");
+    return pipelineCache_->CreateGraphicsPipeline(pipelineInfo, "main");
 }
 
 void Renderer::createShadowPipeline()
@@ -358,6 +758,11 @@ void Renderer::createCommandBuffers()
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
 
+    //Called with the device idle, earlier buffers are no longer in use
+    if (!commandBuffers_.empty())
+        vkFreeCommandBuffers(device, commandPool,
+                             static_cast<uint32_t>(commandBuffers_.size()),
+                             commandBuffers_.data());
     commandBuffers_.resize(swapChainFramebuffers_.size());
     VkCommandBufferAllocateInfo allocInfo {};
     allocInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -370,15 +775,216 @@ void Renderer::createCommandBuffers()
         VK_SUCCESS)
         throw std::runtime_error("failed to allocate command buffers!");
 
+    const uint32_t slots =
+        static_cast<uint32_t>(commandBuffers_.size()) * RecordSlotKinds;
+    if (!recorder_ || recorder_->GetSlotCount() != slots)
+        {
+            recorder_.reset();
+            recorder_ = std::make_unique<ParallelRecorder>(
+                device, physicDevIndices.graphicsFamily.value(), slots);
+            LOG_INFO(logger_.get(), "Recording draws on {} threads",
+                     recorder_->GetWorkerCount() + 1);
+        }
+    for (uint32_t slot = 0; slot < slots; ++slot)
+        recorder_->Reset(slot);
+
+    recorded_.assign(commandBuffers_.size(), RecordedImage {});
+    invalidateCommandBuffers();
     for (size_t i = 0; i < commandBuffers_.size(); i++)
         recordCommandBuffer(static_cast<uint32_t>(i));
 }
 
+void Renderer::invalidateCommandBuffers()
+{
+    ++drawVersion_;
+}
+
+uint32_t Renderer::recordSlot(RecordSlot kind, uint32_t image) const
+{
+    return static_cast<uint32_t>(kind * commandBuffers_.size()) + image;
+}
+
+std::vector<Mesh*> Renderer::collectDrawList() const
+{
+    std::vector<Mesh*> drawList;
+    drawList.reserve(meshes_.size());
+    for (auto& mesh : meshes_)
+        drawList.push_back(mesh.get());
+    return drawList;
+}
+
+std::vector<Renderer::DrawBucket>
+Renderer::buildDrawBuckets(std::vector<Mesh*> drawList, uint32_t image)
+{
+    //Meshes sharing a texture view sample the same image, so the set of
+    //any of them serves the whole bucket. Bindless meshes select their
+    //texture per draw and only split on buffers.
+    auto key = [this](const Mesh* mesh)
+    {
+        return std::make_tuple(
+            mesh->geometry_->vertexBuffer_, mesh->geometry_->indexBuffer_,
+            bindless_ || mesh->textures_.empty()
+                ? VkImageView(VK_NULL_HANDLE)
+                : mesh->textures_.front()->view_);
+    };
+    std::stable_sort(drawList.begin(), drawList.end(),
+                     [&](const Mesh* a, const Mesh* b) { return key(a) < key(b); });
+
+    //Written only while no frame of this image is in flight
+    auto* commands = static_cast<VkDrawIndexedIndirectCommand*>(
+        indirectBuffers_[image]->allocation_.mapped_);
+    std::vector<DrawBucket> buckets;
+    for (uint32_t d = 0; d < drawList.size(); ++d)
+        {
+            const Mesh* mesh = drawList[d];
+            commands[d].indexCount    = mesh->geometry_->indexCount_;
+            commands[d].instanceCount = 1;
+            commands[d].firstIndex    = mesh->geometry_->firstIndex_;
+            commands[d].vertexOffset =
+                static_cast<int32_t>(mesh->geometry_->baseVertex_);
+            //Per draw data is looked up through the instance index
+            commands[d].firstInstance = mesh->tr_->GetSlot();
+
+            if (!buckets.empty() && key(buckets.back().mesh_) == key(mesh))
+                ++buckets.back().count_;
+            else
+                buckets.push_back({mesh, d, 1});
+        }
+    return buckets;
+}
+
 void Renderer::recordCommandBuffer(uint32_t i)
 {
     if (i >= commandBuffers_.size())
         throw std::out_of_range("command buffer index out of range");
 
+    RecordedImage& recorded = recorded_[i];
+    const bool     stale    = recorded.version_ != drawVersion_;
+    //Only uniform data changed, the buffer is submitted again as it is
+    if (!stale && !recorded.overlay_ && !overlayDrawCallback_)
+        return;
+
+    VkViewport viewport {};
+    viewport.x        = 0.0f;
+    viewport.y        = 0.0f;
+    viewport.width    = static_cast<float>(swapChainExtent_.width);
+    viewport.height   = static_cast<float>(swapChainExtent_.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor {};
+    scissor.offset = {0, 0};
+    scissor.extent = swapChainExtent_;
+
+    VkCommandBufferInheritanceInfo inheritance {};
+    inheritance.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.pNext       = nullptr;
+    inheritance.renderPass  = renderPass_;
+    inheritance.subpass     = 0;
+    inheritance.framebuffer = swapChainFramebuffers_[i];
+
+    //Mesh draws are kept across frames until an input of them changes
+    if (stale)
+        {
+            const uint32_t slot = recordSlot(SceneSlot, i);
+            recorder_->Reset(slot);
+
+            const std::vector<Mesh*> drawList = collectDrawList();
+            std::vector<DrawBucket>  buckets;
+            if (indirectDraws_)
+                buckets = buildDrawBuckets(drawList, i);
+            std::vector<ParallelRecorder::Job> jobs;
+            recorder_->Split(jobs, indirectDraws_ ? buckets.size() : drawList.size(),
+                             inheritance, 0);
+
+            //Secondary buffers inherit no state, each binds everything it uses
+            recorded.secondaries_ = recorder_->Record(
+                slot, jobs,
+                [&](VkCommandBuffer cmd, const ParallelRecorder::Job& job)
+                {
+                    vkCmdSetViewport(cmd, 0, 1, &viewport);
+                    vkCmdSetScissor(cmd, 0, 1, &scissor);
+                    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                      graphicsPipeline_);
+                    //Camera, lights and shadows are bound once, meshes only
+                    //swap set 1 unless it is the bindless texture table
+                    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                            pipelineLayout_, 0, 1,
+                                            &frameDescriptorSets_[i], 0, nullptr);
+                    if (textureTable_)
+                        {
+                            VkDescriptorSet textures = textureTable_->GetSet();
+                            vkCmdBindDescriptorSets(
+                                cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                pipelineLayout_, 1, 1, &textures, 0, nullptr);
+                        }
+
+                    VkDeviceSize offsets[] = {0};
+                    //Meshes of one geometry page share their buffers
+                    VkBuffer bound = VK_NULL_HANDLE;
+                    auto bindMesh = [&](const Mesh* mesh)
+                    {
+                        const MeshGeometry& geometry = *mesh->geometry_;
+                        if (geometry.vertexBuffer_ != bound)
+                            {
+                                vkCmdBindVertexBuffers(
+                                    cmd, 0, 1, &geometry.vertexBuffer_, offsets);
+                                vkCmdBindIndexBuffer(cmd, geometry.indexBuffer_,
+                                                     0, VK_INDEX_TYPE_UINT32);
+                                bound = geometry.vertexBuffer_;
+                            }
+                        if (!textureTable_)
+                            vkCmdBindDescriptorSets(
+                                cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                pipelineLayout_, 1, 1, &mesh->sh_->desSet_[0],
+                                0, nullptr);
+                    };
+
+                    if (indirectDraws_)
+                        for (std::size_t b = job.begin_; b < job.end_; ++b)
+                            {
+                                bindMesh(buckets[b].mesh_);
+                                vkCmdDrawIndexedIndirect(
+                                    cmd, indirectBuffers_[i]->buffer_,
+                                    buckets[b].first_ *
+                                        sizeof(VkDrawIndexedIndirectCommand),
+                                    buckets[b].count_,
+                                    sizeof(VkDrawIndexedIndirectCommand));
+                            }
+                    else
+                        for (std::size_t m = job.begin_; m < job.end_; ++m)
+                            {
+                                const Mesh* mesh = drawList[m];
+                                bindMesh(mesh);
+                                //firstInstance selects the object record of
+                                //the mesh
+                                const MeshGeometry& geometry = *mesh->geometry_;
+                                vkCmdDrawIndexed(
+                                    cmd, geometry.indexCount_, 1,
+                                    geometry.firstIndex_,
+                                    static_cast<int32_t>(geometry.baseVertex_),
+                                    mesh->tr_->GetSlot());
+                            }
+                },
+                0);
+            recorded.version_ = drawVersion_;
+        }
+
+    std::vector<VkCommandBuffer> secondaries = recorded.secondaries_;
+    //The overlay changes every frame and is not thread safe, it records
+    //on this thread into a buffer of its own
+    recorded.overlay_ = static_cast<bool>(overlayDrawCallback_);
+    if (overlayDrawCallback_)
+        {
+            const uint32_t slot = recordSlot(OverlaySlot, i);
+            recorder_->Reset(slot);
+            VkCommandBuffer overlay = recorder_->BeginSecondary(slot, inheritance);
+            overlayDrawCallback_(overlay);
+            if (vkEndCommandBuffer(overlay) != VK_SUCCESS)
+                throw std::runtime_error("failed to record overlay command buffer!");
+            secondaries.push_back(overlay);
+        }
+
     vkResetCommandBuffer(commandBuffers_[i], 0);
 
     VkCommandBufferBeginInfo beginInfo {};
@@ -402,45 +1008,12 @@ void Renderer::recordCommandBuffer(uint32_t i)
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues    = clearValues.data();
 
-    VkViewport viewport {};
-    viewport.x        = 0.0f;
-    viewport.y        = 0.0f;
-    viewport.width    = static_cast<float>(swapChainExtent_.width);
-    viewport.height   = static_cast<float>(swapChainExtent_.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor {};
-    scissor.offset = {0, 0};
-    scissor.extent = swapChainExtent_;
-
     vkCmdBeginRenderPass(commandBuffers_[i], &renderPassInfo,
-                         VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdSetViewport(commandBuffers_[i], 0, 1, &viewport);
-    vkCmdSetScissor(commandBuffers_[i], 0, 1, &scissor);
-    vkCmdBindPipeline(commandBuffers_[i], VK_PIPELINE_BIND_POINT_GRAPHICS,
-                      graphicsPipeline_);
-
-    VkDeviceSize offsets[] = {0};
-    for (auto& mesh : meshes_)
-        {
-            vkCmdBindVertexBuffers(commandBuffers_[i], 0, 1,
-                                   &mesh->vertBuffer_->pVertBuf_->buffer_,
-                                   offsets);
-            vkCmdBindIndexBuffer(commandBuffers_[i], mesh->indexBuffer_->buffer_,
-                                 0, VK_INDEX_TYPE_UINT32);
-            vkCmdBindDescriptorSets(commandBuffers_[i],
-                                    VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                    pipelineLayout_, 0, 1, &mesh->sh_->desSet_[i],
-                                    0, nullptr);
-            vkCmdDrawIndexed(commandBuffers_[i],
-                             static_cast<uint32_t>(mesh->indexesSize_), 1, 0, 0,
-                             0);
-        }
-
-    if (overlayDrawCallback_)
-        overlayDrawCallback_(commandBuffers_[i]);
-
+                         VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    if (!secondaries.empty())
+        vkCmdExecuteCommands(commandBuffers_[i],
+                             static_cast<uint32_t>(secondaries.size()),
+                             secondaries.data());
     vkCmdEndRenderPass(commandBuffers_[i]);
     if (vkEndCommandBuffer(commandBuffers_[i]) != VK_SUCCESS)
         throw std::runtime_error("failed to record command buffer!");
@@ -461,19 +1034,38 @@ void Renderer::Draw()
                 shadowCommandBuffersInFlight_[currentFrame_]);
             shadowCommandBuffersInFlight_[currentFrame_] = VK_NULL_HANDLE;
         }
-    //Get next ingex image for redering
-    VkResult result =
-        vkAcquireNextImageKHR(device, swapChain_, UINT64_MAX,
-                              syncers_[currentFrame_].imageAvailableSemaphores_,
-                              VK_NULL_HANDLE, &imageIndex_);
-
-    if (result == VK_ERROR_OUT_OF_DATE_KHR)
+    deletionQueue_.Flush(completedFrames());
+    pollShaderReload();
+    streamTextures();
+    VkResult result = VK_SUCCESS;
+    if (headless_)
+        imageIndex_ = static_cast<uint32_t>(frameCounter_ %
+                                            swapChainImages_.size());
+    else
         {
-            RecreateSwapChain();
-            return;
+            //Get next ingex image for redering
+            result = vkAcquireNextImageKHR(
+                device, swapChain_, UINT64_MAX,
+                syncers_[currentFrame_].imageAvailableSemaphores_,
+                VK_NULL_HANDLE, &imageIndex_);
+
+            if (result == VK_ERROR_OUT_OF_DATE_KHR)
+                {
+                    discardShaderReload(true);
+                    RecreateSwapChain();
+                    return;
+                }
+            else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+                throw std::runtime_error("failed to acquire swap chain image!");
         }
-    else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
-        throw std::runtime_error("failed to acquire swap chain image!");
+
+    //Uniform segment of this image may still be read by its previous frame
+    if (syncers_[imageIndex_].imagesInFlight_ != VK_NULL_HANDLE)
+        vkWaitForFences(device, 1, &syncers_[imageIndex_].imagesInFlight_, VK_TRUE,
+                        UINT64_MAX);
+    syncers_[imageIndex_].imagesInFlight_ = syncers_[currentFrame_].inFlightFences_;
+    //Shadow buffers of this image's last frame are done with as well
+    recorder_->Reset(recordSlot(ShadowSlot, imageIndex_));
 
     updateMats(imageIndex_);
     if (shadowsEnabled_ && shadowMapsDirty_ && shadowMapsInFlightFence_ != VK_NULL_HANDLE &&
@@ -487,33 +1079,55 @@ void Renderer::Draw()
         {
             shadowCmd = shadowRenderer_->BuildShadowCommandBufferAll(
                 meshes_, *shadowPass_, directionalShadowMaps_, pointShadowMaps_,
-                shadowPackCache_, imageIndex_);
+                shadowPackCache_, recordSlot(ShadowSlot, imageIndex_),
+                *recorder_);
             if (currentFrame_ < shadowCommandBuffersInFlight_.size())
                 shadowCommandBuffersInFlight_[currentFrame_] = shadowCmd;
         }
 
-    if (syncers_[imageIndex_].imagesInFlight_ != VK_NULL_HANDLE)
-        vkWaitForFences(device, 1, &syncers_[imageIndex_].imagesInFlight_, VK_TRUE,
-                        UINT64_MAX);
-    syncers_[imageIndex_].imagesInFlight_ = syncers_[currentFrame_].inFlightFences_;
     recordCommandBuffer(imageIndex_);
 
+    //Offscreen images are owned by us, nothing to wait for or signal
+    std::vector<VkSemaphore>          waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
+    std::vector<uint64_t>             waitValues;
+    if (!headless_)
+        {
+            waitSemaphores.push_back(
+                syncers_[currentFrame_].imageAvailableSemaphores_);
+            waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+            //Ignored for binary semaphores
+            waitValues.push_back(0);
+        }
+    //Meshes are drawn before their uploads are known to be complete
+    if (uploadValue_ > 0 && !uploads_->IsComplete(uploadValue_))
+        {
+            waitSemaphores.push_back(uploads_->GetSemaphore());
+            waitStages.push_back(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+            waitValues.push_back(uploadValue_);
+        }
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount =
+        static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+
     VkSubmitInfo submitInfo {};
-    submitInfo.sType                  = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.pNext                  = nullptr;
-    VkPipelineStageFlags waitStages[] = {
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores =
-        &syncers_[currentFrame_].imageAvailableSemaphores_;
-    submitInfo.pWaitDstStageMask    = waitStages;
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount =
+        static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores      = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask    = waitStages.data();
     VkCommandBuffer submitCmds[2]   = {shadowCmd, commandBuffers_[imageIndex_]};
     submitInfo.commandBufferCount   =
         (shadowCmd == VK_NULL_HANDLE) ? 1u : 2u;
     submitInfo.pCommandBuffers =
         (shadowCmd == VK_NULL_HANDLE) ? &commandBuffers_[imageIndex_]
                                       : submitCmds;
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = headless_ ? 0u : 1u;
     submitInfo.pSignalSemaphores =
         &syncers_[currentFrame_].renderFinishedSemaphores_;
 
@@ -527,6 +1141,13 @@ void Renderer::Draw()
             shadowMapsInFlightFence_ = syncers_[currentFrame_].inFlightFences_;
             shadowMapsDirty_         = false;
         }
+    ++frameCounter_;
+
+    if (headless_)
+        {
+            currentFrame_ = (currentFrame_ + 1) % maxFramesInFlight_;
+            return;
+        }
 
     VkPresentInfoKHR presentInfo {};
     presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -569,7 +1190,8 @@ void Renderer::drawShadows()
     if (!shadowRenderer_ || !shadowPass_)
         return;
     shadowRenderer_->DrawAll(meshes_, *shadowPass_, directionalShadowMaps_,
-                             pointShadowMaps_, shadowPackCache_, imageIndex_);
+                             pointShadowMaps_, shadowPackCache_,
+                             recordSlot(ShadowSlot, imageIndex_), *recorder_);
 }
 
 void Renderer::createSyncObjects()
@@ -581,134 +1203,129 @@ void Renderer::createSyncObjects()
         syncers_.emplace_back(device);
 }
 
-void Renderer::createDescriptorPool()
+void Renderer::createDescriptorAllocators()
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
 
-    std::unordered_map<VkDescriptorType, uint32_t> descriptorsPerSet;
-    for (const auto& binding : *activeShader_->GetLayoutBindings())
-        descriptorsPerSet[binding.descriptorType] += binding.descriptorCount;
-
-    const uint32_t meshCount =
-        std::max(1u, static_cast<uint32_t>(meshes_.size()));
-    const uint32_t setCount = meshCount * static_cast<uint32_t>(swapChainImages_.size());
-
-    std::vector<VkDescriptorPoolSize> poolSizes;
-    poolSizes.reserve(descriptorsPerSet.size());
-    for (const auto& [type, countPerSet] : descriptorsPerSet)
-        {
-            poolSizes.push_back(VkDescriptorPoolSize {
-                type, countPerSet * setCount});
-        }
-
-    VkDescriptorPoolCreateInfo poolInfo {};
-    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.pNext         = nullptr;
-    poolInfo.flags         = 0;
-    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-    poolInfo.pPoolSizes    = poolSizes.data();
-    poolInfo.maxSets       = setCount;
-
-    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool_) !=
-        VK_SUCCESS)
-        throw std::runtime_error("failed to create descriptor pool!");
+    //Allocators only depend on the set layouts, they outlive swapchain
+    //recreation and capacity growth
+    const auto imageCount = static_cast<uint32_t>(swapChainImages_.size());
+    if (!frameSets_)
+        frameSets_ = std::make_unique<DescriptorAllocator>(
+            device, frameSetLayout_, *activeShader_->GetLayoutBindings(0),
+            imageCount);
+    //Bindless meshes have no sets of their own
+    if (!bindless_ && !meshSets_)
+        meshSets_ = std::make_unique<DescriptorAllocator>(
+            device, descriptorSetLayout_, *activeShader_->GetLayoutBindings(1),
+            static_cast<uint32_t>(meshCapacity_));
 }
 
 void Renderer::createDescriptorSetLayout()
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
 
-    // VkDescriptorSetLayoutBinding Layouts[1];
-    /*
-	//Transformation
-	Layouts[0].binding = 0;
-	Layouts[0].descriptorType =
-		VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	Layouts[0].descriptorCount = 1;
-	Layouts[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	Layouts[0].pImmutableSamplers = nullptr;
-	
-
-	//ViewPos
-	Layouts[1].binding = 1;
-	Layouts[1].descriptorType =
-		VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	Layouts[1].descriptorCount = 1;
-	Layouts[1].stageFlags = VK_SHADER_STAGE_ALL;
-	Layouts[1].pImmutableSamplers = nullptr;
-
-	//Material
-	Layouts[2].binding = 2;
-	Layouts[2].descriptorType =
-		VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	Layouts[2].descriptorCount = 1;
-	Layouts[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-	for (uint16_t i = 3; i < 8; ++i)
-	{
-		Layouts[i].binding = i;
-		Layouts[i].descriptorCount = 1;
-		Layouts[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		Layouts[i].pImmutableSamplers = nullptr;
-		Layouts[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-	}*/
-    VkDescriptorSetLayoutCreateInfo layoutInfo {};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.pNext = nullptr;
-    layoutInfo.bindingCount = static_cast<uint32_t>(activeShader_->GetLayoutBindings()->size());
-    layoutInfo.pBindings = activeShader_->GetLayoutBindings()->data(); //Layouts;
-
-    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr,
-                                    &descriptorSetLayout_) != VK_SUCCESS)
-        throw std::runtime_error("failed to create descriptor setlayout!");
+    if (activeShader_->GetSetCount() > 2)
+        throw std::runtime_error(
+            "shader uses descriptor sets beyond the frame and mesh sets");
+
+    //A runtime sized sampler array in the mesh set selects the bindless
+    //path, the array is the TextureTable and the only binding of the set
+    const auto& meshBindings = *activeShader_->GetLayoutBindings(1);
+    bindless_ = std::any_of(meshBindings.begin(), meshBindings.end(),
+                            [](const VkDescriptorSetLayoutBinding& binding)
+                            { return binding.descriptorCount == 0; });
+    if (bindless_ &&
+        (meshBindings.size() != 1 || meshBindings.front().descriptorType !=
+                                         VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER))
+        throw std::runtime_error(
+            "bindless mesh set supports a single sampler array only");
+    if (bindless_ && !SupportsDescriptorIndexing())
+        throw std::runtime_error(
+            "bindless mesh set needs descriptor indexing support");
+
+    auto createLayout = [this](uint32_t set, VkDescriptorSetLayout& layout)
+    {
+        std::vector<VkDescriptorSetLayoutBinding> bindings =
+            *activeShader_->GetLayoutBindings(set);
+        std::vector<VkDescriptorBindingFlags> flags(bindings.size(), 0);
+        bool updateAfterBind = false;
+        for (std::size_t i = 0; i < bindings.size(); ++i)
+            if (bindings[i].descriptorCount == 0)
+                {
+                    bindings[i].descriptorCount = bindlessCapacity_;
+                    flags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                               VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                               VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+                    updateAfterBind = true;
+                }
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo {};
+        flagsInfo.sType =
+            VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        flagsInfo.pNext         = nullptr;
+        flagsInfo.bindingCount  = static_cast<uint32_t>(flags.size());
+        flagsInfo.pBindingFlags = flags.data();
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo {};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = updateAfterBind ? &flagsInfo : nullptr;
+        layoutInfo.flags =
+            updateAfterBind
+                ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT
+                : 0;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings    = bindings.data();
+
+        if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr,
+                                        &layout) != VK_SUCCESS)
+            throw std::runtime_error("failed to create descriptor setlayout!");
+    };
+
+    createLayout(0, frameSetLayout_);
+    createLayout(1, descriptorSetLayout_);
 }
 
 void Renderer::createUniformBuffers()
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
 
-    lightsUbo_ = std::make_unique<LightsUBO>(device);
-    lightsUbo_->buffers_.clear();
-    lightsUbo_->buffers_.reserve(swapChainImages_.size());
-    for (size_t i = 0; i < swapChainImages_.size(); ++i)
-        lightsUbo_->buffers_.push_back(
-            meshFactory_->CreateUniformBuffer(LightsUBO::LightsBufObj));
-
-    directionalShadowUboBuffers_.clear();
-    directionalShadowUboBuffers_.reserve(swapChainImages_.size());
-    for (size_t i = 0; i < swapChainImages_.size(); ++i)
-        directionalShadowUboBuffers_.push_back(meshFactory_->CreateUniformBuffer(
-            sizeof(UBOs::DirectionalShadows)));
-
-    pointShadowUboBuffers_.clear();
-    pointShadowUboBuffers_.reserve(swapChainImages_.size());
-    for (size_t i = 0; i < swapChainImages_.size(); ++i)
-        pointShadowUboBuffers_.push_back(meshFactory_->CreateUniformBuffer(
-            sizeof(UBOs::PointShadows)));
+    meshCapacity_ = std::max(meshCapacity_, meshes_.size());
+
+    //minUniformBufferOffsetAlignment never exceeds 256 bytes
+    constexpr VkDeviceSize maxAlignment = 256;
+    const VkDeviceSize segmentSize =
+        (LightsUBO::LightsBufObj + maxAlignment) +
+        (sizeof(UBOs::DirectionalShadows) + maxAlignment) +
+        (sizeof(UBOs::PointShadows) + maxAlignment) +
+        (sizeof(UBOs::Frame) + maxAlignment) +
+        (meshCapacity_ * sizeof(UBOs::ObjectRecord) + maxAlignment);
+    uniformRing_ = meshFactory_->CreateUniformRing(
+        static_cast<uint32_t>(swapChainImages_.size()), segmentSize);
+
+    lightsUbo_ = std::make_unique<LightsUBO>(*uniformRing_);
+    objects_   = std::make_unique<ObjectTable>(
+        *uniformRing_, static_cast<uint32_t>(meshCapacity_));
+    indirectBuffers_.clear();
+    for (std::size_t i = 0; i < swapChainImages_.size(); ++i)
+        indirectBuffers_.push_back(meshFactory_->CreateBuffer(
+            meshCapacity_ * sizeof(VkDrawIndexedIndirectCommand),
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+    frameUbo_  = uniformRing_->Allocate(sizeof(UBOs::Frame));
+    directionalShadowUbo_ =
+        uniformRing_->Allocate(sizeof(UBOs::DirectionalShadows));
+    pointShadowUbo_ = uniformRing_->Allocate(sizeof(UBOs::PointShadows));
 
     for (auto& mesh : meshes_)
         {
-            mesh->tr_ = meshFactory_->CreateUBOBuffers(swapChainImages_.size());
+            mesh->tr_ = meshFactory_->CreateUBOBuffers(*objects_);
             if (mesh->tr_)
                 {
                     mesh->tr_->SetModelChangedCallback(
                         std::bind(&Renderer::markShadowsDirty, this));
                 }
-            /*
-		for (size_t i = 0; i < swapChainImages.size(); ++i)
-		{
-			mesh->matrixes.push_back(MeshFac->createBuffer(TransBufObj, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-				VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
-			/*
-			mesh->materialUBO_.push_back(MeshFac->createBuffer(MatBufObj, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-				VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
-
-			mesh->viewPosUBO_.push_back(MeshFac->createBuffer(ViewBufObj, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-				VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
-		}*/
         }
 }
 
@@ -722,17 +1339,21 @@ void Renderer::updateMats(uint32_t currentImage)
                      currentTime - startTime)
                      .count();
 
-    UBOs::Transform ubo {};
-    ubo.model_        = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f),
-                                    glm::vec3(0.0f, 1.0f, 0.0f));
-    auto controller = _pWnd ? _pWnd->GetController() : nullptr;
+    const auto& controller = controller_;
     if (!controller || !controller->projection_ || !controller->view_)
         throw std::runtime_error(
             "Renderer::updateMats requires valid PositionController matrices");
-    ubo.PV_           = (*controller->projection_) * (*controller->view_);
-    ubo.normalMatrix_ = glm::transpose(glm::inverse(ubo.model_));
-    const glm::vec3 viewPos = controller->cam_ ? controller->cam_->position_
-                                               : glm::vec3(0.0f);
+
+    UBOs::Frame frame {};
+    frame.view_       = *controller->view_;
+    frame.projection_ = *controller->projection_;
+    frame.PV_         = frame.projection_ * frame.view_;
+    frame.viewPos_ = glm::vec4(controller->cam_ ? controller->cam_->position_
+                                                : glm::vec3(0.0f),
+                               1.0f);
+    frame.time_ = glm::vec4(time, controller->dt_, 0.0f, 0.0f);
+    uniformRing_->Write(currentImage, frameUbo_, &frame, sizeof(frame));
+    objects_->Flush(currentImage);
 
     if (lightsUbo_)
         {
@@ -746,41 +1367,12 @@ void Renderer::updateMats(uint32_t currentImage)
                                                 : UBOs::Lights {});
             shadowPackCache_ = shadowsEnabled_ ? UBOs::PackShadowData(lightPtrs)
                                                : UBOs::ShadowPack {};
-            if (currentImage < directionalShadowUboBuffers_.size() &&
-                directionalShadowUboBuffers_[currentImage])
-                {
-                    void* data = nullptr;
-                    vkMapMemory(device,
-                                directionalShadowUboBuffers_[currentImage]
-                                    ->bufferMemory_,
-                                0, sizeof(UBOs::DirectionalShadows), 0, &data);
-                    std::memcpy(data, &shadowPackCache_.directional_,
+            uniformRing_->Write(currentImage, directionalShadowUbo_,
+                                &shadowPackCache_.directional_,
                                 sizeof(UBOs::DirectionalShadows));
-                    vkUnmapMemory(device,
-                                  directionalShadowUboBuffers_[currentImage]
-                                      ->bufferMemory_);
-                }
-            if (currentImage < pointShadowUboBuffers_.size() &&
-                pointShadowUboBuffers_[currentImage])
-                {
-                    void* data = nullptr;
-                    vkMapMemory(device,
-                                pointShadowUboBuffers_[currentImage]
-                                    ->bufferMemory_,
-                                0, sizeof(UBOs::PointShadows), 0, &data);
-                    std::memcpy(data, &shadowPackCache_.point_,
+            uniformRing_->Write(currentImage, pointShadowUbo_,
+                                &shadowPackCache_.point_,
                                 sizeof(UBOs::PointShadows));
-                    vkUnmapMemory(device,
-                                  pointShadowUboBuffers_[currentImage]
-                                      ->bufferMemory_);
-                }
-        }
-
-    for (auto& mesh : meshes_)
-        {
-            mesh->tr_->updatePV(currentImage, ubo.PV_);
-            mesh->tr_->updateView(currentImage, viewPos);
-            //mesh->tr_->updateModel(currentImage, glm::mat4(1.0f));
         }
 }
 
@@ -796,251 +1388,231 @@ void Renderer::createDescriptorSets()
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
 
+    const auto imageCount = static_cast<uint32_t>(swapChainImages_.size());
+    frameDescriptorSets_.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; ++i)
+        {
+            frameDescriptorSets_[i] = frameSets_->Allocate();
+            writeFrameDescriptorSet(i);
+        }
+
+    //The table outlives capacity growth, it only depends on the layout
+    if (bindless_ && !textureTable_)
+        {
+            const uint32_t binding =
+                activeShader_->GetLayoutBindings(1)->front().binding;
+            textureTable_ = std::make_unique<TextureTable>(
+                device, descriptorSetLayout_, binding, bindlessCapacity_);
+        }
     for (auto& mesh : meshes_)
+        attachMeshTexture(*mesh);
+}
+
+void Renderer::attachMeshTexture(Mesh& mesh)
+{
+    //Mesh sets only reference the texture, they survive rebuilds of the
+    //uniform ring and swapchain
+    if (!bindless_)
         {
-            std::vector<VkDescriptorSetLayout> layouts(swapChainImages_.size(),
-                                                       descriptorSetLayout_);
-            VkDescriptorSetAllocateInfo        allocInfo {};
-            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-            allocInfo.pNext = nullptr;
-            allocInfo.descriptorPool = descriptorPool_;
-            allocInfo.descriptorSetCount =
-                static_cast<uint32_t>(swapChainImages_.size());
-            allocInfo.pSetLayouts = layouts.data();
-            mesh->sh_->desSet_.resize(swapChainImages_.size());
-
-            if (vkAllocateDescriptorSets(
-                    device, &allocInfo, mesh->sh_->desSet_.data()) != VK_SUCCESS)
-                throw std::runtime_error("failed to allocate descriptor sets!");
-
-            for (size_t i = 0; i < swapChainImages_.size(); ++i)
+            if (mesh.sh_->desSet_.empty())
                 {
-                    std::vector<VkWriteDescriptorSet> descriptorWrites {};
-                    std::vector<VkDescriptorBufferInfo> descriptorBufferInfos {};
-                    std::vector<VkDescriptorImageInfo> descriptorImageInfos {};
-                    const auto bindingCount =
-                        activeShader_->GetLayoutBindings()->size();
-                    descriptorWrites.reserve(bindingCount);
-                    descriptorBufferInfos.reserve(bindingCount);
-                    descriptorImageInfos.reserve(bindingCount);
-                    for (const auto& layout : *activeShader_->GetLayoutBindings())
-                        {
-                            if (layout.descriptorType ==
-                                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
-                                {
-                                    VkDescriptorBufferInfo bufferInfo {};
-                                    if (layout.binding == 0)
-                                        {
-                                            bufferInfo.buffer =
-                                                mesh->tr_->matrixes_[i]->buffer_;
-                                            bufferInfo.range =
-                                                sizeof(UBOs::Transform);
-                                        }
-                                    else if (layout.binding == 1 && lightsUbo_ &&
-                                             i < lightsUbo_->buffers_.size())
-                                        {
-                                            bufferInfo.buffer =
-                                                lightsUbo_->buffers_[i]->buffer_;
-                                            bufferInfo.range =
-                                                LightsUBO::LightsBufObj;
-                                        }
-                                    else if (layout.binding == 2 &&
-                                             i < mesh->tr_->viewPosUBO_.size())
-                                        {
-                                            bufferInfo.buffer =
-                                                mesh->tr_->viewPosUBO_[i]->buffer_;
-                                            bufferInfo.range =
-                                                sizeof(UBOs::ViewPosition);
-                                        }
-                                    else if (layout.binding == 4 &&
-                                             i < directionalShadowUboBuffers_.size())
-                                        {
-                                            bufferInfo.buffer =
-                                                directionalShadowUboBuffers_[i]
-                                                    ->buffer_;
-                                            bufferInfo.range =
-                                                sizeof(UBOs::DirectionalShadows);
-                                        }
-                                    else if (layout.binding == 6 &&
-                                             i < pointShadowUboBuffers_.size())
-                                        {
-                                            bufferInfo.buffer =
-                                                pointShadowUboBuffers_[i]
-                                                    ->buffer_;
-                                            bufferInfo.range =
-                                                sizeof(UBOs::PointShadows);
-                                        }
-                                    else
-                                        {
-                                            throw std::runtime_error(
-                                                "unsupported uniform buffer binding");
-                                        }
-                                    bufferInfo.offset = 0;
-                                    descriptorBufferInfos.push_back(bufferInfo);
-
-                                    descriptorWrites.push_back(
-                                        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                                         nullptr, mesh->sh_->desSet_[i],
-                                         layout.binding, 0, 1,
-                                         VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                                         nullptr,
-                                         &descriptorBufferInfos.back(),
-                                         nullptr});
-                                }
-
-                            if (layout.descriptorType ==
-                                VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
-                                {
-                                    VkDescriptorImageInfo imageInfo {};
-                                    if (layout.binding == 3)
-                                        {
-                                            if (mesh->textures_.empty())
-                                                throw std::runtime_error(
-                                                    "mesh has no texture for sampler binding");
-                                            imageInfo.imageLayout =
-                                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                                            imageInfo.imageView =
-                                                (*mesh->textures_.begin())->view_;
-                                            imageInfo.sampler =
-                                                (*mesh->textures_.begin())->sampler_;
-                                        }
-                                    else if (layout.binding == 5)
-                                        {
-                                            imageInfo.imageLayout =
-                                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                                            imageInfo.imageView =
-                                                directionalShadowMaps_.view_;
-                                            imageInfo.sampler =
-                                                directionalShadowMaps_.sampler_;
-                                        }
-                                    else if (layout.binding == 7)
-                                        {
-                                            imageInfo.imageLayout =
-                                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                                            imageInfo.imageView =
-                                                pointShadowMaps_.view_;
-                                            imageInfo.sampler =
-                                                pointShadowMaps_.sampler_;
-                                        }
-                                    else
-                                        {
-                                            throw std::runtime_error(
-                                                "unsupported sampler binding");
-                                        }
-                                    descriptorImageInfos.push_back(imageInfo);
-                                    descriptorWrites.push_back(
-                                        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                                         nullptr, mesh->sh_->desSet_[i],
-                                         layout.binding, 0, 1,
-                                         VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                         &descriptorImageInfos.back(),
-                                         nullptr, nullptr});
-                                }
-                        }
-                    /*
-			VkDescriptorBufferInfo bufferInfo{};
-			bufferInfo.buffer = mesh->tr_->matrixes[i]->buffer_;// TransformUBO[i]->buffer_;
-			bufferInfo.offset = 0;
-			bufferInfo.range = sizeof(UBOs::Transform);
-			uint32_t bindpoint = 0;
-			std::vector<VkWriteDescriptorSet> descriptorWrites{};
-			descriptorWrites.push_back(
-				{
-				VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-				nullptr,
-				mesh->DesSet[i],
-				bindpoint,
-				0,
-				1,
-				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				nullptr,
-				&bufferInfo,
-				nullptr
-				});*/
-                    /*
-			bufferInfo.buffer = mesh->viewPosUBO_[i]->buffer_;//viewPosUBO_[i]->buffer_;
-			bufferInfo.offset = 0;
-			bufferInfo.range = sizeof(UBOs::ViewPosition);
-
-			++bindpoint;
-			descriptorWrites.push_back(
-				{
-				VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-				nullptr,
-				mesh->DesSet[i],
-				bindpoint,
-				0,
-				1,
-				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				nullptr,
-				&bufferInfo,
-				nullptr
-				});
-
-			bufferInfo.buffer = mesh->materialUBO_[i]->buffer_;// materialUBO_[i]->buffer_;
-			bufferInfo.offset = 0;
-			bufferInfo.range = sizeof(Material);
-
-			++bindpoint;
-			descriptorWrites.push_back(
-				{
-				VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-				nullptr,
-				mesh->DesSet[i],
-				bindpoint,
-				0,
-				1,
-				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				nullptr,
-				&bufferInfo,
-				nullptr
-				});
-
-			//bind texture with set
-			for (auto& tex : mesh->textures)
-			{
-				bindpoint++;
-				VkDescriptorImageInfo imageInfo{};
-				imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-				imageInfo.imageView = tex->view_;
-				imageInfo.sampler = tex->sampler_;
-
-				descriptorWrites.push_back
-				(
-					{
-					VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-					nullptr,
-					mesh->DesSet[i],
-					bindpoint,
-					0,
-					1,
-					VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-					&imageInfo,
-					nullptr,
-					nullptr
-					}
-				);
-				
-			}*/
-
-                    vkUpdateDescriptorSets(
-                        device, static_cast<uint32_t>(descriptorWrites.size()),
-                        descriptorWrites.data(), 0, nullptr);
+                    mesh.sh_->desSet_.push_back(meshSets_->Allocate());
+                    writeMeshDescriptorSets(mesh);
+                }
+            return;
+        }
+    if (mesh.textureSlot_ == Mesh::noTextureSlot)
+        {
+            if (mesh.textures_.empty())
+                throw std::runtime_error("mesh has no texture for sampler binding");
+            mesh.textureSlot_ = textureTable_->Acquire(mesh.textures_.front());
+        }
+    //Object records are new after every rebuild of the uniform ring
+    mesh.tr_->SetTexture(mesh.textureSlot_);
+}
+
+void Renderer::streamTextures()
+{
+    //Distance to the mesh origin stands in for its size on screen
+    const glm::vec3 eye = controller_ && controller_->cam_
+                              ? controller_->cam_->position_
+                              : glm::vec3(0.0f);
+    std::vector<std::pair<const BaseTexture*, float> > priorities;
+    for (Mesh* mesh : collectDrawList())
+        {
+            if (!mesh->tr_)
+                continue;
+            const float distance =
+                glm::distance(eye, glm::vec3(mesh->tr_->GetModel()[3]));
+            //Only the first texture is sampled
+            if (!mesh->textures_.empty())
+                TextureResidency::MarkSampled(*mesh->textures_.front(),
+                                              frameCounter_, distance);
+            for (std::size_t i = 0; i < mesh->textures_.size(); ++i)
+                if (mesh->textures_[i]->placeholder_ ||
+                    mesh->textures_[i]->skippedLevels_ > 0)
+                    priorities.emplace_back(mesh->sources_[i].get(), distance);
+        }
+    residency_->Update(frameCounter_);
+
+    TextureStreamer* streamer = meshFactory_->GetStreamer();
+    if (!streamer)
+        return;
+    if (!priorities.empty())
+        streamer->Prioritize(priorities);
+
+    auto arrivals = meshFactory_->PollStreamedTextures(streamBudget_);
+    if (arrivals.empty())
+        return;
+
+    std::unordered_map<const BaseTexture*, std::shared_ptr<Texture> > arrived;
+    for (auto& arrival : arrivals)
+        arrived.emplace(arrival.source_.get(), std::move(arrival.texture_));
+    //Replaces placeholders as well as textures restreamed for the budget
+    for (auto& mesh : meshes_)
+        for (std::size_t i = 0; i < mesh->textures_.size(); ++i)
+            {
+                auto found = arrived.find(mesh->sources_[i].get());
+                if (found == arrived.end() ||
+                    found->second == mesh->textures_[i])
+                    continue;
+                std::shared_ptr<Texture> previous =
+                    std::exchange(mesh->textures_[i], found->second);
+                if (i == 0)
+                    rebindMeshTexture(*mesh, std::move(previous));
+            }
+}
+
+void Renderer::rebindMeshTexture(Mesh&                    mesh,
+                                 std::shared_ptr<Texture> previous)
+{
+    if (!bindless_)
+        {
+            if (mesh.sh_->desSet_.empty())
+                return;
+            //Recorded command buffers bind the old set, it is written
+            //anew instead of in place. The old texture stays alive as long.
+            const VkDescriptorSet old = mesh.sh_->desSet_[0];
+            mesh.sh_->desSet_[0]      = meshSets_->Allocate();
+            writeMeshDescriptorSets(mesh);
+            //A layout change may replace meshSets_ meanwhile, its old
+            //allocator is released after this
+            deletionQueue_.Push(frameCounter_,
+                                [sets = meshSets_.get(), old,
+                                 previous = std::move(previous)]()
+            {
+                sets->Free(old);
+            });
+            invalidateCommandBuffers();
+            return;
+        }
+    if (mesh.textureSlot_ == Mesh::noTextureSlot || !textureTable_)
+        return;
+
+    //The slot of the previous texture may be read by frames in flight, so
+    //the texture gets its own and the object record switches to it. The
+    //old slot holds the previous texture until released. Recorded command
+    //buffers stay valid.
+    const uint32_t old = mesh.textureSlot_;
+    mesh.textureSlot_  = textureTable_->Acquire(mesh.textures_.front());
+    if (mesh.tr_)
+        mesh.tr_->SetTexture(mesh.textureSlot_);
+    deletionQueue_.Push(frameCounter_, [table = textureTable_.get(), old]()
+    {
+        table->Release(old);
+    });
+}
+
+void Renderer::writeFrameDescriptorSet(uint32_t image)
+{
+    std::vector<DescriptorData> data;
+    data.reserve(frameSets_->GetDescriptorCount());
+
+    for (const auto& layout : frameSets_->GetBindings())
+        {
+            DescriptorData descriptor {};
+            if (layout.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+                {
+                    UniformRange range;
+                    if (layout.binding == 0)
+                        range = frameUbo_;
+                    else if (layout.binding == 1 && lightsUbo_)
+                        range = lightsUbo_->buffers_;
+                    else if (layout.binding == 2)
+                        range = directionalShadowUbo_;
+                    else if (layout.binding == 4)
+                        range = pointShadowUbo_;
+                    else
+                        throw std::runtime_error(
+                            "unsupported uniform buffer binding in frame set");
+                    descriptor.buffer_ = uniformRing_->DescriptorInfo(image, range);
                 }
+            else if (layout.descriptorType ==
+                     VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+                {
+                    if (layout.binding != 6)
+                        throw std::runtime_error(
+                            "unsupported storage buffer binding in frame set");
+                    descriptor.buffer_ = objects_->DescriptorInfo(image);
+                }
+            else if (layout.descriptorType ==
+                     VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                {
+                    const ShadowMapArray* maps = nullptr;
+                    if (layout.binding == 3)
+                        maps = &directionalShadowMaps_;
+                    else if (layout.binding == 5)
+                        maps = &pointShadowMaps_;
+                    else
+                        throw std::runtime_error(
+                            "unsupported sampler binding in frame set");
+                    descriptor.image_ = {maps->sampler_, maps->view_,
+                                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+                }
+            else
+                throw std::runtime_error("unsupported binding in frame set");
+            data.insert(data.end(), layout.descriptorCount, descriptor);
+        }
+
+    frameSets_->Write(frameDescriptorSets_[image], data);
+}
+
+void Renderer::writeMeshDescriptorSets(Mesh& mesh)
+{
+    std::vector<DescriptorData> data;
+    data.reserve(meshSets_->GetDescriptorCount());
+
+    for (const auto& layout : meshSets_->GetBindings())
+        {
+            if (layout.descriptorType !=
+                    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+                layout.binding != 0)
+                throw std::runtime_error("unsupported binding in mesh set");
+            if (mesh.textures_.empty())
+                throw std::runtime_error(
+                    "mesh has no texture for sampler binding");
+            const auto& texture = *mesh.textures_.begin();
+            DescriptorData descriptor {};
+            descriptor.image_ = {texture->sampler_, texture->view_,
+                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+            data.insert(data.end(), layout.descriptorCount, descriptor);
         }
+
+    meshSets_->Write(mesh.sh_->desSet_[0], data);
 }
 
 void Renderer::Update()
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
 
+    discardShaderReload(true);
     vkDeviceWaitIdle(device);
 
     clearIncludePart();
 
     createUniformBuffers();
 
-    createDescriptorPool();
+    createDescriptorAllocators();
     createDescriptorSets();
     RecreateSwapChain();
     createCommandBuffers();
@@ -1050,11 +1622,12 @@ std::shared_ptr<Mesh> Renderer::AddMesh(BaseMesh* mesh)
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
 
-    meshes_.push_back(meshFactory_->CreateMesh(std::unique_ptr<BaseMesh>(mesh)));
-    meshes_.back()->sh_ = std::make_shared<Shader>(activeShader_);
-    markShadowsDirty();
-    Update();
-    return meshes_.back();
+    if (!mesh)
+        throw std::runtime_error("mesh is null");
+
+    std::vector<std::unique_ptr<BaseMesh> > meshes;
+    meshes.emplace_back(mesh);
+    return AddMeshes(std::move(meshes)).front();
 }
 
 std::vector<std::shared_ptr<Mesh> >
@@ -1065,33 +1638,149 @@ Renderer::AddMeshes(std::vector<std::unique_ptr<BaseMesh> > meshes)
     std::vector<std::shared_ptr<Mesh> > result;
     result.reserve(meshes.size());
 
-    bool addedAny = false;
-    for (auto& mesh : meshes)
+    for (auto& vkMesh : meshFactory_->CreateMeshes(std::move(meshes)))
         {
-            if (!mesh)
-                continue;
-            meshes_.push_back(meshFactory_->CreateMesh(std::move(mesh)));
-            meshes_.back()->sh_ = std::make_shared<Shader>(activeShader_);
-            result.push_back(meshes_.back());
-            addedAny = true;
+            vkMesh->sh_ = std::make_shared<Shader>(activeShader_);
+            result.push_back(std::move(vkMesh));
         }
 
-    if (addedAny)
-        {
-            markShadowsDirty();
-            Update();
-        }
+    if (result.empty())
+        return result;
+
+    //Copies run beside rendering, the first frame drawing the meshes waits
+    for (auto& mesh : result)
+        uploadValue_ = std::max(uploadValue_, mesh->uploadValue_);
+
+    meshes_.insert(meshes_.end(), result.begin(), result.end());
+    //Bumps drawVersion_, so the recorded command buffers are recorded
+    //again with the new meshes. Besides that they only need their own
+    //uniform range and descriptor sets.
+    invalidateCommandBuffers();
+    if (meshes_.size() + retiredMeshes_ > meshCapacity_)
+        growMeshCapacity(meshes_.size() + retiredMeshes_);
+    else
+        for (auto& mesh : result)
+            attachMesh(*mesh);
+    markShadowsDirty();
 
     return result;
 }
 
+void Renderer::RemoveMesh(const std::shared_ptr<Mesh>& mesh)
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    auto it = std::find(meshes_.begin(), meshes_.end(), mesh);
+    if (it == meshes_.end())
+        return;
+
+    meshes_.erase(it);
+    retireMesh(mesh);
+    invalidateCommandBuffers();
+    markShadowsDirty();
+}
+
 void Renderer::ClearMeshes()
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
 
+    for (auto& mesh : meshes_)
+        retireMesh(mesh);
     meshes_.clear();
+    invalidateCommandBuffers();
     markShadowsDirty();
-    Update();
+}
+
+void Renderer::attachMesh(Mesh& mesh)
+{
+    mesh.tr_ = meshFactory_->CreateUBOBuffers(*objects_);
+    mesh.tr_->SetModelChangedCallback(
+        std::bind(&Renderer::markShadowsDirty, this));
+    attachMeshTexture(mesh);
+}
+
+void Renderer::retireMesh(std::shared_ptr<Mesh> mesh)
+{
+    //Frames in flight may still read the transform range and descriptor
+    //sets, so they are released only after those frames complete. The
+    //transform stays, callers holding the mesh may still update it.
+    ++retiredMeshes_;
+    //Sets and slots belong to the allocators of the time, a layout change
+    //retires those after this
+    deletionQueue_.Push(frameCounter_, [this, mesh, sets = meshSets_.get(),
+                                        table = textureTable_.get()]()
+    {
+        --retiredMeshes_;
+        if (mesh->sh_ && sets)
+            for (auto set : mesh->sh_->desSet_)
+                sets->Free(set);
+        if (mesh->sh_)
+            mesh->sh_->desSet_.clear();
+        if (table && mesh->textureSlot_ != Mesh::noTextureSlot)
+            table->Release(mesh->textureSlot_);
+        mesh->textureSlot_ = Mesh::noTextureSlot;
+        if (mesh->tr_)
+            mesh->tr_->Release();
+    });
+}
+
+void Renderer::growMeshCapacity(std::size_t count)
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    while (meshCapacity_ < count)
+        meshCapacity_ *= 2;
+    LOG_INFO(logger_.get(), "Growing mesh capacity to {}", meshCapacity_);
+
+    //The old ring and frame sets stay alive for the frames in flight,
+    //every mesh gets a new range while its texture set is kept
+    std::shared_ptr<UniformRing> oldRing(std::move(uniformRing_));
+    std::shared_ptr<LightsUBO>   oldLights(std::move(lightsUbo_));
+    std::shared_ptr<ObjectTable> oldObjects(std::move(objects_));
+    std::vector<std::shared_ptr<TransformUBO> > oldTransforms;
+    oldTransforms.reserve(meshes_.size());
+    for (auto& mesh : meshes_)
+        oldTransforms.emplace_back(std::move(mesh->tr_));
+    std::vector<VkDescriptorSet> oldFrameSets = std::move(frameDescriptorSets_);
+    frameDescriptorSets_.clear();
+    auto oldIndirect = std::make_shared<std::vector<std::unique_ptr<Buffer> > >(
+        std::move(indirectBuffers_));
+
+    createUniformBuffers();
+    auto oldTransform = oldTransforms.begin();
+    for (auto& mesh : meshes_)
+        {
+            const auto& old = *oldTransform++;
+            if (old)
+                mesh->tr_->updateModel(old->GetModel());
+        }
+    createDescriptorSets();
+    //Recorded buffers bind the sets that are about to be released
+    invalidateCommandBuffers();
+
+    deletionQueue_.Push(
+        frameCounter_,
+        [sets = frameSets_.get(), oldRing, oldLights, oldObjects,
+         oldTransforms, oldFrameSets, oldIndirect]() mutable
+        {
+            oldIndirect.reset();
+            //Slots and ranges are returned to their owners, so the ring
+            //goes last
+            oldTransforms.clear();
+            oldObjects.reset();
+            oldLights.reset();
+            oldRing.reset();
+            for (auto set : oldFrameSets)
+                sets->Free(set);
+        });
+}
+
+uint64_t Renderer::completedFrames() const
+{
+    //Waiting on the fence of the current slot proves that every frame but
+    //the last maxFramesInFlight_ - 1 submitted ones has finished
+    const auto inFlight = static_cast<uint64_t>(maxFramesInFlight_ - 1);
+    return frameCounter_ > inFlight ? frameCounter_ - inFlight : 0;
 }
 
 void Renderer::markShadowsDirty()
@@ -1103,9 +1792,8 @@ void Renderer::clearIncludePart()
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
 
-    //materialUBO_.clear();
-    //TransformUBO.clear();
-    //viewPosUBO_.clear();
+    //Device is idle here, nothing retired is in use anymore
+    deletionQueue_.FlushAll();
 
     for (auto& mesh : meshes_)
         {
@@ -1119,8 +1807,11 @@ void Renderer::clearIncludePart()
         }*/
         }
     lightsUbo_.reset();
-    directionalShadowUboBuffers_.clear();
-    pointShadowUboBuffers_.clear();
+    objects_.reset();
+    frameUbo_             = {};
+    directionalShadowUbo_ = {};
+    pointShadowUbo_       = {};
+    uniformRing_.reset();
     if (shadowRenderer_)
         {
             for (auto& cmd : shadowCommandBuffersInFlight_)
@@ -1138,14 +1829,18 @@ void Renderer::clearIncludePart()
                          static_cast<uint32_t>(commandBuffers_.size()),
                          commandBuffers_.data());
     commandBuffers_.clear();
-    vkDestroyDescriptorPool(device, descriptorPool_, nullptr);
-    descriptorPool_ = VK_NULL_HANDLE;
+    //Frame sets reference the ring, mesh sets stay valid
+    if (frameSets_)
+        for (auto set : frameDescriptorSets_)
+            frameSets_->Free(set);
+    frameDescriptorSets_.clear();
 }
 
 Renderer::~Renderer()
 {
     LOG_TRACE_L1(logger_.get(), __FUNCTION__);
 
+    discardShaderReload(false);
     vkDeviceWaitIdle(device);
 
     for (auto& light : lights_)
@@ -1156,12 +1851,18 @@ Renderer::~Renderer()
 
     syncers_.clear();
 
+    vkDestroyDescriptorSetLayout(device, frameSetLayout_, nullptr);
+    frameSetLayout_ = VK_NULL_HANDLE;
     vkDestroyDescriptorSetLayout(device, descriptorSetLayout_, nullptr);
     descriptorSetLayout_ = VK_NULL_HANDLE;
     clearIncludePart();
+    textureTable_.reset();
+    meshSets_.reset();
+    frameSets_.reset();
     vkDestroyPipeline(device, graphicsPipeline_, nullptr);
     graphicsPipeline_ = VK_NULL_HANDLE;
     shadowRenderer_.reset();
+    recorder_.reset();
     shadowPass_.reset();
     shadowResources_.reset();
     pointShadowMaps_ = {};
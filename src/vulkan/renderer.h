@@ -7,19 +7,30 @@
 #include "objects/texture.h"
 #include "objects/buffer.h"
 #include "syncer.h"
+#include "uniform_ring.h"
+#include "deletion_queue.h"
+#include "structures/frame_ubo.h"
 #include "structures/light_ubo.h"
 #include "structures/shadow_ubo.h"
 #include "shadow_resources.h"
 #include "shadow_pass.h"
 #include "shadow_renderer.h"
+#include "parallel_recorder.h"
+#include "texture_table.h"
+#include "texture_residency.h"
+#include "descriptor_allocator.h"
 #include "../utils/files_tools.h"
+#include "../utils/file_watcher.h"
 #include "../scene_objects/light.h"
 
+#include <array>
+#include <future>
 #include <vector>
 #include <set>
 #include <algorithm>
 #include <list>
 #include <memory>
+#include <string>
 #include <string_view>
 #include <functional>
 
@@ -32,12 +43,17 @@ class Renderer : public FrameChain
 {
 public:
     Renderer(std::shared_ptr<Window> pWnd);
+    /// \brief Headless renderer drawing offscreen with the given camera
+    Renderer(std::shared_ptr<PositionController> contr, VkExtent2D extent);
 
     ~Renderer();
 
     std::shared_ptr<Mesh> AddMesh(BaseMesh* mesh);
     std::vector<std::shared_ptr<Mesh> >
     AddMeshes(std::vector<std::unique_ptr<BaseMesh> > meshes);
+    /// \brief Stops drawing the mesh, its GPU resources are released once
+    /// the frames in flight no longer use them
+    void RemoveMesh(const std::shared_ptr<Mesh>& mesh);
     void ClearMeshes();
     void AddLight(std::shared_ptr<Multor::BLight> light);
     void SetLights(std::vector<std::shared_ptr<Multor::BLight> > lights);
@@ -47,6 +63,29 @@ public:
     bool IsLightingEnabled() const;
     void SetShadowsEnabled(bool enabled);
     bool IsShadowsEnabled() const;
+    /// \brief Draws the meshes with one indirect draw per bucket of meshes
+    /// sharing buffers and texture. Stays off if the device lacks
+    /// multiDrawIndirect or drawIndirectFirstInstance.
+    void SetIndirectDrawsEnabled(bool enabled);
+    bool IsIndirectDrawsEnabled() const;
+    /// \brief Encodes textures created afterwards to BC formats on the CPU.
+    /// Stays off if the device lacks textureCompressionBC.
+    void SetTextureCompressionEnabled(bool enabled);
+    bool IsTextureCompressionEnabled() const;
+    /// \brief Decodes and uploads textures of meshes added afterwards in
+    /// the background, nearest meshes first. Meshes sample a placeholder
+    /// until their texture has arrived.
+    void SetTextureStreamingEnabled(bool enabled);
+    bool IsTextureStreamingEnabled() const;
+    TextureStreamingStats GetTextureStreamingStats() const;
+    /// \brief Limits the texel bytes of mesh textures, 0 for no limit.
+    /// Textures drawn least recently drop mip levels beyond it and stream
+    /// them back in once drawn again and there is room.
+    void SetTextureBudget(VkDeviceSize bytes);
+    TextureResidencyStats GetTextureResidencyStats() const;
+    /// \brief Recreates the swapchain with \p mode, FIFO if the surface
+    /// lacks it. Ignored in headless mode.
+    void SetPresentMode(VkPresentModeKHR mode);
     const std::vector<std::shared_ptr<Multor::BLight> >& GetLights() const;
     std::shared_ptr<ShaderLayout>
     CreateShaderFromSource(std::string_view vertex, std::string_view fragment,
@@ -56,6 +95,12 @@ public:
                           std::string_view fragmentPath,
                           std::string_view geometryPath = "");
     void UseShader(const std::shared_ptr<ShaderLayout>& shader);
+    /// \brief Watches the source files of the main and shadow shaders.
+    /// Edited sets compile in the background and their pipelines replace
+    /// the current ones at a frame boundary, without waiting for the
+    /// device. A compile error keeps the current shaders.
+    void SetShaderHotReloadEnabled(bool enabled);
+    bool IsShaderHotReloadEnabled() const;
     void SetOverlayDrawCallback(std::function<void(VkCommandBuffer)> callback);
 
     void Draw();
@@ -65,26 +110,58 @@ public:
     {
         return imageIndex_;
     };
+    uint64_t GetFrameCount() const { return frameCounter_; }
+    ShaderCompileStats GetShaderCompileStats() const { return shFactory_->GetStats(); }
+    //Unique samplers shared by textures and shadow maps
+    std::size_t GetSamplerCount() const { return meshFactory_->GetSamplerCache()->GetCount(); }
+    VkExtent2D GetExtent() const { return swapChainExtent_; }
     VkInstance GetVkInstance() const { return instance; }
     VkPhysicalDevice GetVkPhysicalDevice() const { return physicDev; }
     VkDevice GetVkDevice() const { return device; }
     VkQueue GetVkGraphicsQueue() const { return graphicsQueue; }
     uint32_t GetVkGraphicsQueueFamilyIndex() const { return physicDevIndices.graphicsFamily.value(); }
     VkCommandPool GetVkCommandPool() const { return commandPool; }
+    VkPipelineCache GetVkPipelineCache() const { return pipelineCache_->Get(); }
     VkRenderPass GetVkRenderPass() const { return renderPass_; }
     uint32_t GetSwapchainImageCount() const { return static_cast<uint32_t>(swapChainImages_.size()); }
     uint32_t GetMinImageCount() const { return 2u; }
 
 private:
+    void init();
     void createGraphicsPipeline();
+    /// \brief Creates a pipeline of \p shader, thread safe as long as
+    /// \p layout and \p renderPass stay alive
+    VkPipeline buildGraphicsPipeline(const std::shared_ptr<ShaderLayout>& shader,
+                                     VkPipelineLayout layout,
+                                     VkRenderPass     renderPass) const;
     void createShadowPipeline();
     void createCommandBuffers();
     void createDescriptorSetLayout();
-    void createDescriptorPool();
+    void createDescriptorAllocators();
     void createDescriptorSets();
+    void writeFrameDescriptorSet(uint32_t image);
+    void writeMeshDescriptorSets(Mesh& mesh);
+    /// \brief Gives the mesh its texture, a slot in the TextureTable for
+    /// bindless shaders or a set of its own otherwise. Both are kept until
+    /// the mesh is retired or the shader changes.
+    void attachMeshTexture(Mesh& mesh);
+    /// \brief Marks the textures of the draw list as sampled, keeps them
+    /// within the budget and hands streamed textures to their meshes
+    void streamTextures();
+    /// \brief Points the mesh at its new first texture. Frames in flight
+    /// keep the previous slot or set, and \p previous, until they complete.
+    void rebindMeshTexture(Mesh& mesh, std::shared_ptr<Texture> previous);
+    void attachMesh(Mesh& mesh);
+    void retireMesh(std::shared_ptr<Mesh> mesh);
+    void growMeshCapacity(std::size_t count);
+    uint64_t completedFrames() const;
     void createUniformBuffers();
     void createSyncObjects();
+    /// \brief Records the command buffer of \p index unless it is still
+    /// valid for the current draw list
     void recordCommandBuffer(uint32_t index);
+    void invalidateCommandBuffers();
+    std::vector<Mesh*> collectDrawList() const;
 
     bool hasStencilComponent(VkFormat format);
 
@@ -96,36 +173,150 @@ private:
     void drawDirectionalShadows();
     void drawPointShadows();
 
+private:
+    //Recorder slots of every image, each kind is reset at its own pace
+    enum RecordSlot : uint32_t
+    {
+        SceneSlot,
+        ShadowSlot,
+        OverlaySlot,
+        RecordSlotKinds
+    };
+
+    //Inputs a recorded command buffer was built from
+    struct RecordedImage
+    {
+        uint64_t                     version_ = 0;
+        bool                         overlay_ = false;
+        std::vector<VkCommandBuffer> secondaries_;
+    };
+
+    //Run of draw records sharing vertex, index buffer and mesh set
+    struct DrawBucket
+    {
+        const Mesh* mesh_;
+        uint32_t    first_;
+        uint32_t    count_;
+    };
+
+    //Source files of a shader set
+    struct ShaderFiles
+    {
+        std::string vertex_;
+        std::string fragment_;
+    };
+    /// \brief Paths of shader sources in the shader directory, resolved
+    /// against the executable so they do not depend on the working
+    /// directory
+    static ShaderFiles shaderFiles(std::string_view vertex,
+                                   std::string_view fragment);
+    /// \brief Source of a main shader stage, with BINDLESS defined if
+    /// the device supports the bindless texture table
+    std::string loadShaderSource(const std::string& path) const;
+
+    //Shaders and pipelines built by a background reload
+    struct ShaderReload
+    {
+        std::shared_ptr<ShaderLayout> main_;
+        std::shared_ptr<ShaderLayout> shadow_;
+        VkPipeline                    mainPipeline_   = VK_NULL_HANDLE;
+        VkPipeline                    shadowPipeline_ = VK_NULL_HANDLE;
+        //Descriptor bindings differ from the current set layouts, no
+        //pipelines are built
+        bool                          layoutChanged_  = false;
+    };
+
+    uint32_t recordSlot(RecordSlot kind, uint32_t image) const;
+    std::vector<DrawBucket> buildDrawBuckets(std::vector<Mesh*> drawList,
+                                             uint32_t           image);
+
+    /// \brief Starts a reload of edited shaders or applies a finished one,
+    /// called between frames
+    void pollShaderReload();
+    void startShaderReload();
+    void applyShaderReload(ShaderReload reload);
+    /// \brief Switches to shaders with different descriptor bindings
+    /// without waiting for the device, everything built on the old layouts
+    /// is retired through the deletion queue
+    void swapShaderLayouts(std::shared_ptr<ShaderLayout> main,
+                           std::shared_ptr<ShaderLayout> shadow);
+    /// \brief Waits for a running reload and drops its result, which was
+    /// built against the render pass and layouts about to change. With
+    /// \p restart the next poll reloads the edited files again.
+    void discardShaderReload(bool restart);
+
 private:
     const int maxFramesInFlight_ = 3;
     size_t    currentFrame_      = 0;
     uint32_t  imageIndex_        = 0;
+    //Submitted frames, also replaces image acquisition in headless mode
+    uint64_t  frameCounter_      = 0;
 
     Logging::Logger& logger_;
 
+    std::shared_ptr<PositionController> controller_;
+
     std::unique_ptr<ShaderFactory>              shFactory_;
     std::vector<std::shared_ptr<ShaderLayout> > shaders_;
     std::shared_ptr<ShaderLayout>               activeShader_;
     std::shared_ptr<ShaderLayout>               shadowDirectionalShader_;
+    const ShaderFiles mainShaderFiles_ = shaderFiles("Base.vs", "Base.frag");
+    const ShaderFiles shadowShaderFiles_ =
+        shaderFiles("ShadowDirectional.vs", "ShadowDirectional.frag");
+    std::unique_ptr<FileWatcher> shaderWatcher_;
+    std::future<ShaderReload>    shaderReload_;
+    bool                         restartShaderReload_ = false;
 
     VkPipelineLayout      pipelineLayout_      = VK_NULL_HANDLE;
     VkPipeline            graphicsPipeline_    = VK_NULL_HANDLE;
+    //Set 0 holds camera, lights and shadows, set 1 the per mesh data
+    VkDescriptorSetLayout frameSetLayout_      = VK_NULL_HANDLE;
     VkDescriptorSetLayout descriptorSetLayout_ = VK_NULL_HANDLE;
-    VkDescriptorPool      descriptorPool_      = VK_NULL_HANDLE;
+    std::unique_ptr<DescriptorAllocator> frameSets_;
+    //Per mesh sets of shaders without the bindless texture table
+    std::unique_ptr<DescriptorAllocator> meshSets_;
+    std::vector<VkDescriptorSet>         frameDescriptorSets_;
+    //Meshes the uniform ring and descriptor pools are sized for
+    std::size_t   meshCapacity_ = 64;
+    //Removed meshes whose uniform ranges are not released yet
+    std::size_t   retiredMeshes_ = 0;
+    DeletionQueue deletionQueue_;
+    //Set 1 of the active shader is a bindless texture array
+    bool                          bindless_         = false;
+    uint32_t                      bindlessCapacity_ = 4096;
+    std::unique_ptr<TextureTable> textureTable_;
+    //Streamed texture bytes staged per frame, bounds the frame time spent
+    //creating images
+    VkDeviceSize                  streamBudget_ = VkDeviceSize(32) << 20;
+    std::unique_ptr<TextureResidency> residency_;
+    //Upload semaphore value of the most recently added meshes
+    uint64_t      uploadValue_ = 0;
 
     std::vector<VkCommandBuffer> commandBuffers_;
+    std::unique_ptr<ParallelRecorder> recorder_;
+    std::vector<RecordedImage>        recorded_;
+    //Bumped whenever meshes, pipeline or descriptor sets change
+    uint64_t                          drawVersion_ = 1;
     std::vector<VkCommandBuffer> shadowCommandBuffersInFlight_;
     std::vector<Syncer>          syncers_;
     VkFence shadowMapsInFlightFence_ = VK_NULL_HANDLE;
     bool shadowMapsDirty_ = true;
     bool lightingEnabled_ = true;
     bool shadowsEnabled_ = true;
+    bool indirectDraws_ = false;
 
+    //Per frame uniform data of lights, shadows and meshes
+    std::unique_ptr<UniformRing> uniformRing_;
+    //Model matrices of all meshes, indexed by the draw's firstInstance
+    std::unique_ptr<ObjectTable> objects_;
+    //Draw records of the indirect path, one buffer per image
+    std::vector<std::unique_ptr<Buffer> > indirectBuffers_;
     std::list<std::shared_ptr<Mesh> > meshes_;
     std::vector<std::shared_ptr<Multor::BLight> > lights_;
     std::unique_ptr<LightsUBO> lightsUbo_;
-    std::vector<std::unique_ptr<Buffer> > directionalShadowUboBuffers_;
-    std::vector<std::unique_ptr<Buffer> > pointShadowUboBuffers_;
+    UniformRange frameUbo_;
+    UniformRange directionalShadowUbo_;
+    UniformRange pointShadowUbo_;
     std::unique_ptr<ShadowResources> shadowResources_;
     std::unique_ptr<ShadowPass> shadowPass_;
     std::unique_ptr<ShadowRenderer> shadowRenderer_;
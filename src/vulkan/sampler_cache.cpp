@@ -0,0 +1,66 @@
+/// \file sampler_cache.cpp
+
+#include "sampler_cache.h"
+
+#include <bit>
+#include <stdexcept>
+
+namespace Multor::Vulkan
+{
+
+SamplerCache::SamplerCache(VkDevice device)
+    : logger_(Logging::LoggerFactory::GetLogger("vulkan.log")), device_(device)
+{
+}
+
+SamplerCache::~SamplerCache()
+{
+    for (const auto& [key, sampler] : samplers_)
+        vkDestroySampler(device_, sampler, nullptr);
+}
+
+VkSampler SamplerCache::Get(const VkSamplerCreateInfo& info)
+{
+    if (info.pNext != nullptr)
+        throw std::runtime_error("sampler cache does not support pNext!");
+
+    const Key                   key = makeKey(info);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto it = samplers_.find(key); it != samplers_.end())
+        return it->second;
+
+    VkSampler sampler = VK_NULL_HANDLE;
+    if (vkCreateSampler(device_, &info, nullptr, &sampler) != VK_SUCCESS)
+        throw std::runtime_error("failed to create sampler!");
+    samplers_.emplace(key, sampler);
+    LOG_INFO(logger_.get(), "Created sampler, {} unique", samplers_.size());
+    return sampler;
+}
+
+std::size_t SamplerCache::GetCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return samplers_.size();
+}
+
+SamplerCache::Key SamplerCache::makeKey(const VkSamplerCreateInfo& info)
+{
+    return {info.flags,
+            static_cast<uint32_t>(info.magFilter),
+            static_cast<uint32_t>(info.minFilter),
+            static_cast<uint32_t>(info.mipmapMode),
+            static_cast<uint32_t>(info.addressModeU),
+            static_cast<uint32_t>(info.addressModeV),
+            static_cast<uint32_t>(info.addressModeW),
+            std::bit_cast<uint32_t>(info.mipLodBias),
+            info.anisotropyEnable,
+            std::bit_cast<uint32_t>(info.maxAnisotropy),
+            info.compareEnable,
+            static_cast<uint32_t>(info.compareOp),
+            std::bit_cast<uint32_t>(info.minLod),
+            std::bit_cast<uint32_t>(info.maxLod),
+            static_cast<uint32_t>(info.borderColor),
+            info.unnormalizedCoordinates};
+}
+
+} // namespace Multor::Vulkan
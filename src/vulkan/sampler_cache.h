@@ -0,0 +1,52 @@
+/// \file sampler_cache.h
+
+#pragma once
+
+#include "../logger/logger.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+#include <vulkan/vulkan.h>
+
+namespace Multor::Vulkan
+{
+
+/// \brief One VkSampler per distinct VkSamplerCreateInfo of the device.
+///
+/// Samplers are immutable and cheap to share, but drivers limit how many
+/// can exist (maxSamplerAllocationCount). Every texture, shadow map and
+/// overlay asking for the same state gets the same handle. Samplers live
+/// until the cache is destroyed, holders never destroy them.
+class SamplerCache
+{
+public:
+    explicit SamplerCache(VkDevice device);
+    ~SamplerCache();
+
+    SamplerCache(const SamplerCache&)            = delete;
+    SamplerCache& operator=(const SamplerCache&) = delete;
+
+    /// \brief Sampler of \p info, created on first request. Extension
+    /// structures in pNext are not supported.
+    VkSampler Get(const VkSamplerCreateInfo& info);
+    //Unique samplers alive
+    std::size_t GetCount() const;
+
+private:
+    //Every field of VkSamplerCreateInfo but sType and pNext, floats by bits
+    using Key = std::array<uint32_t, 16>;
+    static Key makeKey(const VkSamplerCreateInfo& info);
+
+private:
+    Logging::Logger& logger_;
+
+    VkDevice                 device_;
+    std::map<Key, VkSampler> samplers_;
+    mutable std::mutex       mutex_;
+};
+
+} // namespace Multor::Vulkan
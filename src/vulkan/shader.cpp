@@ -3,20 +3,100 @@
 
 #include <stdexcept>
 
+#include <glslang/Include/Types.h>
+
 namespace Multor::Vulkan
 {
 
-ShaderLayout::ShaderLayout(){}
+namespace
+{
+
+uint32_t descriptorSetOf(const glslang::TObjectReflection& object)
+{
+    const glslang::TType* type = object.getType();
+    if (type && type->getQualifier().hasSet())
+        return type->getQualifier().layoutSet;
+    return 0;
+}
+
+} // namespace
+
+ShaderLayout::ShaderLayout(VkDevice device) : device_(device) {}
+
+ShaderLayout::~ShaderLayout()
+{
+    ReleaseModules();
+}
+
+void ShaderLayout::ReleaseModules()
+{
+    if (device_ != VK_NULL_HANDLE)
+        for (const auto& unit : units_)
+            vkDestroyShaderModule(device_, unit.module, nullptr);
+    units_.clear();
+}
+
+std::vector<ReflectedBinding>
+ShaderLayout::Reflect(const glslang::TProgram& program)
+{
+    std::vector<ReflectedBinding> bindings;
+
+    for (std::size_t i{0}; i < program.getNumUniformBlocks(); ++i)
+        {
+            const auto& block =
+                program.getUniformBlock(static_cast<std::int32_t>(i));
+            bindings.push_back({descriptorSetOf(block),
+                                static_cast<std::uint32_t>(block.getBinding()),
+                                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1});
+        }
+
+    for (std::size_t i{0}; i < program.getNumBufferBlocks(); ++i)
+        {
+            const auto& block =
+                program.getBufferBlock(static_cast<std::int32_t>(i));
+            bindings.push_back({descriptorSetOf(block),
+                                static_cast<std::uint32_t>(block.getBinding()),
+                                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1});
+        }
+
+    for (std::size_t i{0}; i < program.getNumUniformVariables(); ++i)
+        {
+            const auto& uniform =
+                program.getUniform(static_cast<std::int32_t>(i));
+            const int binding = uniform.getBinding();
+            if (binding < 0)
+                continue;
+            //Plain members of uniform blocks are reported here as well
+            if (uniform.getType() &&
+                uniform.getType()->getBasicType() != glslang::EbtSampler)
+                continue;
+            //Runtime sized arrays are reported as 0, the renderer sizes them
+            std::uint32_t count = 1;
+            if (uniform.getType() && uniform.getType()->isUnsizedArray())
+                count = 0;
+            else if (uniform.getType() && uniform.getType()->isSizedArray())
+                count = static_cast<std::uint32_t>(
+                    uniform.getType()->getCumulativeArraySize());
+            bindings.push_back({descriptorSetOf(uniform),
+                                static_cast<std::uint32_t>(binding),
+                                VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                count});
+        }
+
+    return bindings;
+}
 
 void ShaderLayout::AddShaderModule(VkShaderModule modul, shader_type type,
-                                   std::unique_ptr<glslang::TProgram> program)
+                                   const std::vector<ReflectedBinding>& bindings)
 {
     const auto stageFlags = static_cast<unsigned int>(
         ShaderConverter::convert<VkShaderStageFlagBits>(type));
     auto addOrMergeLayoutBinding =
-        [this](VkDescriptorSetLayoutBinding binding)
+        [this](uint32_t set, VkDescriptorSetLayoutBinding binding)
     {
-        for (auto& existing : layouts_)
+        if (layouts_.size() <= set)
+            layouts_.resize(set + 1);
+        for (auto& existing : layouts_[set])
             {
                 if (existing.binding == binding.binding)
                     {
@@ -32,35 +112,16 @@ void ShaderLayout::AddShaderModule(VkShaderModule modul, shader_type type,
                         return;
                     }
             }
-        layouts_.push_back(binding);
+        layouts_[set].push_back(binding);
     };
 
     addPipShStInfo(modul, ShaderConverter::convert<VkShaderStageFlagBits>(type),
                    "main");
 
-    for (std::size_t i{0}; i < program->getNumUniformBlocks(); ++i)
-        {
-            addOrMergeLayoutBinding(VkDescriptorSetLayoutBinding {
-                static_cast<std::uint32_t>(program->getUniformBlock(static_cast<std::int32_t>(i)).getBinding()),
-                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1,
-                stageFlags,
-                nullptr});
-        }
-
-    for (std::size_t i{0}; i < program->getNumUniformVariables(); ++i)
-        {
-            const int binding =
-                program->getUniform(static_cast<std::int32_t>(i)).getBinding();
-            if (binding < 0)
-                continue;
-            addOrMergeLayoutBinding(VkDescriptorSetLayoutBinding {
-                static_cast<std::uint32_t>(binding),
-                VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1,
-                stageFlags,
-                nullptr});
-        }
-
-    prg_ = program.release();
+    for (const ReflectedBinding& reflected : bindings)
+        addOrMergeLayoutBinding(reflected.set_, VkDescriptorSetLayoutBinding {
+            reflected.binding_, reflected.type_, reflected.count_, stageFlags,
+            nullptr});
 }
 
 void ShaderLayout::addPipShStInfo(VkShaderModule        modul,
@@ -86,9 +147,15 @@ const std::vector<VkPipelineShaderStageCreateInfo>* ShaderLayout::GetStages()
 }
 
 const std::vector<VkDescriptorSetLayoutBinding>*
-ShaderLayout::GetLayoutBindings()
+ShaderLayout::GetLayoutBindings(uint32_t set)
+{
+    static const std::vector<VkDescriptorSetLayoutBinding> empty;
+    return (set < layouts_.size()) ? &layouts_[set] : &empty;
+}
+
+uint32_t ShaderLayout::GetSetCount() const
 {
-    return &layouts_;
+    return static_cast<uint32_t>(layouts_.size());
 }
 
 } // namespace Multor::Vulkan
@@ -60,26 +60,53 @@ private:
              shader_type::geometry}};
 };
 
+/// \brief Descriptor binding used by one shader stage
+struct ReflectedBinding
+{
+    uint32_t         set_;
+    uint32_t         binding_;
+    VkDescriptorType type_;
+    //0 for a runtime sized array
+    uint32_t         count_;
+};
+
+/// \brief Shader modules of a set and the descriptor bindings they use.
+///
+/// Owns its modules, pipelines built from them stay valid after the layout
+/// is released.
 class ShaderLayout
 {
 public:
-    ShaderLayout();
-
+    explicit ShaderLayout(VkDevice device = VK_NULL_HANDLE);
+    ShaderLayout(const ShaderLayout&)            = delete;
+    ShaderLayout& operator=(const ShaderLayout&) = delete;
+    ~ShaderLayout();
+
+    /// \brief Descriptor bindings used by a linked single stage program
+    static std::vector<ReflectedBinding>
+         Reflect(const glslang::TProgram& program);
+    /// \brief Takes ownership of \p modul
     void AddShaderModule(VkShaderModule modul, shader_type type,
-                         std::unique_ptr<glslang::TProgram> programm);
+                         const std::vector<ReflectedBinding>& bindings);
+    /// \brief Destroys the modules before the device, the stages are
+    /// cleared
+    void ReleaseModules();
 
     const std::vector<VkPipelineShaderStageCreateInfo>* GetStages();
-    const std::vector<VkDescriptorSetLayoutBinding>*    GetLayoutBindings();
+    /// \brief Reflected bindings of descriptor set \p set
+    const std::vector<VkDescriptorSetLayoutBinding>*
+             GetLayoutBindings(uint32_t set = 0);
+    uint32_t GetSetCount() const;
 
 private:
-    glslang::TProgram* prg_ = nullptr;
-
     void addPipShStInfo(VkShaderModule modul, VkShaderStageFlagBits stage,
                         const char* entryPointName);
     //getShaderVariables();
 
+    VkDevice                                     device_;
     std::vector<VkPipelineShaderStageCreateInfo> units_;
-    std::vector<VkDescriptorSetLayoutBinding>    layouts_;
+    //Bindings per descriptor set index
+    std::vector<std::vector<VkDescriptorSetLayoutBinding> > layouts_;
 };
 
 class Shader
@@ -0,0 +1,167 @@
+/// \file shader_cache.cpp
+
+#include "shader_cache.h"
+
+#include <sqlite3.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace Multor::Vulkan
+{
+
+namespace
+{
+
+//Length prefixed, so field boundaries are part of the hash
+void fnv1a(uint64_t& hash, const void* data, std::size_t size)
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    const auto  len   = static_cast<uint64_t>(size);
+    for (std::size_t i = 0; i < sizeof(len); ++i)
+        hash = (hash ^ ((len >> (8 * i)) & 0xFF)) * 0x100000001b3ull;
+    for (std::size_t i = 0; i < size; ++i)
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+}
+
+const char* const createTable =
+    "CREATE TABLE IF NOT EXISTS stages ("
+    "key TEXT PRIMARY KEY, source BLOB NOT NULL, "
+    "spirv BLOB NOT NULL, bindings BLOB NOT NULL)";
+
+} // namespace
+
+ShaderCache::ShaderCache(const std::filesystem::path& file)
+    : logger_(Logging::LoggerFactory::GetLogger("vulkan.log"))
+{
+    std::error_code error;
+    std::filesystem::create_directories(file.parent_path(), error);
+
+    if (sqlite3_open(file.string().c_str(), &db_) != SQLITE_OK)
+        {
+            logError("open");
+            sqlite3_close(db_);
+            db_ = nullptr;
+            return;
+        }
+    if (sqlite3_exec(db_, createTable, nullptr, nullptr, nullptr) != SQLITE_OK)
+        {
+            logError("create table");
+            sqlite3_close(db_);
+            db_ = nullptr;
+            return;
+        }
+    LOG_INFO(logger_.get(), "Shader cache {}", file.string());
+}
+
+ShaderCache::~ShaderCache()
+{
+    sqlite3_close(db_);
+}
+
+std::string ShaderCache::MakeKey(std::string_view source, shader_type stage,
+                                 std::string_view environment)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    fnv1a(hash, source.data(), source.size());
+    fnv1a(hash, &stage, sizeof(stage));
+    fnv1a(hash, environment.data(), environment.size());
+
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx",
+                  static_cast<unsigned long long>(hash));
+    return key;
+}
+
+bool ShaderCache::Load(const std::string& key, std::string_view source,
+                       Entry& entry)
+{
+    if (!db_)
+        return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_,
+                           "SELECT source, spirv, bindings FROM stages "
+                           "WHERE key = ?1",
+                           -1, &stmt, nullptr) != SQLITE_OK)
+        {
+            logError("prepare lookup");
+            return false;
+        }
+    sqlite3_bind_text(stmt, 1, key.c_str(), -1, SQLITE_STATIC);
+
+    bool found = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            const auto* stored =
+                static_cast<const char*>(sqlite3_column_blob(stmt, 0));
+            const int   storedSize   = sqlite3_column_bytes(stmt, 0);
+            const void* spirv        = sqlite3_column_blob(stmt, 1);
+            const int   spirvSize    = sqlite3_column_bytes(stmt, 1);
+            const void* bindings     = sqlite3_column_blob(stmt, 2);
+            const int   bindingsSize = sqlite3_column_bytes(stmt, 2);
+
+            found = std::string_view(stored ? stored : "",
+                                     static_cast<std::size_t>(storedSize)) ==
+                        source &&
+                    spirvSize > 0 && spirvSize % sizeof(unsigned int) == 0 &&
+                    bindingsSize % sizeof(ReflectedBinding) == 0;
+            if (found)
+                {
+                    entry.spirv_.resize(spirvSize / sizeof(unsigned int));
+                    std::memcpy(entry.spirv_.data(), spirv, spirvSize);
+                    entry.bindings_.resize(bindingsSize /
+                                           sizeof(ReflectedBinding));
+                    if (bindingsSize > 0)
+                        std::memcpy(entry.bindings_.data(), bindings,
+                                    bindingsSize);
+                }
+        }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+void ShaderCache::Store(const std::string& key, std::string_view source,
+                        const Entry& entry)
+{
+    if (!db_)
+        return;
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_,
+                           "INSERT OR REPLACE INTO stages "
+                           "(key, source, spirv, bindings) "
+                           "VALUES (?1, ?2, ?3, ?4)",
+                           -1, &stmt, nullptr) != SQLITE_OK)
+        {
+            logError("prepare insert");
+            return;
+        }
+    sqlite3_bind_text(stmt, 1, key.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 2, source.data(), static_cast<int>(source.size()),
+                      SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 3, entry.spirv_.data(),
+                      static_cast<int>(entry.spirv_.size() * sizeof(unsigned int)),
+                      SQLITE_STATIC);
+    //Zero length blobs have to be non null to satisfy NOT NULL
+    sqlite3_bind_blob(stmt, 4, entry.bindings_.empty()
+                                   ? static_cast<const void*>("")
+                                   : entry.bindings_.data(),
+                      static_cast<int>(entry.bindings_.size() *
+                                       sizeof(ReflectedBinding)),
+                      SQLITE_STATIC);
+    if (sqlite3_step(stmt) != SQLITE_DONE)
+        logError("insert");
+    sqlite3_finalize(stmt);
+}
+
+void ShaderCache::logError(const char* what)
+{
+    LOG_WARNING(logger_.get(), "Shader cache {} failed: {}", what,
+                db_ ? sqlite3_errmsg(db_) : "no database");
+}
+
+} // namespace Multor::Vulkan
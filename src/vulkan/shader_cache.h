@@ -0,0 +1,61 @@
+/// \file shader_cache.h
+
+#pragma once
+
+#include "../logger/logger.h"
+#include "shader.h"
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct sqlite3;
+
+namespace Multor::Vulkan
+{
+
+/// \brief SPIR-V and reflected bindings of compiled shader stages, stored
+/// in an SQLite database.
+///
+/// Entries are addressed by a hash of everything the compilation depends
+/// on, see MakeKey. The source is stored next to the result and compared
+/// on lookup, so a hash collision is a miss and never a wrong shader.
+/// If the database can not be opened the cache stays empty.
+class ShaderCache
+{
+public:
+    struct Entry
+    {
+        std::vector<unsigned int>     spirv_;
+        std::vector<ReflectedBinding> bindings_;
+    };
+
+    explicit ShaderCache(const std::filesystem::path& file);
+    ~ShaderCache();
+
+    ShaderCache(const ShaderCache&)            = delete;
+    ShaderCache& operator=(const ShaderCache&) = delete;
+
+    /// \param environment Compiler version, target and options of the stage
+    static std::string MakeKey(std::string_view source, shader_type stage,
+                               std::string_view environment);
+
+    bool Load(const std::string& key, std::string_view source, Entry& entry);
+    void Store(const std::string& key, std::string_view source,
+               const Entry& entry);
+
+    bool IsOpen() const { return db_ != nullptr; }
+
+private:
+    void logError(const char* what);
+
+private:
+    Logging::Logger& logger_;
+
+    sqlite3*   db_ = nullptr;
+    std::mutex mutex_;
+};
+
+} // namespace Multor::Vulkan
@@ -1,23 +1,79 @@
 /// \file shader_factory.cpp
 
 #include "shader_factory.h"
+#include "../logger/logger.h"
+
+#include <glslang/build_info.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 
 namespace Multor::Vulkan
 {
 
-ShaderFactory::ShaderFactory(VkDevice& device)
+namespace
+{
+
+//Part of every cache key, bump when resource limits or compile and
+//reflection options change
+constexpr int cacheRevision = 2;
+
+constexpr int                               glslDefaultVersion = 450;
+constexpr glslang::EShTargetClientVersion   vulkanTarget =
+    glslang::EShTargetVulkan_1_0;
+constexpr glslang::EShTargetLanguageVersion spirvTarget =
+    glslang::EShTargetSpv_1_0;
+
+} // namespace
+
+ShaderFactory::ShaderFactory(VkDevice& device,
+                             const std::filesystem::path& cacheFile,
+                             uint32_t threads)
 {
     //CreatedModules.reserve(10);
     device_ = device;
     InitResource();
     glslang::InitializeProcess();
+
+    if (!cacheFile.empty())
+        {
+            cache_ = std::make_unique<ShaderCache>(cacheFile);
+            if (!cache_->IsOpen())
+                cache_.reset();
+        }
+
+    char environment[128];
+    std::snprintf(environment, sizeof(environment),
+                  "r%d glslang %d.%d.%d%s vulkan %d spirv %d glsl %d",
+                  cacheRevision, GLSLANG_VERSION_MAJOR, GLSLANG_VERSION_MINOR,
+                  GLSLANG_VERSION_PATCH, GLSLANG_VERSION_FLAVOR,
+                  static_cast<int>(vulkanTarget), static_cast<int>(spirvTarget),
+                  glslDefaultVersion);
+    environment_ = environment;
+
+    if (threads == 0)
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    threads_.reserve(threads);
+    for (uint32_t i = 0; i < threads; ++i)
+        threads_.emplace_back(&ShaderFactory::workerLoop, this);
 }
 
 ShaderFactory::~ShaderFactory()
 {
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex_);
+        stop_ = true;
+    }
+    jobsReady_.notify_all();
+    //Queued jobs are still run, their futures may be waited on
+    for (std::thread& thread : threads_)
+        thread.join();
+
     glslang::FinalizeProcess();
-    for (auto& modul : createdModules_)
-        vkDestroyShaderModule(device_, modul, nullptr);
+    for (auto& created : createdVkShaders_)
+        if (auto shader = created.lock())
+            shader->ReleaseModules();
 }
 
 void ShaderFactory::InitResource()
@@ -174,11 +230,15 @@ ShaderFactory::createShader(std::string_view source, EShLanguage type)
     shader->setStrings(&str, 1);
     shader->setEnvInput(glslang::EShSourceGlsl, type, glslang::EShClientVulkan,
                         100);
-    shader->setEnvClient(glslang::EShClientVulkan,
-                         glslang::EShTargetVulkan_1_0);
-    shader->setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_0);
-    shader->parse(&glslcResourceLimits_, 450, false, infoMsg);
+    shader->setEnvClient(glslang::EShClientVulkan, vulkanTarget);
+    shader->setEnvTarget(glslang::EShTargetSpv, spirvTarget);
+    const bool parsed =
+        shader->parse(&glslcResourceLimits_, glslDefaultVersion, false, infoMsg);
     perror(shader->getInfoLog());
+    //Reloaded sources may be broken, they must not reach the cache
+    if (!parsed)
+        throw std::runtime_error(std::string("failed to compile shader: ") +
+                                 shader->getInfoLog());
 
     return shader;
 }
@@ -191,7 +251,9 @@ ShaderFactory::createProgram(std::unique_ptr<glslang::TShader> shader)
     //Create glslProgramm
     program = std::make_unique<glslang::TProgram>();
     program->addShader(shader.release());
-    program->link(infoMsg);
+    if (!program->link(infoMsg))
+        throw std::runtime_error(std::string("failed to link shader: ") +
+                                 program->getInfoLog());
     program->buildReflection();
     perror(program->getInfoLog());
 
@@ -230,51 +292,159 @@ ShaderFactory::createModule(const std::vector<unsigned int>& spirv)
     return shaderModule;
 }
 
-std::shared_ptr<ShaderLayout>
-ShaderFactory::CreateShader(std::string_view vertex, std::string_view fragment,
-                            std::string_view geometry)
+ShaderCache::Entry ShaderFactory::compileStage(std::string_view source,
+                                               shader_type      type)
 {
-    std::shared_ptr<ShaderLayout> _pSh = std::make_shared<ShaderLayout>();
-    //if (Source.empty())
-    //   throw(std::string("ERROR::SHADER THERE AREN'T SHADERS\n"));
+    const auto        start = std::chrono::steady_clock::now();
+    const std::string key   = ShaderCache::MakeKey(source, type, environment_);
+    ShaderCache::Entry entry;
 
-    std::unique_ptr<glslang::TShader>  shader;
-    std::unique_ptr<glslang::TProgram> program;
-    glslang::TIntermediate*            inter;
+    const bool hit = cache_ && cache_->Load(key, source, entry);
+    if (!hit)
+        {
+            const auto lang = ShaderConverter::convert<EShLanguage>(type);
+            std::unique_ptr<glslang::TProgram> program =
+                createProgram(createShader(source, lang));
+            entry.spirv_    = getSPIRV(program->getIntermediate(lang));
+            entry.bindings_ = ShaderLayout::Reflect(*program);
+            if (cache_ && !entry.spirv_.empty())
+                cache_->Store(key, source, entry);
+        }
+
+    const double ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    if (hit)
+        ++stats_.hits_, stats_.loadMs_ += ms;
+    else
+        ++stats_.misses_, stats_.compileMs_ += ms;
+    return entry;
+}
 
-    if (!vertex.empty())
+void ShaderFactory::finishSet(PendingSet& set)
+{
+    if (set.error_)
         {
-            shader  = createShader(vertex, EShLanguage::EShLangVertex);
-            program = createProgram(std::move(shader));
-            inter   = program->getIntermediate(EShLanguage::EShLangVertex);
-            createdModules_.push_back(createModule(getSPIRV(inter)));
-            _pSh->AddShaderModule(createdModules_.back(), shader_type::vertex,
-                                  std::move(program));
+            set.promise_.set_exception(set.error_);
+            return;
         }
 
-    if (!fragment.empty())
+    try
         {
-            shader  = createShader(fragment, EShLanguage::EShLangFragment);
-            program = createProgram(std::move(shader));
-            inter   = program->getIntermediate(EShLanguage::EShLangFragment);
-            createdModules_.push_back(createModule(getSPIRV(inter)));
-            _pSh->AddShaderModule(createdModules_.back(), shader_type::fragment,
-                                  std::move(program));
+            std::shared_ptr<ShaderLayout> _pSh =
+                std::make_shared<ShaderLayout>(device_);
+            //Stages are added in pipeline order whatever finished first
+            for (int32_t t = 0; t < NSupportedShaderTypes; ++t)
+                {
+                    if (set.sources_[t].empty())
+                        continue;
+                    _pSh->AddShaderModule(createModule(set.stages_[t].spirv_),
+                                          static_cast<shader_type>(t),
+                                          set.stages_[t].bindings_);
+                }
+            {
+                std::lock_guard<std::mutex> lock(createdMutex_);
+                //Retired sets, hot reloads add one per save
+                std::erase_if(createdVkShaders_,
+                              [](const std::weak_ptr<ShaderLayout>& created)
+                              { return created.expired(); });
+                createdVkShaders_.push_back(_pSh);
+            }
+
+            const ShaderCompileStats stats = GetStats();
+            Logging::Logger& logger = Logging::LoggerFactory::GetLogger("vulkan.log");
+            LOG_INFO(logger.get(),
+                     "Shader set ready in {:.2f} ms; stages so far: {} cached in "
+                     "{:.2f} ms, {} compiled in {:.2f} ms",
+                     std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - set.start_)
+                         .count(),
+                     stats.hits_, stats.loadMs_, stats.misses_, stats.compileMs_);
+            set.promise_.set_value(std::move(_pSh));
         }
+    catch (...)
+        {
+            set.promise_.set_exception(std::current_exception());
+        }
+}
 
-    if (!geometry.empty())
+std::future<std::shared_ptr<ShaderLayout> >
+ShaderFactory::CreateShaderAsync(std::string vertex, std::string fragment,
+                                 std::string geometry)
+{
+    auto set      = std::make_shared<PendingSet>();
+    set->start_   = std::chrono::steady_clock::now();
+    set->sources_ = {std::move(vertex), std::move(fragment),
+                     std::move(geometry)};
+    auto result   = set->promise_.get_future();
+
+    std::vector<int32_t> stages;
+    for (int32_t t = 0; t < NSupportedShaderTypes; ++t)
+        if (!set->sources_[t].empty())
+            stages.push_back(t);
+    set->remaining_ = static_cast<int>(stages.size());
+    if (stages.empty())
         {
-            shader  = createShader(geometry, EShLanguage::EShLangGeometry);
-            program = createProgram(std::move(shader));
-            inter   = program->getIntermediate(EShLanguage::EShLangGeometry);
-            createdModules_.push_back(createModule(getSPIRV(inter)));
-            _pSh->AddShaderModule(createdModules_.back(), shader_type::geometry,
-                                  std::move(program));
+            finishSet(*set);
+            return result;
         }
 
-    createdVkShaders_.push_back(_pSh);
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex_);
+        for (int32_t t : stages)
+            jobs_.push_back(
+                [this, set, t]()
+                {
+                    try
+                        {
+                            set->stages_[t] = compileStage(
+                                set->sources_[t], static_cast<shader_type>(t));
+                        }
+                    catch (...)
+                        {
+                            std::lock_guard<std::mutex> lock(set->errorMutex_);
+                            if (!set->error_)
+                                set->error_ = std::current_exception();
+                        }
+                    if (--set->remaining_ == 0)
+                        finishSet(*set);
+                });
+    }
+    jobsReady_.notify_all();
+    return result;
+}
 
-    return createdVkShaders_.back();
+std::shared_ptr<ShaderLayout>
+ShaderFactory::CreateShader(std::string_view vertex, std::string_view fragment,
+                            std::string_view geometry)
+{
+    return CreateShaderAsync(std::string(vertex), std::string(fragment),
+                             std::string(geometry))
+        .get();
+}
+
+ShaderCompileStats ShaderFactory::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    return stats_;
+}
+
+void ShaderFactory::workerLoop()
+{
+    for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(jobsMutex_);
+                jobsReady_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+                if (jobs_.empty())
+                    return;
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            job();
+        }
 }
 
 } // namespace Multor::Vulkan
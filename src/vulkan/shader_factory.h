@@ -1,38 +1,108 @@
-/// \file shader_factory.h.h
+/// \file shader_factory.h
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <memory>
 #include <stdexcept>
 
 #include "shader.h"
+#include "shader_cache.h"
 
 namespace Multor::Vulkan
 {
 
+struct ShaderCompileStats
+{
+    uint64_t hits_   = 0;
+    uint64_t misses_ = 0;
+    //Spent in glslang on misses and reading the cache on hits, summed
+    //over all compile threads
+    double compileMs_ = 0.0;
+    double loadMs_    = 0.0;
+};
+
+/// \brief Compiles GLSL shader sets into ShaderLayouts.
+///
+/// Every stage is a job of a thread pool owned by the factory, so the
+/// stages of a set and different sets compile concurrently. glslang
+/// allows this once the process is initialized, every job uses its own
+/// TShader and TProgram. The last stage job of a set creates the modules
+/// and completes its future.
 class ShaderFactory
 {
 public:
-    ShaderFactory(VkDevice& device);
+    /// \param cacheFile SPIR-V cache database, no cache if empty
+    /// \param threads Compile threads, the hardware threads if 0
+    ShaderFactory(VkDevice& device,
+                  const std::filesystem::path& cacheFile = "./cache/shaders.db",
+                  uint32_t threads = 0);
+    /// \brief Compiles a set and blocks until it is done
     std::shared_ptr<ShaderLayout> CreateShader(std::string_view vertex,
                                                std::string_view fragment,
                                                std::string_view geometry = "");
+    /// \brief Queues the stages of a set for compilation, empty stages
+    /// are skipped. Errors are rethrown by the future.
+    std::future<std::shared_ptr<ShaderLayout> >
+    CreateShaderAsync(std::string vertex, std::string fragment,
+                      std::string geometry = "");
     ~ShaderFactory();
 
+    ShaderCompileStats GetStats() const;
+
 private:
+    struct PendingSet
+    {
+        std::array<std::string, NSupportedShaderTypes>        sources_;
+        std::array<ShaderCache::Entry, NSupportedShaderTypes> stages_;
+        std::atomic<int>                                      remaining_ {0};
+        std::promise<std::shared_ptr<ShaderLayout> >          promise_;
+        std::mutex                                            errorMutex_;
+        std::exception_ptr                                    error_;
+        std::chrono::steady_clock::time_point                 start_;
+    };
+
     VkDevice         device_;
     TBuiltInResource glslcResourceLimits_;
 
+    std::unique_ptr<ShaderCache> cache_;
+    //Compiler version, targets and limits, part of every cache key
+    std::string        environment_;
+    ShaderCompileStats stats_;
+    mutable std::mutex statsMutex_;
+
+    std::vector<std::thread>           threads_;
+    std::deque<std::function<void()> > jobs_;
+    std::mutex                         jobsMutex_;
+    std::condition_variable            jobsReady_;
+    bool                               stop_ = false;
+
     std::unique_ptr<glslang::TShader> createShader(std::string_view,
                                                    EShLanguage type);
     std::unique_ptr<glslang::TProgram>
                               createProgram(std::unique_ptr<glslang::TShader>);
     std::vector<unsigned int> getSPIRV(const glslang::TIntermediate* intr);
     VkShaderModule createModule(const std::vector<unsigned int>& spirv);
+    /// \brief Compiles \p source or takes it from the cache
+    ShaderCache::Entry compileStage(std::string_view source, shader_type type);
+    /// \brief Creates the modules and layout of a set whose stages are done
+    void finishSet(PendingSet& set);
+    void workerLoop();
 
-    std::vector<VkShaderModule>                 createdModules_;
-    std::vector<std::shared_ptr<ShaderLayout> > createdVkShaders_;
+    //Layouts own their modules, the ones still alive when the factory is
+    //destroyed release them before the device goes
+    std::mutex                                createdMutex_;
+    std::vector<std::weak_ptr<ShaderLayout> > createdVkShaders_;
 
     void InitResource();
 };
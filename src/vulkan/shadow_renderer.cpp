@@ -6,6 +6,8 @@
 
 #include <algorithm>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 namespace Multor::Vulkan
 {
@@ -69,11 +71,13 @@ void recordDepthLayoutTransition(VkCommandBuffer cmd, VkImage image, VkFormat fo
 
 ShadowRenderer::ShadowRenderer(VkDevice device, VkCommandPool commandPool,
                                VkQueue graphicsQueue,
-                               std::shared_ptr<CommandExecuter> executer)
+                               std::shared_ptr<CommandExecuter> executer,
+                               std::shared_ptr<PipelineCache> pipelineCache)
     : device_(device),
       commandPool_(commandPool),
       graphicsQueue_(graphicsQueue),
-      executer_(std::move(executer))
+      executer_(std::move(executer)),
+      pipelineCache_(std::move(pipelineCache))
 {
 }
 
@@ -106,6 +110,31 @@ void ShadowRenderer::RecreateDirectionalPipeline(
 
     DestroyDirectionalPipeline();
 
+    VkPushConstantRange pushConstant {};
+    pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstant.offset     = 0;
+    pushConstant.size       = sizeof(glm::mat4);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {};
+    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges    = &pushConstant;
+
+    if (vkCreatePipelineLayout(device_, &pipelineLayoutInfo, nullptr,
+                               &directionalPipelineLayout_) != VK_SUCCESS)
+        throw std::runtime_error("failed to create shadow pipeline layout");
+
+    directionalPipeline_ = BuildDirectionalPipeline(shader, renderPass);
+}
+
+VkPipeline ShadowRenderer::BuildDirectionalPipeline(
+    const std::shared_ptr<ShaderLayout>& shader, VkRenderPass renderPass) const
+{
+    if (!shader || shader->GetStages()->empty())
+        throw std::runtime_error("shadow shader is not initialized");
+    if (directionalPipelineLayout_ == VK_NULL_HANDLE)
+        throw std::runtime_error("shadow pipeline layout is not created");
+
     auto bindingDescription    = Vertex::getBindingDescription();
     auto attributeDescriptions = Vertex::getAttributeDescriptions();
 
@@ -161,20 +190,6 @@ void ShadowRenderer::RecreateDirectionalPipeline(
     dynamicState.dynamicStateCount = 2;
     dynamicState.pDynamicStates    = dynamicStates;
 
-    VkPushConstantRange pushConstant {};
-    pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    pushConstant.offset     = 0;
-    pushConstant.size       = sizeof(glm::mat4);
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo {};
-    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges    = &pushConstant;
-
-    if (vkCreatePipelineLayout(device_, &pipelineLayoutInfo, nullptr,
-                               &directionalPipelineLayout_) != VK_SUCCESS)
-        throw std::runtime_error("failed to create shadow pipeline layout");
-
     VkPipelineColorBlendStateCreateInfo colorBlending {};
     colorBlending.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
     colorBlending.logicOpEnable   = VK_FALSE;
@@ -197,9 +212,12 @@ void ShadowRenderer::RecreateDirectionalPipeline(
     pipelineInfo.renderPass          = renderPass;
     pipelineInfo.subpass             = 0;
 
-    if (vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &pipelineInfo,
-                                  nullptr, &directionalPipeline_) != VK_SUCCESS)
-        throw std::runtime_error("failed to create shadow graphics pipeline");
+    return pipelineCache_->CreateGraphicsPipeline(pipelineInfo, "shadow");
+}
+
+VkPipeline ShadowRenderer::SwapDirectionalPipeline(VkPipeline pipeline)
+{
+    return std::exchange(directionalPipeline_, pipeline);
 }
 
 VkCommandBuffer ShadowRenderer::beginOneTimeCommand() const
@@ -267,7 +285,8 @@ void ShadowRenderer::FreeCommandBuffer(VkCommandBuffer cmd) const
 VkCommandBuffer ShadowRenderer::BuildShadowCommandBufferAll(
     const std::list<std::shared_ptr<Mesh> >& meshes, const ShadowPass& shadowPass,
     ShadowMapArray& directionalShadowMaps, ShadowMapArray& pointShadowMaps,
-    const UBOs::ShadowPack& shadowPack, uint32_t frameIndex)
+    const UBOs::ShadowPack& shadowPack, uint32_t slot,
+    ParallelRecorder& recorder)
 {
     if (directionalPipeline_ == VK_NULL_HANDLE)
         return VK_NULL_HANDLE;
@@ -277,35 +296,10 @@ VkCommandBuffer ShadowRenderer::BuildShadowCommandBufferAll(
     if (!hasDirectional && !hasPoint)
         return VK_NULL_HANDLE;
 
-    VkCommandBuffer cmd = beginOneTimeCommand();
+    //Every light and cube face is a render pass instance of its own
+    std::vector<ShadowView> views;
     if (hasDirectional)
         {
-            recordDepthLayoutTransition(
-                cmd, directionalShadowMaps.image_, directionalShadowMaps.format_,
-                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-                directionalShadowMaps.layers_);
-        }
-    if (hasPoint)
-        {
-            recordDepthLayoutTransition(
-                cmd, pointShadowMaps.image_, pointShadowMaps.format_,
-                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-                pointShadowMaps.layers_);
-        }
-
-    if (hasDirectional)
-        {
-            VkViewport viewport {};
-            viewport.width    = static_cast<float>(directionalShadowMaps.width_);
-            viewport.height   = static_cast<float>(directionalShadowMaps.height_);
-            viewport.minDepth = 0.0f;
-            viewport.maxDepth = 1.0f;
-
-            VkRect2D scissor {};
-            scissor.extent = {directionalShadowMaps.width_, directionalShadowMaps.height_};
-
             const auto& framebuffers = shadowPass.GetDirectionalFramebuffers();
             for (int idx = 0; idx < shadowPack.directional_.counts_.x; ++idx)
                 {
@@ -318,61 +312,14 @@ VkCommandBuffer ShadowRenderer::BuildShadowCommandBufferAll(
                     if (shadowId >= framebuffers.size())
                         continue;
 
-                    VkClearValue clearValue {};
-                    clearValue.depthStencil = {1.0f, 0};
-
-                    VkRenderPassBeginInfo rpInfo {};
-                    rpInfo.sType      = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-                    rpInfo.renderPass = shadowPass.GetRenderPass();
-                    rpInfo.framebuffer = framebuffers[shadowId];
-                    rpInfo.renderArea.extent = {directionalShadowMaps.width_,
-                                                directionalShadowMaps.height_};
-                    rpInfo.clearValueCount = 1;
-                    rpInfo.pClearValues    = &clearValue;
-
-                    vkCmdBeginRenderPass(cmd, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
-                    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                      directionalPipeline_);
-                    vkCmdSetViewport(cmd, 0, 1, &viewport);
-                    vkCmdSetScissor(cmd, 0, 1, &scissor);
-
-                    VkDeviceSize offsets[] = {0};
-                    for (auto& mesh : meshes)
-                        {
-                            if (!mesh || !mesh->tr_ || mesh->tr_->modelCache_.empty())
-                                continue;
-
-                            const std::size_t modelIdx = std::min<std::size_t>(
-                                frameIndex, mesh->tr_->modelCache_.size() - 1);
-                            const glm::mat4 lightMvp =
-                                entry.lightSpace_ * mesh->tr_->modelCache_[modelIdx];
-
-                            vkCmdPushConstants(cmd, directionalPipelineLayout_,
-                                               VK_SHADER_STAGE_VERTEX_BIT, 0,
-                                               sizeof(glm::mat4), &lightMvp);
-                            vkCmdBindVertexBuffers(
-                                cmd, 0, 1, &mesh->vertBuffer_->pVertBuf_->buffer_,
-                                offsets);
-                            vkCmdBindIndexBuffer(cmd, mesh->indexBuffer_->buffer_, 0,
-                                                 VK_INDEX_TYPE_UINT32);
-                            vkCmdDrawIndexed(cmd, mesh->indexesSize_, 1, 0, 0, 0);
-                        }
-
-                    vkCmdEndRenderPass(cmd);
+                    views.push_back({framebuffers[shadowId],
+                                     {directionalShadowMaps.width_,
+                                      directionalShadowMaps.height_},
+                                     entry.lightSpace_});
                 }
         }
-
     if (hasPoint)
         {
-            VkViewport viewport {};
-            viewport.width    = static_cast<float>(pointShadowMaps.width_);
-            viewport.height   = static_cast<float>(pointShadowMaps.height_);
-            viewport.minDepth = 0.0f;
-            viewport.maxDepth = 1.0f;
-
-            VkRect2D scissor {};
-            scissor.extent = {pointShadowMaps.width_, pointShadowMaps.height_};
-
             const auto& framebuffers = shadowPass.GetPointFramebuffers();
             for (int idx = 0; idx < shadowPack.point_.counts_.x; ++idx)
                 {
@@ -388,59 +335,125 @@ VkCommandBuffer ShadowRenderer::BuildShadowCommandBufferAll(
                             if (layerIndex >= framebuffers.size())
                                 continue;
 
-                            VkClearValue clearValue {};
-                            clearValue.depthStencil = {1.0f, 0};
-
-                            VkRenderPassBeginInfo rpInfo {};
-                            rpInfo.sType      = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-                            rpInfo.renderPass = shadowPass.GetRenderPass();
-                            rpInfo.framebuffer = framebuffers[layerIndex];
-                            rpInfo.renderArea.extent = {pointShadowMaps.width_,
-                                                        pointShadowMaps.height_};
-                            rpInfo.clearValueCount = 1;
-                            rpInfo.pClearValues    = &clearValue;
-
-                            vkCmdBeginRenderPass(cmd, &rpInfo,
-                                                 VK_SUBPASS_CONTENTS_INLINE);
-                            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                              directionalPipeline_);
-                            vkCmdSetViewport(cmd, 0, 1, &viewport);
-                            vkCmdSetScissor(cmd, 0, 1, &scissor);
-
-                            VkDeviceSize offsets[] = {0};
-                            for (auto& mesh : meshes)
-                                {
-                                    if (!mesh || !mesh->tr_ ||
-                                        mesh->tr_->modelCache_.empty())
-                                        continue;
-
-                                    const std::size_t modelIdx = std::min<std::size_t>(
-                                        frameIndex,
-                                        mesh->tr_->modelCache_.size() - 1);
-                                    const glm::mat4 lightMvp =
-                                        entry.shadowMatrices_[face] *
-                                        mesh->tr_->modelCache_[modelIdx];
-
-                                    vkCmdPushConstants(
-                                        cmd, directionalPipelineLayout_,
-                                        VK_SHADER_STAGE_VERTEX_BIT, 0,
-                                        sizeof(glm::mat4), &lightMvp);
-                                    vkCmdBindVertexBuffers(
-                                        cmd, 0, 1,
-                                        &mesh->vertBuffer_->pVertBuf_->buffer_,
-                                        offsets);
-                                    vkCmdBindIndexBuffer(
-                                        cmd, mesh->indexBuffer_->buffer_, 0,
-                                        VK_INDEX_TYPE_UINT32);
-                                    vkCmdDrawIndexed(cmd, mesh->indexesSize_, 1, 0,
-                                                     0, 0);
-                                }
-
-                            vkCmdEndRenderPass(cmd);
+                            views.push_back({framebuffers[layerIndex],
+                                             {pointShadowMaps.width_,
+                                              pointShadowMaps.height_},
+                                             entry.shadowMatrices_[face]});
                         }
                 }
         }
 
+    std::vector<const Mesh*> drawList;
+    drawList.reserve(meshes.size());
+    for (auto& mesh : meshes)
+        if (mesh && mesh->tr_)
+            drawList.push_back(mesh.get());
+
+    //All views are split into one set of jobs so small passes share threads
+    std::vector<ParallelRecorder::Job> jobs;
+    for (std::size_t v = 0; v < views.size(); ++v)
+        {
+            VkCommandBufferInheritanceInfo inheritance {};
+            inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+            inheritance.pNext = nullptr;
+            inheritance.renderPass  = shadowPass.GetRenderPass();
+            inheritance.subpass     = 0;
+            inheritance.framebuffer = views[v].framebuffer_;
+            recorder.Split(jobs, drawList.size(), inheritance, v);
+        }
+
+    const std::vector<VkCommandBuffer> secondaries = recorder.Record(
+        slot, jobs,
+        [&](VkCommandBuffer cmd, const ParallelRecorder::Job& job)
+        {
+            const ShadowView& view = views[job.pass_];
+
+            VkViewport viewport {};
+            viewport.width    = static_cast<float>(view.extent_.width);
+            viewport.height   = static_cast<float>(view.extent_.height);
+            viewport.minDepth = 0.0f;
+            viewport.maxDepth = 1.0f;
+
+            VkRect2D scissor {};
+            scissor.extent = view.extent_;
+
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              directionalPipeline_);
+            vkCmdSetViewport(cmd, 0, 1, &viewport);
+            vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+            VkDeviceSize offsets[] = {0};
+            //Meshes of one geometry page share their buffers
+            VkBuffer bound = VK_NULL_HANDLE;
+            for (std::size_t m = job.begin_; m < job.end_; ++m)
+                {
+                    const Mesh*         mesh     = drawList[m];
+                    const MeshGeometry& geometry = *mesh->geometry_;
+                    const glm::mat4 lightMvp = view.viewProj_ * mesh->tr_->GetModel();
+
+                    vkCmdPushConstants(cmd, directionalPipelineLayout_,
+                                       VK_SHADER_STAGE_VERTEX_BIT, 0,
+                                       sizeof(glm::mat4), &lightMvp);
+                    if (geometry.vertexBuffer_ != bound)
+                        {
+                            vkCmdBindVertexBuffers(cmd, 0, 1,
+                                                   &geometry.vertexBuffer_, offsets);
+                            vkCmdBindIndexBuffer(cmd, geometry.indexBuffer_, 0,
+                                                 VK_INDEX_TYPE_UINT32);
+                            bound = geometry.vertexBuffer_;
+                        }
+                    vkCmdDrawIndexed(cmd, geometry.indexCount_, 1,
+                                     geometry.firstIndex_,
+                                     static_cast<int32_t>(geometry.baseVertex_), 0);
+                }
+        });
+
+    VkCommandBuffer cmd = beginOneTimeCommand();
+    if (hasDirectional)
+        {
+            recordDepthLayoutTransition(
+                cmd, directionalShadowMaps.image_, directionalShadowMaps.format_,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                directionalShadowMaps.layers_);
+        }
+    if (hasPoint)
+        {
+            recordDepthLayoutTransition(
+                cmd, pointShadowMaps.image_, pointShadowMaps.format_,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                pointShadowMaps.layers_);
+        }
+
+    //Jobs are in view order, each view owns a contiguous run of them
+    std::size_t first = 0;
+    for (std::size_t v = 0; v < views.size(); ++v)
+        {
+            std::size_t last = first;
+            while (last < jobs.size() && jobs[last].pass_ == v)
+                ++last;
+
+            VkClearValue clearValue {};
+            clearValue.depthStencil = {1.0f, 0};
+
+            VkRenderPassBeginInfo rpInfo {};
+            rpInfo.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            rpInfo.renderPass        = shadowPass.GetRenderPass();
+            rpInfo.framebuffer       = views[v].framebuffer_;
+            rpInfo.renderArea.extent = views[v].extent_;
+            rpInfo.clearValueCount   = 1;
+            rpInfo.pClearValues      = &clearValue;
+
+            vkCmdBeginRenderPass(cmd, &rpInfo,
+                                 VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            if (last > first)
+                vkCmdExecuteCommands(cmd, static_cast<uint32_t>(last - first),
+                                     secondaries.data() + first);
+            vkCmdEndRenderPass(cmd);
+            first = last;
+        }
+
     if (hasDirectional)
         {
             recordDepthLayoutTransition(
@@ -472,11 +485,11 @@ void ShadowRenderer::DrawAll(const std::list<std::shared_ptr<Mesh> >& meshes,
                              ShadowMapArray& directionalShadowMaps,
                              ShadowMapArray& pointShadowMaps,
                              const UBOs::ShadowPack& shadowPack,
-                             uint32_t frameIndex)
+                             uint32_t slot, ParallelRecorder& recorder)
 {
     VkCommandBuffer cmd = BuildShadowCommandBufferAll(
         meshes, shadowPass, directionalShadowMaps, pointShadowMaps, shadowPack,
-        frameIndex);
+        slot, recorder);
     if (cmd == VK_NULL_HANDLE)
         return;
     endOneTimeCommand(cmd);
@@ -540,22 +553,23 @@ void ShadowRenderer::DrawDirectional(const std::list<std::shared_ptr<Mesh> >& me
             VkDeviceSize offsets[] = {0};
             for (auto& mesh : meshes)
                 {
-                    if (!mesh || !mesh->tr_ || mesh->tr_->modelCache_.empty())
+                    if (!mesh || !mesh->tr_)
                         continue;
 
-                    const std::size_t modelIdx = std::min<std::size_t>(
-                        frameIndex, mesh->tr_->modelCache_.size() - 1);
                     const glm::mat4 lightMvp =
-                        entry.lightSpace_ * mesh->tr_->modelCache_[modelIdx];
+                        entry.lightSpace_ * mesh->tr_->GetModel();
 
                     vkCmdPushConstants(cmd, directionalPipelineLayout_,
                                        VK_SHADER_STAGE_VERTEX_BIT, 0,
                                        sizeof(glm::mat4), &lightMvp);
                     vkCmdBindVertexBuffers(cmd, 0, 1,
-                                           &mesh->vertBuffer_->pVertBuf_->buffer_, offsets);
-                    vkCmdBindIndexBuffer(cmd, mesh->indexBuffer_->buffer_, 0,
+                                           &mesh->geometry_->vertexBuffer_, offsets);
+                    vkCmdBindIndexBuffer(cmd, mesh->geometry_->indexBuffer_, 0,
                                          VK_INDEX_TYPE_UINT32);
-                    vkCmdDrawIndexed(cmd, mesh->indexesSize_, 1, 0, 0, 0);
+                    vkCmdDrawIndexed(cmd, mesh->geometry_->indexCount_, 1,
+                                     mesh->geometry_->firstIndex_,
+                                     static_cast<int32_t>(mesh->geometry_->baseVertex_),
+                                     0);
                 }
 
             vkCmdEndRenderPass(cmd);
@@ -627,23 +641,24 @@ void ShadowRenderer::DrawPoint(const std::list<std::shared_ptr<Mesh> >& meshes,
                     VkDeviceSize offsets[] = {0};
                     for (auto& mesh : meshes)
                         {
-                            if (!mesh || !mesh->tr_ || mesh->tr_->modelCache_.empty())
+                            if (!mesh || !mesh->tr_)
                                 continue;
 
-                            const std::size_t modelIdx = std::min<std::size_t>(
-                                frameIndex, mesh->tr_->modelCache_.size() - 1);
                             const glm::mat4 lightMvp =
                                 entry.shadowMatrices_[face] *
-                                mesh->tr_->modelCache_[modelIdx];
+                                mesh->tr_->GetModel();
 
                             vkCmdPushConstants(cmd, directionalPipelineLayout_,
                                                VK_SHADER_STAGE_VERTEX_BIT, 0,
                                                sizeof(glm::mat4), &lightMvp);
                             vkCmdBindVertexBuffers(cmd, 0, 1,
-                                                   &mesh->vertBuffer_->pVertBuf_->buffer_, offsets);
-                            vkCmdBindIndexBuffer(cmd, mesh->indexBuffer_->buffer_, 0,
+                                                   &mesh->geometry_->vertexBuffer_, offsets);
+                            vkCmdBindIndexBuffer(cmd, mesh->geometry_->indexBuffer_, 0,
                                                  VK_INDEX_TYPE_UINT32);
-                            vkCmdDrawIndexed(cmd, mesh->indexesSize_, 1, 0, 0, 0);
+                            vkCmdDrawIndexed(cmd, mesh->geometry_->indexCount_, 1,
+                                             mesh->geometry_->firstIndex_,
+                                             static_cast<int32_t>(mesh->geometry_->baseVertex_),
+                                             0);
                         }
 
                     vkCmdEndRenderPass(cmd);
@@ -5,12 +5,15 @@
 #include "command_executer.h"
 #include "mesh.h"
 #include "shadow_pass.h"
+#include "parallel_recorder.h"
+#include "pipeline_cache.h"
 #include "shadow_resources.h"
 #include "shader.h"
 #include "structures/shadow_ubo.h"
 
 #include <list>
 #include <memory>
+#include <vector>
 
 #include <vulkan/vulkan.h>
 
@@ -21,7 +24,8 @@ class ShadowRenderer
 {
 public:
     ShadowRenderer(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue,
-                   std::shared_ptr<CommandExecuter> executer);
+                   std::shared_ptr<CommandExecuter> executer,
+                   std::shared_ptr<PipelineCache> pipelineCache);
     ~ShadowRenderer();
 
     ShadowRenderer(const ShadowRenderer&) = delete;
@@ -30,6 +34,13 @@ public:
     void RecreateDirectionalPipeline(const std::shared_ptr<ShaderLayout>& shader,
                                      VkRenderPass renderPass);
     void DestroyDirectionalPipeline();
+    /// \brief Creates a pipeline of \p shader in the current pipeline
+    /// layout without touching the one in use, thread safe
+    VkPipeline BuildDirectionalPipeline(const std::shared_ptr<ShaderLayout>& shader,
+                                        VkRenderPass renderPass) const;
+    /// \brief Draws with \p pipeline from now on and returns the previous
+    /// one, which the caller destroys once no frame uses it
+    VkPipeline SwapDirectionalPipeline(VkPipeline pipeline);
 
     void DrawDirectional(const std::list<std::shared_ptr<Mesh> >& meshes,
                          const ShadowPass& shadowPass,
@@ -45,16 +56,26 @@ public:
                  const ShadowPass& shadowPass,
                  ShadowMapArray& directionalShadowMaps,
                  ShadowMapArray& pointShadowMaps,
-                 const UBOs::ShadowPack& shadowPack, uint32_t frameIndex);
+                 const UBOs::ShadowPack& shadowPack, uint32_t slot,
+                 ParallelRecorder& recorder);
 
+    /// \brief Records all shadow passes, the meshes of each light and cube
+    /// face are drawn by secondary buffers of \p recorder slot \p slot
     VkCommandBuffer BuildShadowCommandBufferAll(
         const std::list<std::shared_ptr<Mesh> >& meshes,
         const ShadowPass& shadowPass, ShadowMapArray& directionalShadowMaps,
         ShadowMapArray& pointShadowMaps, const UBOs::ShadowPack& shadowPack,
-        uint32_t frameIndex);
+        uint32_t slot, ParallelRecorder& recorder);
     void FreeCommandBuffer(VkCommandBuffer cmd) const;
 
 private:
+    struct ShadowView
+    {
+        VkFramebuffer framebuffer_;
+        VkExtent2D    extent_;
+        glm::mat4     viewProj_;
+    };
+
     VkCommandBuffer beginOneTimeCommand() const;
     void endOneTimeCommand(VkCommandBuffer cmd) const;
 
@@ -63,6 +84,7 @@ private:
     VkCommandPool commandPool_ = VK_NULL_HANDLE;
     VkQueue graphicsQueue_ = VK_NULL_HANDLE;
     std::shared_ptr<CommandExecuter> executer_;
+    std::shared_ptr<PipelineCache> pipelineCache_;
 
     VkPipelineLayout directionalPipelineLayout_ = VK_NULL_HANDLE;
     VkPipeline directionalPipeline_ = VK_NULL_HANDLE;
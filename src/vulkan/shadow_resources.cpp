@@ -14,8 +14,6 @@ ShadowMapArray::~ShadowMapArray()
     if (device_ == VK_NULL_HANDLE)
         return;
 
-    if (sampler_ != VK_NULL_HANDLE)
-        vkDestroySampler(device_, sampler_, nullptr);
     if (view_ != VK_NULL_HANDLE)
         vkDestroyImageView(device_, view_, nullptr);
     if (image_ != VK_NULL_HANDLE)
@@ -42,8 +40,6 @@ ShadowMapArray& ShadowMapArray::operator=(ShadowMapArray&& other) noexcept
 
     if (device_ != VK_NULL_HANDLE)
         {
-            if (sampler_ != VK_NULL_HANDLE)
-                vkDestroySampler(device_, sampler_, nullptr);
             if (view_ != VK_NULL_HANDLE)
                 vkDestroyImageView(device_, view_, nullptr);
             if (image_ != VK_NULL_HANDLE)
@@ -77,8 +73,10 @@ ShadowMapArray& ShadowMapArray::operator=(ShadowMapArray&& other) noexcept
     return *this;
 }
 
-ShadowResources::ShadowResources(VkDevice device, VkPhysicalDevice physicalDevice)
-    : device_(device), physicalDevice_(physicalDevice)
+ShadowResources::ShadowResources(VkDevice device, VkPhysicalDevice physicalDevice,
+                                 std::shared_ptr<SamplerCache> samplers)
+    : device_(device), physicalDevice_(physicalDevice),
+      samplers_(std::move(samplers))
 {
 }
 
@@ -266,8 +264,6 @@ ShadowMapArray ShadowResources::createDepthArray(uint32_t width, uint32_t height
 
 VkSampler ShadowResources::createShadowSampler() const
 {
-    VkSampler sampler = VK_NULL_HANDLE;
-
     VkSamplerCreateInfo samplerInfo {};
     samplerInfo.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     samplerInfo.pNext        = nullptr;
@@ -287,10 +283,7 @@ VkSampler ShadowResources::createShadowSampler() const
     samplerInfo.borderColor      = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
     samplerInfo.unnormalizedCoordinates = VK_FALSE;
 
-    if (vkCreateSampler(device_, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
-        throw std::runtime_error("failed to create shadow sampler");
-
-    return sampler;
+    return samplers_->Get(samplerInfo);
 }
 
 } // namespace Multor::Vulkan
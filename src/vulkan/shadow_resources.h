@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include "sampler_cache.h"
+
 #include <cstdint>
 #include <memory>
 
@@ -16,6 +18,7 @@ struct ShadowMapArray
     VkImage        image_      = VK_NULL_HANDLE;
     VkDeviceMemory memory_     = VK_NULL_HANDLE;
     VkImageView    view_       = VK_NULL_HANDLE;
+    //Owned by the SamplerCache of ShadowResources
     VkSampler      sampler_    = VK_NULL_HANDLE;
     VkFormat       format_     = VK_FORMAT_UNDEFINED;
     uint32_t       width_      = 0;
@@ -35,7 +38,8 @@ struct ShadowMapArray
 class ShadowResources
 {
 public:
-    ShadowResources(VkDevice device, VkPhysicalDevice physicalDevice);
+    ShadowResources(VkDevice device, VkPhysicalDevice physicalDevice,
+                    std::shared_ptr<SamplerCache> samplers);
 
     ShadowMapArray CreateDirectionalShadowArray(uint32_t mapSize = 1024,
                                                 uint32_t layers  = 10) const;
@@ -62,8 +66,9 @@ private:
     VkSampler createShadowSampler() const;
 
 private:
-    VkDevice         device_;
-    VkPhysicalDevice physicalDevice_;
+    VkDevice                      device_;
+    VkPhysicalDevice              physicalDevice_;
+    std::shared_ptr<SamplerCache> samplers_;
 };
 
 } // namespace Multor::Vulkan
@@ -0,0 +1,22 @@
+/// \file frame_ubo.h
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace Multor::Vulkan::UBOs
+{
+
+/// \brief Camera and scene data shared by every draw of a frame
+struct Frame
+{
+    alignas(16) glm::mat4 view_ {};
+    alignas(16) glm::mat4 projection_ {};
+    alignas(16) glm::mat4 PV_ {};
+    // xyz = camera position, w = 1
+    alignas(16) glm::vec4 viewPos_ {};
+    // x = seconds since start, y = frame delta, z/w = reserved
+    alignas(16) glm::vec4 time_ {};
+};
+
+} // namespace Multor::Vulkan::UBOs
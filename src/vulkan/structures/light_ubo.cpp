@@ -109,15 +109,23 @@ UBOs::Lights PackLights(const std::vector<const Multor::BLight*>& lights)
     return out;
 }
 
+LightsUBO::LightsUBO(UniformRing& ring)
+    : buffers_(ring.Allocate(LightsBufObj)), ring_(ring)
+{
+}
+
+LightsUBO::~LightsUBO()
+{
+    ring_.Free(buffers_);
+}
+
 void LightsUBO::update(std::size_t frame, const UBOs::Lights& lights)
 {
-    if (frame >= buffers_.size() || !buffers_[frame])
+    if (frame >= ring_.GetSegmentCount())
         throw std::out_of_range("LightsUBO::update frame buffer is missing");
 
-    void* data = nullptr;
-    vkMapMemory(dev_, buffers_[frame]->bufferMemory_, 0, LightsBufObj, 0, &data);
-    std::memcpy(data, &lights, sizeof(UBOs::Lights));
-    vkUnmapMemory(dev_, buffers_[frame]->bufferMemory_);
+    ring_.Write(static_cast<uint32_t>(frame), buffers_, &lights,
+                sizeof(UBOs::Lights));
 }
 
 } // namespace Multor::Vulkan
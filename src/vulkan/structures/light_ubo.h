@@ -2,7 +2,7 @@
 
 #pragma once
 
-#include "../objects/buffer.h"
+#include "../uniform_ring.h"
 #include "../../scene_objects/light.h"
 
 #include <array>
@@ -54,18 +54,20 @@ UBOs::Lights PackLights(const std::vector<const Multor::BLight*>& lights);
 
 struct LightsUBO
 {
-    explicit LightsUBO(VkDevice dev) : dev_(dev)
-    {
-    }
+    explicit LightsUBO(UniformRing& ring);
+    ~LightsUBO();
+
+    LightsUBO(const LightsUBO&)            = delete;
+    LightsUBO& operator=(const LightsUBO&) = delete;
 
     void update(std::size_t frame, const UBOs::Lights& lights);
 
-    std::vector<std::unique_ptr<Buffer> > buffers_;
+    UniformRange buffers_;
 
     static const VkDeviceSize LightsBufObj;
 
 private:
-    VkDevice dev_;
+    UniformRing& ring_;
 };
 
 } // namespace Multor::Vulkan
@@ -5,47 +5,47 @@
 namespace Multor::Vulkan
 {
 
-void TransformUBO::updateModel(std::size_t      frame,
-                               const glm::mat4& newTransformMatrix)
-{
-    if (modelCache_.size() <= frame)
-        modelCache_.resize(frame + 1, glm::mat4(1.0f));
-    modelCache_[frame] = newTransformMatrix;
-
-    void* data;
-    vkMapMemory(dev_, matrixes_[frame]->bufferMemory_, 0, TransBufObj, 0,
-                &data);
-    memcpy(static_cast<char*>(data) + offsetof(UBOs::Transform, model_),
-           &newTransformMatrix, sizeof(glm::mat4));
-    const glm::mat4 normalMatrix =
-        glm::transpose(glm::inverse(newTransformMatrix));
-    memcpy(static_cast<char*>(data) + offsetof(UBOs::Transform, normalMatrix_),
-           &normalMatrix, sizeof(glm::mat4));
-    vkUnmapMemory(dev_, matrixes_[frame]->bufferMemory_);
+TransformUBO::TransformUBO(ObjectTable& objects)
+    : objects_(&objects), slot_(objects.Allocate())
+{
+}
+
+TransformUBO::~TransformUBO()
+{
+    Release();
+}
+
+void TransformUBO::Release()
+{
+    if (!objects_)
+        return;
+    released_ = objects_->GetModel(slot_);
+    objects_->Free(slot_);
+    objects_ = nullptr;
+}
+
+void TransformUBO::updateModel(const glm::mat4& newTransformMatrix)
+{
+    if (!objects_)
+        {
+            released_ = newTransformMatrix;
+            return;
+        }
+    objects_->Update(slot_, newTransformMatrix);
 
     if (onModelChanged_)
         onModelChanged_();
 }
 
-void TransformUBO::updateView(std::size_t frame, const glm::vec3& newPos)
+void TransformUBO::SetTexture(uint32_t texture)
 {
-    void* data;
-    vkMapMemory(dev_, viewPosUBO_[frame]->bufferMemory_, 0, ViewBufObj, 0,
-                &data);
-    const UBOs::ViewPosition viewPos {.viewPos_ = glm::vec4(newPos, 1.0f)};
-    std::memcpy(data, &viewPos, sizeof(viewPos));
-    vkUnmapMemory(dev_, viewPosUBO_[frame]->bufferMemory_);
+    if (objects_)
+        objects_->SetTexture(slot_, texture);
 }
 
-void TransformUBO::updatePV(std::size_t      frame,
-                            const glm::mat4& newProjectViewMatrix)
+const glm::mat4& TransformUBO::GetModel() const
 {
-    void* data;
-    vkMapMemory(dev_, matrixes_[frame]->bufferMemory_, 0, TransBufObj, 0,
-                &data);
-    memcpy(static_cast<char*>(data) + offsetof(UBOs::Transform, PV_),
-           &newProjectViewMatrix, sizeof(glm::mat4));
-    vkUnmapMemory(dev_, matrixes_[frame]->bufferMemory_);
+    return objects_ ? objects_->GetModel(slot_) : released_;
 }
 
 void TransformUBO::SetModelChangedCallback(std::function<void()> callback)
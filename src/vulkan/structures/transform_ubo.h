@@ -2,7 +2,7 @@
 
 #pragma once
 
-#include "../objects/buffer.h"
+#include "../object_table.h"
 #include "../../scene_objects/material.h"
 
 #include <vector>
@@ -15,43 +15,34 @@
 namespace Multor::Vulkan
 {
 
-namespace UBOs
-{
-struct Transform
-{
-    alignas(16) glm::mat4 model_ {};
-    alignas(16) glm::mat4 PV_ {};
-    alignas(16) glm::mat4 normalMatrix_ {};
-};
-
-struct ViewPosition
-{
-    alignas(16) glm::vec4 viewPos_ {};
-};
-}
-
+/// \brief Per mesh slot in the ObjectTable holding its model and normal
+/// matrices
 struct TransformUBO
 {
-    TransformUBO(VkDevice dev) : dev_(dev)
-    {
-    }
-
-    void updateModel(std::size_t frame, const glm::mat4& newTransformMatrix);
-    void updateView(std::size_t frame, const glm::vec3& newPosition);
-    void updatePV(std::size_t frame, const glm::mat4& newProjectViewMatrix);
+    explicit TransformUBO(ObjectTable& objects);
+    ~TransformUBO();
+
+    TransformUBO(const TransformUBO&)            = delete;
+    TransformUBO& operator=(const TransformUBO&) = delete;
+
+    /// \brief Takes effect from the next recorded frame on
+    void updateModel(const glm::mat4& newTransformMatrix);
+    const glm::mat4& GetModel() const;
+    /// \brief Selects the diffuse texture by its TextureTable slot
+    void SetTexture(uint32_t texture);
+    uint32_t GetSlot() const { return slot_; }
+    /// \brief Gives the slot back once the mesh is removed. The model is
+    /// kept and still updated afterwards, it just is no longer drawn.
+    void Release();
     void SetModelChangedCallback(std::function<void()> callback);
 
-    std::vector<std::unique_ptr<Buffer> > matrixes_;
-    std::vector<std::unique_ptr<Buffer> > viewPosUBO_;
-    std::vector<std::unique_ptr<Buffer> > materialUBO_;
-    std::vector<glm::mat4>                modelCache_;
-
-    static const VkDeviceSize MatBufObj   = sizeof(Material);
-    static const VkDeviceSize TransBufObj = sizeof(UBOs::Transform);
-    static const VkDeviceSize ViewBufObj  = sizeof(UBOs::ViewPosition);
+    static const VkDeviceSize MatBufObj = sizeof(Material);
 
 private:
-    VkDevice dev_;
+    //Null once released
+    ObjectTable*          objects_;
+    uint32_t              slot_;
+    glm::mat4             released_ {1.0f};
     std::function<void()> onModelChanged_;
 };
 
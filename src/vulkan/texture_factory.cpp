@@ -2,12 +2,83 @@
 
 #include "texture_factory.h"
 #include "objects/buffer.h"
+#include "../utils/mip_chain.h"
+#include "../utils/pixel_format.h"
+
+#include <algorithm>
+#include <cstring>
 
 namespace Multor::Vulkan
 {
 
+namespace
+{
+
+//Color is sRGB encoded, data maps are linear
+bool isColorTexture(Texture_Types type)
+{
+    return type == Texture_Types::Diffuse || type == Texture_Types::Emissive ||
+           type == Texture_Types::Skybox;
+}
+
+bool isOpaque(const Image& img)
+{
+    const std::size_t texels = std::size_t(img.w_) * img.h_;
+    for (std::size_t i = 0; i < texels; ++i)
+        if (img.mdata_[i * 4 + 3] != 255)
+            return false;
+    return true;
+}
+
+VkFormat toVkFormat(PixelFormat format, bool srgb)
+{
+    switch (format)
+        {
+        case PixelFormat::RGBA8:
+            return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+        case PixelFormat::RG8:
+            return VK_FORMAT_R8G8_UNORM;
+        case PixelFormat::R8:
+            return VK_FORMAT_R8_UNORM;
+        case PixelFormat::BC1:
+            return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+                        : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        case PixelFormat::BC3:
+            return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+        case PixelFormat::BC4:
+            return VK_FORMAT_BC4_UNORM_BLOCK;
+        case PixelFormat::BC5:
+            return VK_FORMAT_BC5_UNORM_BLOCK;
+        case PixelFormat::BC7:
+            return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+        }
+    throw std::invalid_argument("unknown pixel format!");
+}
+
+//Leaves out the first \p count levels, keeping at least one, and moves
+//the rest to the start of chain_. \p end is the end of the last level.
+void dropLevels(PreparedTexture& out, uint32_t count, std::size_t end)
+{
+    count = std::min(count, static_cast<uint32_t>(out.levels_.size() - 1));
+    if (count == 0)
+        return;
+
+    const std::size_t    base = out.levels_[count].offset_;
+    const unsigned char* data = out.Data();
+    std::vector<unsigned char> chain(data + base, data + end);
+    out.levels_.erase(out.levels_.begin(), out.levels_.begin() + count);
+    for (MipLevel& level : out.levels_)
+        level.offset_ -= base;
+    out.chain_         = std::move(chain);
+    out.mipLevels_     = static_cast<uint32_t>(out.levels_.size());
+    out.skippedLevels_ = count;
+}
+
+} // namespace
+
 VkImageView TextureFactory::CreateImageView(VkImage image, VkFormat format,
-                                              VkImageAspectFlags aspectFlags)
+                                              VkImageAspectFlags aspectFlags,
+                                              uint32_t           mipLevels)
 {
     VkImageViewCreateInfo viewInfo {};
     viewInfo.sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -17,7 +88,7 @@ VkImageView TextureFactory::CreateImageView(VkImage image, VkFormat format,
     viewInfo.format   = format;
     viewInfo.subresourceRange.aspectMask     = aspectFlags;
     viewInfo.subresourceRange.baseMipLevel   = 0;
-    viewInfo.subresourceRange.levelCount     = 1;
+    viewInfo.subresourceRange.levelCount     = mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount     = 1;
 
@@ -30,8 +101,6 @@ VkImageView TextureFactory::CreateImageView(VkImage image, VkFormat format,
 
 VkSampler TextureFactory::CreateTextureSampler()
 {
-    VkSampler textureSampler;
-
     VkSamplerCreateInfo samplerInfo {};
     samplerInfo.sType            = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     samplerInfo.magFilter        = VK_FILTER_LINEAR;
@@ -50,58 +119,196 @@ VkSampler TextureFactory::CreateTextureSampler()
     samplerInfo.mipmapMode              = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     samplerInfo.mipLodBias              = 0.0f;
     samplerInfo.minLod                  = 0.0f;
-    samplerInfo.maxLod                  = 0.0f;
+    samplerInfo.maxLod                  = VK_LOD_CLAMP_NONE;
     samplerInfo.anisotropyEnable        = VK_FALSE;
     samplerInfo.maxAnisotropy           = 1.0f;
 
-    if (vkCreateSampler(dev_, &samplerInfo, nullptr, &textureSampler) !=
-        VK_SUCCESS)
-        throw std::runtime_error("failed to create texture sampler!");
-    return textureSampler;
+    return samplers_->Get(samplerInfo);
 }
 
-Texture* TextureFactory::CreateTexture(Image* img)
+PreparedTexture TextureFactory::PrepareTexture(
+    const std::vector<std::shared_ptr<Image> >& images, Texture_Types type,
+    uint32_t skipLevels) const
 {
     //std::shared_ptr<Image> img = ImageLoader::LoadTexture("A:/VulkanEngine/build/matrix.jpg");
 
-    if (img->empty())
+    std::shared_ptr<Image> img = images.empty() ? nullptr : images[0];
+    if (!img || img->empty())
         throw std::runtime_error("failed to image load!");
 
-    VkDeviceSize imageSize = img->w_ * img->h_ * 4;
-
-    std::unique_ptr<Buffer> stBuf =
-        CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    void* data;
-    vkMapMemory(dev_, stBuf->bufferMemory_, 0, imageSize, 0, &data);
-    std::memcpy(data, img->mdata_, static_cast<size_t>(imageSize));
-    vkUnmapMemory(dev_, stBuf->bufferMemory_);
-
-    std::pair<VkImage, VkDeviceMemory> texture = CreateImage(
-        img->w_, img->h_, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    executer_->TransitionImageLayout(texture.first, VK_FORMAT_R8G8B8A8_SRGB,
-                                     VK_IMAGE_LAYOUT_UNDEFINED,
-                                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    executer_->CopyBufferToImage(stBuf->buffer_, texture.first,
-                                 static_cast<uint32_t>(img->w_),
-                                 static_cast<uint32_t>(img->h_));
-    executer_->TransitionImageLayout(texture.first, VK_FORMAT_R8G8B8A8_SRGB,
-                                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    PreparedTexture out;
+    out.image_  = img;
+    out.srgb_   = isColorTexture(type);
+    out.format_ = img->format_;
+    out.levels_ = {{static_cast<uint32_t>(img->w_),
+                    static_cast<uint32_t>(img->h_), 0}};
+    const uint32_t width  = out.levels_[0].width_;
+    const uint32_t height = out.levels_[0].height_;
+
+    if (img->format_ != PixelFormat::RGBA8 || !img->levels_.empty())
+        {
+            //Containers are uploaded as stored, with their own levels
+            if (!img->levels_.empty())
+                out.levels_ = img->levels_;
+            //The blocking path fills a single level
+            if (!uploads_)
+                out.levels_.resize(1);
+            out.mipLevels_ = static_cast<uint32_t>(out.levels_.size());
+            dropLevels(out, skipLevels, out.Size());
+        }
+    else
+        {
+            std::vector<MipLevel>& levels = out.levels_;
+            out.format_    = chooseFormat(type, *img);
+            out.mipLevels_ = uploads_ ? MipLevelCount(width, height) : 1;
+
+            for (std::size_t i = 1;
+                 i < images.size() && levels.size() < out.mipLevels_; ++i)
+                {
+                    const MipLevel& prev = levels.back();
+                    const MipLevel  next {std::max(prev.width_ / 2, 1u),
+                                         std::max(prev.height_ / 2, 1u),
+                                         prev.offset_ + std::size_t(prev.width_) *
+                                                            prev.height_ * 4};
+                    if (!images[i] || images[i]->w_ != int(next.width_) ||
+                        images[i]->h_ != int(next.height_))
+                        break;
+                    levels.push_back(next);
+                }
+
+            const bool generate = levels.size() < out.mipLevels_;
+            //Compressed levels can not be blitted, they are built before
+            //encoding
+            //Skipped levels have to exist on the CPU to be left out
+            out.blit_ = generate && skipLevels == 0 &&
+                        out.format_ == PixelFormat::RGBA8 &&
+                        uploads_->CanBlit() &&
+                        canBlit(toVkFormat(out.format_, out.srgb_));
+
+            if (generate && !out.blit_)
+                out.chain_ =
+                    BuildMipChain(img->mdata_, width, height, out.srgb_, levels);
+            else if (levels.size() > 1)
+                {
+                    //Baked levels are packed behind the first one
+                    out.chain_.resize(levels.back().offset_ +
+                                      std::size_t(levels.back().width_) *
+                                          levels.back().height_ * 4);
+                    for (std::size_t i = 0; i < levels.size(); ++i)
+                        std::memcpy(out.chain_.data() + levels[i].offset_,
+                                    images[i]->mdata_,
+                                    std::size_t(levels[i].width_) *
+                                        levels[i].height_ * 4);
+                }
+            //Before encoding, so skipped levels are not encoded for nothing
+            dropLevels(out, skipLevels,
+                       levels.back().offset_ + std::size_t(levels.back().width_) *
+                                                   levels.back().height_ * 4);
+
+            if (out.format_ != PixelFormat::RGBA8)
+                {
+                    //Levels start at 16 byte offsets like in containers
+                    std::vector<MipLevel> encodedLevels = levels;
+                    std::size_t           total         = 0;
+                    for (MipLevel& level : encodedLevels)
+                        {
+                            level.offset_ = total;
+                            total += (LevelSize(out.format_, level.width_,
+                                                level.height_) +
+                                      15) &
+                                     ~std::size_t(15);
+                        }
+                    std::vector<unsigned char> encoded(total);
+                    for (std::size_t i = 0; i < levels.size(); ++i)
+                        EncodeLevel(out.format_, out.Data() + levels[i].offset_,
+                                    levels[i].width_, levels[i].height_,
+                                    encoded.data() + encodedLevels[i].offset_);
+                    out.chain_ = std::move(encoded);
+                    levels     = std::move(encodedLevels);
+                }
+        }
+
+    //Raw data is no longer needed once it is filtered or encoded
+    if (!out.chain_.empty())
+        out.image_.reset();
+    return out;
+}
+
+Texture* TextureFactory::CreateTexture(
+    const std::vector<std::shared_ptr<Image> >& images, Texture_Types type)
+{
+    return CreateTexture(PrepareTexture(images, type));
+}
+
+Texture* TextureFactory::CreateTexture(const PreparedTexture& prepared)
+{
+    if (IsBlockCompressed(prepared.format_) && !supportsBlockCompression())
+        throw std::runtime_error(
+            "failed to create texture, BC formats are not supported!");
+
+    const std::vector<MipLevel>& levels    = prepared.levels_;
+    const uint32_t               mipLevels = prepared.mipLevels_;
+    const uint32_t               width     = levels[0].width_;
+    const uint32_t               height    = levels[0].height_;
+    const VkFormat     format    = toVkFormat(prepared.format_, prepared.srgb_);
+    const VkDeviceSize imageSize = prepared.Size();
+    //Blitted levels are not staged but take memory all the same
+    VkDeviceSize bytes = 0;
+    for (uint32_t i = 0; i < mipLevels; ++i)
+        bytes += LevelSize(prepared.format_, std::max(width >> i, 1u),
+                           std::max(height >> i, 1u));
+
+    VkImageUsageFlags usage =
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (prepared.blit_)
+        usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    std::pair<VkImage, MemoryAllocation> texture =
+        CreateImage(width, height, format, VK_IMAGE_TILING_OPTIMAL, usage,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mipLevels);
+
+    if (uploads_)
+        lastUpload_ = uploads_->UploadImage(texture.first, levels, mipLevels,
+                                            prepared.Data(), imageSize);
+    else
+        {
+            std::unique_ptr<Buffer> stBuf =
+                CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            std::memcpy(stBuf->allocation_.mapped_, prepared.Data(),
+                        static_cast<size_t>(imageSize));
+
+            executer_->TransitionImageLayout(
+                texture.first, format, VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            executer_->CopyBufferToImage(stBuf->buffer_, texture.first, width,
+                                         height);
+            executer_->TransitionImageLayout(
+                texture.first, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        }
+
     Texture* val = new Texture;
-    val->dev_      = dev_;
-    val->img_      = texture.first;
-    val->view_     = CreateTextureImageView(texture.first);
-    val->sampler_  = CreateTextureSampler();
-    val->devMem_   = texture.second;
+    val->dev_        = dev_;
+    val->img_        = texture.first;
+    val->view_       = CreateTextureImageView(texture.first, format, mipLevels);
+    val->format_     = format;
+    val->mipLevels_  = mipLevels;
+    val->bytes_      = bytes;
+    val->skippedLevels_ = prepared.skippedLevels_;
+    val->sampler_    = CreateTextureSampler();
+    val->samplers_   = samplers_;
+    val->allocation_ = texture.second;
+    val->allocator_  = allocator_;
     return val;
 }
 
+bool TextureFactory::SetCompression(bool enabled)
+{
+    compress_ = enabled && supportsBlockCompression();
+    return compress_ == enabled;
+}
+
 std::unique_ptr<Texture>
 TextureFactory::CreateDepthTexture(std::uint32_t width, std::uint32_t height)
 {
@@ -122,8 +329,9 @@ TextureFactory::CreateDepthTexture(std::uint32_t width, std::uint32_t height)
     depthTex->view_ =
         CreateImageView(depth, depthFormat, depthAspect);
 
-    depthTex->img_    = depth;
-    depthTex->devMem_ = depthMemory;
+    depthTex->img_        = depth;
+    depthTex->allocation_ = depthMemory;
+    depthTex->allocator_  = allocator_;
 
     executer_->TransitionImageLayout(
         depthTex->img_, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED,
@@ -132,12 +340,13 @@ TextureFactory::CreateDepthTexture(std::uint32_t width, std::uint32_t height)
     return depthTex;
 }
 
-std::pair<VkImage, VkDeviceMemory>
+std::pair<VkImage, MemoryAllocation>
 TextureFactory::CreateImage(uint32_t width, uint32_t height, VkFormat format,
                               VkImageTiling tiling, VkImageUsageFlags usage,
-                              VkMemoryPropertyFlags properties)
+                              VkMemoryPropertyFlags properties,
+                              uint32_t              mipLevels)
 {
-    std::pair<VkImage, VkDeviceMemory> image;
+    std::pair<VkImage, MemoryAllocation> image;
 
     VkImageCreateInfo imageInfo {};
     imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -145,7 +354,7 @@ TextureFactory::CreateImage(uint32_t width, uint32_t height, VkFormat format,
     imageInfo.extent.width  = width;
     imageInfo.extent.height = height;
     imageInfo.extent.depth  = 1;
-    imageInfo.mipLevels     = 1;
+    imageInfo.mipLevels     = mipLevels;
     imageInfo.arrayLayers   = 1;
     imageInfo.format        = format;
     imageInfo.tiling        = tiling;
@@ -153,31 +362,65 @@ TextureFactory::CreateImage(uint32_t width, uint32_t height, VkFormat format,
     imageInfo.usage         = usage;
     imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
     imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+    if ((usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) && !sharedFamilies_.empty())
+        {
+            imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            imageInfo.queueFamilyIndexCount =
+                static_cast<uint32_t>(sharedFamilies_.size());
+            imageInfo.pQueueFamilyIndices = sharedFamilies_.data();
+        }
 
     if (vkCreateImage(dev_, &imageInfo, nullptr, &image.first) != VK_SUCCESS)
         throw std::runtime_error("failed to create image!");
 
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(dev_, image.first, &memRequirements);
+    image.second = allocator_->AllocateImage(image.first, properties);
+    return image;
+}
 
-    VkMemoryAllocateInfo allocInfo {};
-    allocInfo.sType          = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex =
-        findMemoryType(memRequirements.memoryTypeBits, properties);
+VkImageView TextureFactory::CreateTextureImageView(VkImage img,
+                                                  VkFormat format,
+                                                  uint32_t mipLevels)
+{
+    return CreateImageView(img, format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+}
 
-    if (vkAllocateMemory(dev_, &allocInfo, nullptr, &image.second) !=
-        VK_SUCCESS)
-        throw std::runtime_error("failed to allocate image memory!");
+PixelFormat TextureFactory::chooseFormat(Texture_Types type,
+                                         const Image& img) const
+{
+    switch (type)
+        {
+        //Tangent space XY, Z is reconstructed
+        case Texture_Types::Normal:
+            return compress_ ? PixelFormat::BC5 : PixelFormat::RG8;
+        case Texture_Types::Specular:
+        case Texture_Types::Height:
+        case Texture_Types::Ambient_occlusion:
+            return compress_ ? PixelFormat::BC4 : PixelFormat::R8;
+        case Texture_Types::Metallic_roughness:
+            return compress_ ? PixelFormat::BC1 : PixelFormat::RGBA8;
+        default:
+            break;
+        }
+    if (!compress_)
+        return PixelFormat::RGBA8;
+    return isOpaque(img) ? PixelFormat::BC1 : PixelFormat::BC3;
+}
 
-    vkBindImageMemory(dev_, image.first, image.second, 0);
-    return image;
+bool TextureFactory::supportsBlockCompression() const
+{
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(physDev_, &features);
+    return features.textureCompressionBC == VK_TRUE;
 }
 
-VkImageView TextureFactory::CreateTextureImageView(VkImage img)
+bool TextureFactory::canBlit(VkFormat format) const
 {
-    return CreateImageView(img, VK_FORMAT_R8G8B8A8_SRGB,
-                           VK_IMAGE_ASPECT_COLOR_BIT);
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(physDev_, format, &props);
+    const VkFormatFeatureFlags features =
+        VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (props.optimalTilingFeatures & features) == features;
 }
 
 VkFormat
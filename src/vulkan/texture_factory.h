@@ -2,11 +2,14 @@
 
 #pragma once
 
+#include "../scene_objects/texture.h"
 #include "../utils/image.h"
 #include "buffer_factory.h"
 #include "objects/texture.h"
+#include "sampler_cache.h"
 
 #include <tuple>
+#include <vector>
 #include <exception>
 #include <stdexcept>
 #include <memory>
@@ -16,32 +19,104 @@
 namespace Multor::Vulkan
 {
 
+/// \brief Levels of a texture ready for upload, see
+/// TextureFactory::PrepareTexture
+struct PreparedTexture
+{
+    PixelFormat           format_    = PixelFormat::RGBA8;
+    bool                  srgb_      = false;
+    //Levels of the image, levels_ holds fewer if the rest is blitted
+    uint32_t              mipLevels_ = 1;
+    bool                  blit_      = false;
+    //Top levels of the source left out, levels_ starts behind them
+    uint32_t              skippedLevels_ = 0;
+    std::vector<MipLevel> levels_;
+    //Filtered or encoded levels, or empty if image_ is uploaded as is
+    std::vector<unsigned char> chain_;
+    std::shared_ptr<Image>     image_;
+
+    const unsigned char* Data() const
+    {
+        return chain_.empty() ? image_->mdata_ : chain_.data();
+    }
+    VkDeviceSize Size() const
+    {
+        return levels_.back().offset_ +
+               LevelSize(format_, levels_.back().width_,
+                         levels_.back().height_);
+    }
+};
+
 class TextureFactory : public BufferFactory
 {
 public:
     TextureFactory(VkDevice dev, VkPhysicalDevice PhysDev,
                      std::shared_ptr<CommandExecuter> ex)
-        : BufferFactory(dev, PhysDev, ex)
+        : BufferFactory(dev, PhysDev, ex),
+          samplers_(std::make_shared<SamplerCache>(dev))
     {
     }
-    Texture*                 CreateTexture(Image* img);
+    /// \brief Builds the levels of a texture from the first image, CPU
+    /// work only and safe to call from any thread. Following images that
+    /// halve the size of the one before are used as baked levels, missing
+    /// levels are left to GPU blits or filtered on the CPU if the format
+    /// or the upload queue can not blit.
+    ///
+    /// The format follows \p type: one or two channels for data maps, sRGB
+    /// only for color. With compression enabled raw images are encoded to
+    /// BC formats on the CPU. Images loaded from DDS or KTX2 keep their
+    /// format and levels. The first \p skipLevels levels are left out,
+    /// at most all but the last one.
+    PreparedTexture
+    PrepareTexture(const std::vector<std::shared_ptr<Image> >& images,
+                   Texture_Types type, uint32_t skipLevels = 0) const;
+    /// \brief Creates the image of \p prepared and uploads its levels
+    Texture* CreateTexture(const PreparedTexture& prepared);
+    Texture* CreateTexture(const std::vector<std::shared_ptr<Image> >& images,
+                           Texture_Types                               type);
     std::unique_ptr<Texture> CreateDepthTexture(std::uint32_t width,
                                                   std::uint32_t height);
 
     VkImageView CreateImageView(VkImage image, VkFormat format,
-                                VkImageAspectFlags aspectFlags);
-    std::pair<VkImage, VkDeviceMemory>
+                                VkImageAspectFlags aspectFlags,
+                                uint32_t           mipLevels = 1);
+    std::pair<VkImage, MemoryAllocation>
                 CreateImage(uint32_t width, uint32_t height, VkFormat format,
                             VkImageTiling tiling, VkImageUsageFlags usage,
-                            VkMemoryPropertyFlags properties);
-    VkImageView CreateTextureImageView(VkImage img);
+                            VkMemoryPropertyFlags properties,
+                            uint32_t              mipLevels = 1);
+    VkImageView CreateTextureImageView(VkImage img, VkFormat format,
+                                       uint32_t mipLevels = 1);
+    //Shared from the sampler cache, never destroyed by the caller
     VkSampler   CreateTextureSampler();
     VkFormat    FindDepthFormat();
 
+    const std::shared_ptr<SamplerCache>& GetSamplerCache() const
+    {
+        return samplers_;
+    }
+
+    /// \brief Encodes raw images of textures created afterwards to BC
+    /// formats. Returns false if the device does not support them.
+    bool SetCompression(bool enabled);
+    bool IsCompressionEnabled() const { return compress_; }
+
+protected:
+    //Shared with every texture so its samplers outlive the factory
+    std::shared_ptr<SamplerCache> samplers_;
+
 private:
+    /// \brief Alpha of \p img is only scanned to pick between BC1 and BC3
+    PixelFormat chooseFormat(Texture_Types type, const Image& img) const;
+    bool        supportsBlockCompression() const;
+    //Whether mip levels of optimal tiled \p format can be blitted
+    bool     canBlit(VkFormat format) const;
     VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates,
                                  VkImageTiling                tiling,
                                  VkFormatFeatureFlags         features);
+
+private:
+    bool compress_ = false;
 };
 
 } // namespace Multor::Vulkan
@@ -0,0 +1,170 @@
+/// \file texture_residency.cpp
+
+#include "texture_residency.h"
+
+#include <algorithm>
+
+namespace Multor::Vulkan
+{
+
+namespace
+{
+
+//Levels a texture keeps at least, 32x32 texels for a square one
+constexpr uint32_t minLevels = 6;
+//Share of the budget restores have to fit in, so a restored texture does
+//not push the next one out right away
+constexpr int64_t restorePercent = 90;
+
+} // namespace
+
+TextureResidency::TextureResidency(MeshFactory& factory)
+    : logger_(Logging::LoggerFactory::GetLogger("vulkan.log")),
+      factory_(factory), rateStart_(std::chrono::steady_clock::now())
+{
+}
+
+void TextureResidency::SetBudget(VkDeviceSize bytes)
+{
+    budget_ = bytes;
+    if (budget_ > 0)
+        LOG_INFO(logger_.get(), "Texture budget {} MiB", budget_ >> 20);
+}
+
+void TextureResidency::MarkSampled(Texture& texture, uint64_t frame,
+                                   float distance)
+{
+    if (texture.lastUsed_ != frame)
+        {
+            texture.lastUsed_ = frame;
+            texture.distance_ = distance;
+        }
+    else
+        texture.distance_ = std::min(texture.distance_, distance);
+}
+
+void TextureResidency::Update(uint64_t frame)
+{
+    const auto   now     = std::chrono::steady_clock::now();
+    const double elapsed =
+        std::chrono::duration<double>(now - rateStart_).count();
+    if (elapsed >= 1.0)
+        {
+            evictionsPerSecond_ =
+                static_cast<float>((evictions_ - rateEvictions_) / elapsed);
+            rateEvictions_ = evictions_;
+            rateStart_     = now;
+        }
+
+    const TextureList textures = factory_.GetTextures();
+    resident_                  = 0;
+    for (const auto& entry : textures)
+        resident_ += entry.second->bytes_;
+
+    //Restreams that arrived or failed are part of resident_ or dropped
+    int64_t pending = 0;
+    for (auto it = pending_.begin(); it != pending_.end();)
+        {
+            if (!factory_.IsStreaming(it->first))
+                {
+                    it = pending_.erase(it);
+                    continue;
+                }
+            pending += it->second;
+            ++it;
+        }
+    if (budget_ == 0)
+        return;
+
+    const int64_t budget    = static_cast<int64_t>(budget_);
+    const int64_t projected = static_cast<int64_t>(resident_) + pending;
+    if (projected > budget)
+        evict(textures, projected - budget);
+    else
+        restore(textures, frame, budget * restorePercent / 100 - projected);
+}
+
+TextureResidencyStats TextureResidency::GetStats() const
+{
+    TextureResidencyStats stats;
+    stats.resident_           = resident_;
+    stats.budget_             = budget_;
+    stats.evictionsPerSecond_ = evictionsPerSecond_;
+    stats.pressure_           = budget_ > 0 ? static_cast<float>(resident_) /
+                                        static_cast<float>(budget_)
+                                            : 0.0f;
+    return stats;
+}
+
+void TextureResidency::evict(const TextureList& textures, int64_t excess)
+{
+    std::vector<const TextureList::value_type*> candidates;
+    for (const auto& entry : textures)
+        if (entry.second->mipLevels_ > minLevels &&
+            !pending_.contains(entry.first.get()))
+            candidates.push_back(&entry);
+    std::sort(candidates.begin(), candidates.end(),
+              [](const auto* a, const auto* b)
+              {
+                  const Texture& x = *a->second;
+                  const Texture& y = *b->second;
+                  if (x.lastUsed_ != y.lastUsed_)
+                      return x.lastUsed_ < y.lastUsed_;
+                  return x.distance_ > y.distance_;
+              });
+
+    int64_t freed = 0;
+    for (const auto* entry : candidates)
+        {
+            if (freed >= excess)
+                break;
+            const Texture& texture = *entry->second;
+            if (!factory_.RestreamTexture(entry->first,
+                                          texture.skippedLevels_ + 1))
+                continue;
+            //The top level holds three quarters of a full chain
+            const int64_t saved = static_cast<int64_t>(texture.bytes_) * 3 / 4;
+            pending_[entry->first.get()] = -saved;
+            freed += saved;
+            ++evictions_;
+        }
+}
+
+void TextureResidency::restore(const TextureList& textures, uint64_t frame,
+                               int64_t headroom)
+{
+    std::vector<const TextureList::value_type*> candidates;
+    for (const auto& entry : textures)
+        if (entry.second->skippedLevels_ > 0 &&
+            entry.second->lastUsed_ == frame &&
+            !pending_.contains(entry.first.get()))
+            candidates.push_back(&entry);
+    std::sort(candidates.begin(), candidates.end(),
+              [](const auto* a, const auto* b)
+              { return a->second->distance_ < b->second->distance_; });
+
+    for (const auto* entry : candidates)
+        {
+            if (headroom <= 0)
+                break;
+            const Texture& texture = *entry->second;
+            //As many levels back as fit, each one quadruples the size
+            for (uint32_t skip = 0; skip < texture.skippedLevels_; ++skip)
+                {
+                    const int64_t cost =
+                        static_cast<int64_t>(texture.bytes_) *
+                        ((int64_t(1) << (2 * (texture.skippedLevels_ - skip))) -
+                         1);
+                    if (cost > headroom)
+                        continue;
+                    if (factory_.RestreamTexture(entry->first, skip))
+                        {
+                            pending_[entry->first.get()] = cost;
+                            headroom -= cost;
+                        }
+                    break;
+                }
+        }
+}
+
+} // namespace Multor::Vulkan
@@ -0,0 +1,76 @@
+/// \file texture_residency.h
+
+#pragma once
+
+#include "../logger/logger.h"
+#include "mesh_factory.h"
+
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+
+#include <vulkan/vulkan.h>
+
+namespace Multor::Vulkan
+{
+
+struct TextureResidencyStats
+{
+    //Texel bytes of the textures meshes hold
+    VkDeviceSize resident_           = 0;
+    //0 if unlimited
+    VkDeviceSize budget_             = 0;
+    float        evictionsPerSecond_ = 0.0f;
+    //Resident bytes per budget byte, above 1 while over budget
+    float        pressure_           = 0.0f;
+};
+
+/// \brief Keeps the textures of the mesh factory within a memory budget.
+///
+/// The renderer marks the textures its draw list samples every frame.
+/// While the resident bytes exceed the budget, textures drop their top mip
+/// level, least recently drawn first and farthest from the camera among
+/// those drawn equally recently. Reduced textures regain their levels once
+/// they are drawn and fit again. Both are streamed through the mesh
+/// factory, meshes keep sampling the old texture until the new one arrived.
+class TextureResidency
+{
+public:
+    explicit TextureResidency(MeshFactory& factory);
+
+    /// \param bytes 0 for no limit
+    void         SetBudget(VkDeviceSize bytes);
+    VkDeviceSize GetBudget() const { return budget_; }
+
+    /// \brief Records that \p texture was drawn in \p frame at \p distance
+    /// from the camera, the nearest draw of a frame counts
+    static void MarkSampled(Texture& texture, uint64_t frame, float distance);
+    /// \brief Measures the resident bytes and queues evictions or restores,
+    /// once per frame after the draws were marked
+    void Update(uint64_t frame);
+
+    TextureResidencyStats GetStats() const;
+
+private:
+    using TextureList = std::vector<
+        std::pair<std::shared_ptr<BaseTexture>, std::shared_ptr<Texture> > >;
+
+    void evict(const TextureList& textures, int64_t excess);
+    void restore(const TextureList& textures, uint64_t frame, int64_t headroom);
+
+private:
+    Logging::Logger& logger_;
+
+    MeshFactory& factory_;
+    VkDeviceSize budget_   = 0;
+    VkDeviceSize resident_ = 0;
+    //Expected change of the resident bytes per restream not arrived yet
+    std::unordered_map<const BaseTexture*, int64_t> pending_;
+
+    uint64_t                              evictions_       = 0;
+    uint64_t                              rateEvictions_   = 0;
+    std::chrono::steady_clock::time_point rateStart_;
+    float                                 evictionsPerSecond_ = 0.0f;
+};
+
+} // namespace Multor::Vulkan
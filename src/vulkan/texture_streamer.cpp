@@ -0,0 +1,280 @@
+/// \file texture_streamer.cpp
+
+#include "texture_streamer.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace Multor::Vulkan
+{
+
+TextureStreamer::TextureStreamer(TextureFactory& factory, uint32_t threads)
+    : logger_(Logging::LoggerFactory::GetLogger("vulkan.log")),
+      factory_(factory)
+{
+    //The other half records command buffers and compiles shaders
+    if (threads == 0)
+        threads = std::max(std::thread::hardware_concurrency() / 2, 1u);
+    threads_.reserve(threads);
+    for (uint32_t i = 0; i < threads; ++i)
+        threads_.emplace_back(&TextureStreamer::workerLoop, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    jobsReady_.notify_all();
+    for (std::thread& thread : threads_)
+        thread.join();
+}
+
+std::shared_ptr<Texture>
+TextureStreamer::Request(const std::shared_ptr<BaseTexture>& source)
+{
+    queue(source, 0);
+    return placeholder(source->GetType());
+}
+
+bool TextureStreamer::Restream(const std::shared_ptr<BaseTexture>& source,
+                               uint32_t                            skipLevels)
+{
+    return queue(source, skipLevels);
+}
+
+bool TextureStreamer::IsStreaming(const BaseTexture* source) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.find(source) != jobs_.end();
+}
+
+void TextureStreamer::Prioritize(
+    const std::vector<std::pair<const BaseTexture*, float> >& priorities)
+{
+    std::unordered_map<const BaseTexture*, float> nearest;
+    for (const auto& [source, priority] : priorities)
+        {
+            auto [it, inserted] = nearest.emplace(source, priority);
+            if (!inserted)
+                it->second = std::min(it->second, priority);
+        }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [source, priority] : nearest)
+        {
+            auto found = jobs_.find(source);
+            if (found != jobs_.end())
+                found->second.priority_ = priority;
+        }
+}
+
+std::vector<TextureStreamer::Arrival> TextureStreamer::Poll(VkDeviceSize budget)
+{
+    std::vector<std::pair<const BaseTexture*, Job*> > prepared;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = jobs_.begin(); it != jobs_.end();)
+            {
+                if (it->second.state_ == State::Failed)
+                    {
+                        it = jobs_.erase(it);
+                        continue;
+                    }
+                if (it->second.state_ == State::Prepared)
+                    prepared.emplace_back(it->first, &it->second);
+                ++it;
+            }
+    }
+
+    //Nearest first, the rest waits for the next frame once the budget is
+    //used up. Prepared jobs are only touched by this thread.
+    std::sort(prepared.begin(), prepared.end(),
+              [](const auto& a, const auto& b)
+              { return a.second->priority_ < b.second->priority_; });
+    VkDeviceSize staged  = 0;
+    bool         created = false;
+    for (auto& [source, job] : prepared)
+        {
+            if (staged > 0 && staged >= budget)
+                break;
+            try
+                {
+                    job->texture_.reset(factory_.CreateTexture(job->prepared_));
+                    job->uploadValue_ = factory_.GetLastUpload();
+                    staged += job->texture_->bytes_;
+                    created = true;
+                }
+            catch (const std::exception& err)
+                {
+                    LOG_WARNING(logger_.get(), "Failed to stream texture {}: {}",
+                                job->source_->GetPath(), err.what());
+                    job->texture_.reset();
+                }
+            job->prepared_ = {};
+            std::lock_guard<std::mutex> lock(mutex_);
+            job->state_ = job->texture_ ? State::Uploading : State::Failed;
+            if (!job->texture_)
+                ++failed_;
+        }
+
+    const auto& uploads = factory_.GetUploadService();
+    if (created && uploads)
+        uploads->Flush();
+
+    std::vector<Arrival> arrivals;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = jobs_.begin(); it != jobs_.end();)
+        {
+            Job& job = it->second;
+            if (job.state_ != State::Uploading ||
+                (uploads && !uploads->IsComplete(job.uploadValue_)))
+                {
+                    ++it;
+                    continue;
+                }
+            arrivals.push_back({std::move(job.source_), std::move(job.texture_)});
+            ++streamed_;
+            it = jobs_.erase(it);
+        }
+    return arrivals;
+}
+
+TextureStreamingStats TextureStreamer::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    TextureStreamingStats stats;
+    for (const auto& entry : jobs_)
+        {
+            const State state = entry.second.state_;
+            if (state == State::Queued || state == State::Decoding)
+                ++stats.queued_;
+            else if (state == State::Prepared || state == State::Uploading)
+                ++stats.uploading_;
+        }
+    stats.streamed_ = streamed_;
+    stats.failed_   = failed_;
+    return stats;
+}
+
+bool TextureStreamer::queue(const std::shared_ptr<BaseTexture>& source,
+                            uint32_t                            skipLevels)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (jobs_.find(source.get()) != jobs_.end())
+        return false;
+    Job& job        = jobs_[source.get()];
+    job.source_     = source;
+    job.skipLevels_ = skipLevels;
+    ++queued_;
+    jobsReady_.notify_one();
+    return true;
+}
+
+std::shared_ptr<Texture> TextureStreamer::placeholder(Texture_Types type)
+{
+    auto found = placeholders_.find(type);
+    if (found != placeholders_.end())
+        return found->second;
+
+    //Neutral values: flat normal, no occlusion, rough dielectric
+    unsigned char texel[4] = {128, 128, 128, 255};
+    switch (type)
+        {
+        case Texture_Types::Normal:
+            texel[0] = texel[1] = 128, texel[2] = 255;
+            break;
+        case Texture_Types::Ambient_occlusion:
+            texel[0] = texel[1] = texel[2] = 255;
+            break;
+        case Texture_Types::Metallic_roughness:
+            texel[0] = 0, texel[1] = 255, texel[2] = 0;
+            break;
+        case Texture_Types::Emissive:
+        case Texture_Types::Specular:
+        case Texture_Types::Height:
+            texel[0] = texel[1] = texel[2] = 0;
+            break;
+        default:
+            break;
+        }
+    auto image = std::make_shared<Image>(
+        1, 1, 4, nullptr,
+        [](void* ptr) { delete[] static_cast<unsigned char*>(ptr); });
+    std::copy(texel, texel + 4, image->mdata_);
+
+    std::shared_ptr<Texture> texture(factory_.CreateTexture({image}, type));
+    texture->placeholder_ = true;
+    placeholders_.emplace(type, texture);
+    return texture;
+}
+
+void TextureStreamer::workerLoop()
+{
+    for (;;)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            jobsReady_.wait(lock, [this] { return stop_ || queued_ > 0; });
+            if (stop_)
+                return;
+
+            auto next = jobs_.end();
+            for (auto it = jobs_.begin(); it != jobs_.end(); ++it)
+                if (it->second.state_ == State::Queued &&
+                    (next == jobs_.end() ||
+                     it->second.priority_ < next->second.priority_))
+                    next = it;
+            //Never taken while the count is right, avoids spinning if not
+            if (next == jobs_.end())
+                {
+                    queued_ = 0;
+                    continue;
+                }
+            --queued_;
+            Job& job   = next->second;
+            job.state_ = State::Decoding;
+            std::shared_ptr<BaseTexture> source     = job.source_;
+            const uint32_t               skipLevels = job.skipLevels_;
+            lock.unlock();
+
+            //Entries are erased by Poll only once they leave Decoding, so
+            //job stays valid while unlocked
+            PreparedTexture prepared;
+            bool            done = false;
+            try
+                {
+                    auto images = source->GetImages();
+                    if (!images.empty() && images[0] && !images[0]->empty())
+                        {
+                            prepared = factory_.PrepareTexture(
+                                images, source->GetType(), skipLevels);
+                            done = true;
+                        }
+                    else
+                        LOG_WARNING(logger_.get(), "Failed to decode texture {}",
+                                    source->GetPath());
+                }
+            catch (const std::exception& err)
+                {
+                    LOG_WARNING(logger_.get(), "Failed to prepare texture {}: {}",
+                                source->GetPath(), err.what());
+                }
+            //Decoded again if the texture is streamed once more
+            source->ReleaseImages();
+
+            lock.lock();
+            if (done)
+                {
+                    job.prepared_ = std::move(prepared);
+                    job.state_    = State::Prepared;
+                }
+            else
+                {
+                    job.state_ = State::Failed;
+                    ++failed_;
+                }
+        }
+}
+
+} // namespace Multor::Vulkan
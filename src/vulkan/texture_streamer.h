@@ -0,0 +1,126 @@
+/// \file texture_streamer.h
+
+#pragma once
+
+#include "../logger/logger.h"
+#include "../scene_objects/texture.h"
+#include "texture_factory.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace Multor::Vulkan
+{
+
+struct TextureStreamingStats
+{
+    //Waiting for a worker or being decoded
+    uint32_t queued_    = 0;
+    //Decoded, waiting for their image or upload
+    uint32_t uploading_ = 0;
+    uint64_t streamed_  = 0;
+    uint64_t failed_    = 0;
+};
+
+/// \brief Decodes and uploads textures in the background while meshes
+/// sample placeholders.
+///
+/// Workers decode and prepare the queued request with the lowest priority
+/// value first, the renderer keeps it at the camera distance of the
+/// nearest mesh using the texture. Images are created on the thread
+/// calling Poll, which hands textures out once their upload is complete,
+/// so they are never sampled half written. Textures in use are streamed
+/// again through Restream when their resolution changes.
+class TextureStreamer
+{
+public:
+    struct Arrival
+    {
+        std::shared_ptr<BaseTexture> source_;
+        std::shared_ptr<Texture>     texture_;
+    };
+
+    /// \param threads Decoding workers, 0 for half the hardware threads
+    explicit TextureStreamer(TextureFactory& factory, uint32_t threads = 0);
+    /// \brief Waits for running decodes, queued requests are dropped
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&)            = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    /// \brief Queues \p source unless it is streaming already and returns
+    /// the placeholder of its type, uploaded through the factory
+    std::shared_ptr<Texture> Request(const std::shared_ptr<BaseTexture>& source);
+    /// \brief Queues \p source again with its first \p skipLevels levels
+    /// left out, unless it is streaming already. Returns whether it was
+    /// queued, the texture arrives through Poll.
+    bool Restream(const std::shared_ptr<BaseTexture>& source,
+                  uint32_t                            skipLevels);
+    bool IsStreaming(const BaseTexture* source) const;
+    /// \brief Orders queued requests, lower values are decoded first. The
+    /// lowest value given for a source wins.
+    void Prioritize(
+        const std::vector<std::pair<const BaseTexture*, float> >& priorities);
+    /// \brief Creates images of decoded textures until \p budget bytes are
+    /// staged, at least one, and returns textures whose upload completed
+    std::vector<Arrival> Poll(VkDeviceSize budget);
+
+    TextureStreamingStats GetStats() const;
+
+private:
+    enum class State : uint8_t
+    {
+        Queued,
+        Decoding,
+        Prepared,
+        Uploading,
+        Failed
+    };
+
+    struct Job
+    {
+        //Kept alive until the texture arrives, so its address is not
+        //reused by another source meanwhile
+        std::shared_ptr<BaseTexture> source_;
+        float    priority_    = std::numeric_limits<float>::max();
+        State    state_       = State::Queued;
+        uint32_t skipLevels_  = 0;
+        PreparedTexture          prepared_;
+        std::shared_ptr<Texture> texture_;
+        uint64_t uploadValue_ = 0;
+    };
+
+    bool queue(const std::shared_ptr<BaseTexture>& source, uint32_t skipLevels);
+    std::shared_ptr<Texture> placeholder(Texture_Types type);
+    void                     workerLoop();
+
+private:
+    Logging::Logger& logger_;
+
+    TextureFactory& factory_;
+    //1x1 stand-ins, created on first use
+    std::map<Texture_Types, std::shared_ptr<Texture> > placeholders_;
+
+    //Entries are added and erased by the Poll thread only, workers change
+    //their state
+    std::unordered_map<const BaseTexture*, Job> jobs_;
+    uint32_t                                    queued_   = 0;
+    uint64_t                                    streamed_ = 0;
+    uint64_t                                    failed_   = 0;
+    mutable std::mutex                          mutex_;
+    std::condition_variable                     jobsReady_;
+    bool                                        stop_ = false;
+    std::vector<std::thread>                    threads_;
+};
+
+} // namespace Multor::Vulkan
@@ -0,0 +1,120 @@
+/// \file texture_table.cpp
+
+#include "texture_table.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Multor::Vulkan
+{
+
+TextureTable::TextureTable(VkDevice device, VkDescriptorSetLayout layout,
+                           uint32_t binding, uint32_t capacity)
+    : device_(device), binding_(binding), capacity_(std::max(capacity, 1u)),
+      slots_(capacity_)
+{
+    VkDescriptorPoolSize poolSize {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                   capacity_};
+
+    VkDescriptorPoolCreateInfo poolInfo {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.pNext = nullptr;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes    = &poolSize;
+    poolInfo.maxSets       = 1;
+    if (vkCreateDescriptorPool(device_, &poolInfo, nullptr, &pool_) !=
+        VK_SUCCESS)
+        throw std::runtime_error("failed to create texture table pool!");
+
+    VkDescriptorSetAllocateInfo allocInfo {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.pNext = nullptr;
+    allocInfo.descriptorPool     = pool_;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &layout;
+    if (vkAllocateDescriptorSets(device_, &allocInfo, &set_) != VK_SUCCESS)
+        {
+            vkDestroyDescriptorPool(device_, pool_, nullptr);
+            throw std::runtime_error("failed to allocate texture table set!");
+        }
+}
+
+TextureTable::~TextureTable()
+{
+    vkDestroyDescriptorPool(device_, pool_, nullptr);
+}
+
+uint32_t TextureTable::Acquire(const std::shared_ptr<Texture>& texture)
+{
+    if (!texture)
+        throw std::runtime_error("texture is null");
+
+    auto found = indices_.find(texture.get());
+    if (found != indices_.end())
+        {
+            ++slots_[found->second].refs_;
+            return found->second;
+        }
+
+    uint32_t slot = 0;
+    if (!freeSlots_.empty())
+        {
+            slot = freeSlots_.back();
+            freeSlots_.pop_back();
+        }
+    else if (nextSlot_ < capacity_)
+        slot = nextSlot_++;
+    else
+        throw std::runtime_error("texture table is exhausted");
+
+    slots_[slot] = {texture, 1};
+    indices_.emplace(texture.get(), slot);
+
+    VkDescriptorImageInfo imageInfo {texture->sampler_, texture->view_,
+                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkWriteDescriptorSet  write {};
+    write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.pNext           = nullptr;
+    write.dstSet          = set_;
+    write.dstBinding      = binding_;
+    write.dstArrayElement = slot;
+    write.descriptorCount = 1;
+    write.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo      = &imageInfo;
+    vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+    return slot;
+}
+
+void TextureTable::Release(uint32_t slot)
+{
+    if (slot >= capacity_ || slots_[slot].refs_ == 0)
+        throw std::out_of_range("texture slot is not in use");
+    if (--slots_[slot].refs_ > 0)
+        return;
+
+    //The stale descriptor stays, partially bound slots are never read
+    indices_.erase(slots_[slot].texture_.get());
+    slots_[slot].texture_.reset();
+    freeSlots_.push_back(slot);
+}
+
+uint32_t TextureTable::MaxCapacity(VkPhysicalDevice physDev)
+{
+    VkPhysicalDeviceVulkan12Properties properties12 {};
+    properties12.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &properties12;
+    vkGetPhysicalDeviceProperties2(physDev, &properties);
+
+    //Combined image samplers count against both sampler and image limits
+    return std::min(
+        {properties12.maxPerStageDescriptorUpdateAfterBindSamplers,
+         properties12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+         properties12.maxDescriptorSetUpdateAfterBindSamplers,
+         properties12.maxDescriptorSetUpdateAfterBindSampledImages});
+}
+
+} // namespace Multor::Vulkan
@@ -0,0 +1,70 @@
+/// \file texture_table.h
+
+#pragma once
+
+#include "objects/texture.h"
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace Multor::Vulkan
+{
+
+/// \brief Bindless array of textures in one descriptor set, indexed by
+/// shaders through the object records.
+///
+/// A texture takes a slot on its first Acquire and keeps it while any
+/// mesh references it, so descriptor writes scale with unique textures.
+/// The binding is update after bind and partially bound: new slots are
+/// written while the set is bound by recorded and pending command
+/// buffers, and unused slots are never written.
+class TextureTable
+{
+public:
+    /// \param layout Set layout whose \p binding is the texture array
+    TextureTable(VkDevice device, VkDescriptorSetLayout layout,
+                 uint32_t binding, uint32_t capacity);
+    ~TextureTable();
+
+    TextureTable(const TextureTable&)            = delete;
+    TextureTable& operator=(const TextureTable&) = delete;
+
+    /// \brief Slot of \p texture, its descriptor is written on first use
+    uint32_t Acquire(const std::shared_ptr<Texture>& texture);
+    /// \brief Drops a reference taken by Acquire. The slot is reused once
+    /// the last one is gone, so the caller defers this until no frame
+    /// samples it.
+    void Release(uint32_t slot);
+
+    VkDescriptorSet GetSet() const { return set_; }
+    uint32_t        GetCapacity() const { return capacity_; }
+    //Textures holding a slot
+    uint32_t GetCount() const { return static_cast<uint32_t>(indices_.size()); }
+
+    /// \brief Largest array the device binds with update after bind
+    static uint32_t MaxCapacity(VkPhysicalDevice physDev);
+
+private:
+    struct Slot
+    {
+        std::shared_ptr<Texture> texture_;
+        uint32_t                 refs_ = 0;
+    };
+
+    VkDevice         device_;
+    VkDescriptorPool pool_ = VK_NULL_HANDLE;
+    VkDescriptorSet  set_  = VK_NULL_HANDLE;
+    uint32_t         binding_;
+    uint32_t         capacity_;
+
+    std::vector<Slot>                            slots_;
+    std::unordered_map<const Texture*, uint32_t> indices_;
+    std::vector<uint32_t>                        freeSlots_;
+    uint32_t                                     nextSlot_ = 0;
+};
+
+} // namespace Multor::Vulkan
@@ -0,0 +1,120 @@
+/// \file uniform_ring.cpp
+
+#include "uniform_ring.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Multor::Vulkan
+{
+
+UniformRing::UniformRing(std::unique_ptr<Buffer> buffer, void* mapped,
+                         uint32_t segments, VkDeviceSize segmentSize,
+                         VkDeviceSize alignment)
+    : buffer_(std::move(buffer)),
+      mapped_(static_cast<std::byte*>(mapped)),
+      segments_(segments),
+      segmentSize_(segmentSize),
+      alignment_(std::max<VkDeviceSize>(alignment, 1))
+{
+    if (!buffer_ || !mapped_)
+        throw std::runtime_error("uniform ring requires a mapped buffer");
+}
+
+UniformRing::~UniformRing()
+{
+    //The mapping belongs to the allocator block and outlives the ring
+    mapped_ = nullptr;
+}
+
+VkDeviceSize UniformRing::Align(VkDeviceSize size) const
+{
+    return (size + alignment_ - 1) / alignment_ * alignment_;
+}
+
+UniformRange UniformRing::Allocate(VkDeviceSize size)
+{
+    const VkDeviceSize aligned = Align(size);
+
+    //First fit over released ranges, then bump the head
+    for (auto it = freeRanges_.begin(); it != freeRanges_.end(); ++it)
+        {
+            if (it->size_ < aligned)
+                continue;
+            UniformRange range {it->offset_, aligned};
+            it->offset_ += aligned;
+            it->size_ -= aligned;
+            if (it->size_ == 0)
+                freeRanges_.erase(it);
+            return range;
+        }
+
+    if (head_ + aligned > segmentSize_)
+        throw std::runtime_error("uniform ring is exhausted");
+
+    UniformRange range {head_, aligned};
+    head_ += aligned;
+    return range;
+}
+
+void UniformRing::Free(const UniformRange& range)
+{
+    if (range.size_ == 0)
+        return;
+
+    auto it = std::lower_bound(freeRanges_.begin(), freeRanges_.end(), range,
+                               [](const UniformRange& a, const UniformRange& b)
+                               { return a.offset_ < b.offset_; });
+    it = freeRanges_.insert(it, range);
+
+    if (auto next = std::next(it);
+        next != freeRanges_.end() && it->offset_ + it->size_ == next->offset_)
+        {
+            it->size_ += next->size_;
+            freeRanges_.erase(next);
+        }
+    if (it != freeRanges_.begin())
+        if (auto prev = std::prev(it); prev->offset_ + prev->size_ == it->offset_)
+            {
+                prev->size_ += it->size_;
+                it = freeRanges_.erase(it);
+                it = std::prev(it);
+            }
+
+    //Give the tail back to the bump allocator
+    if (it->offset_ + it->size_ == head_)
+        {
+            head_ = it->offset_;
+            freeRanges_.erase(it);
+        }
+}
+
+void* UniformRing::Map(uint32_t segment, const UniformRange& range) const
+{
+    if (segment >= segments_)
+        throw std::out_of_range("uniform ring segment out of range");
+    return mapped_ + segment * segmentSize_ + range.offset_;
+}
+
+void UniformRing::Write(uint32_t segment, const UniformRange& range,
+                        const void* data, VkDeviceSize size,
+                        VkDeviceSize offset)
+{
+    if (offset + size > range.size_)
+        throw std::out_of_range("uniform ring write exceeds range");
+    std::memcpy(static_cast<std::byte*>(Map(segment, range)) + offset, data,
+                static_cast<std::size_t>(size));
+}
+
+VkDescriptorBufferInfo
+UniformRing::DescriptorInfo(uint32_t segment, const UniformRange& range) const
+{
+    VkDescriptorBufferInfo info {};
+    info.buffer = buffer_->buffer_;
+    info.offset = segment * segmentSize_ + range.offset_;
+    info.range  = range.size_;
+    return info;
+}
+
+} // namespace Multor::Vulkan
@@ -0,0 +1,69 @@
+/// \file uniform_ring.h
+
+#pragma once
+
+#include "objects/buffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace Multor::Vulkan
+{
+
+/// \brief Range reserved in the uniform ring. The same offset is valid in
+/// every frame segment.
+struct UniformRange
+{
+    VkDeviceSize offset_ = 0;
+    VkDeviceSize size_   = 0;
+};
+
+/// \brief Persistently mapped host-coherent uniform buffer split into one
+/// segment per frame in flight.
+///
+/// Ranges are handed out aligned to minUniformBufferOffsetAlignment and
+/// exist once per segment, so a frame updates its data with a plain memcpy
+/// into its own segment while other segments are still read by the GPU.
+class UniformRing
+{
+public:
+    UniformRing(std::unique_ptr<Buffer> buffer, void* mapped,
+                uint32_t segments, VkDeviceSize segmentSize,
+                VkDeviceSize alignment);
+    ~UniformRing();
+
+    UniformRing(const UniformRing&)            = delete;
+    UniformRing& operator=(const UniformRing&) = delete;
+
+    UniformRange Allocate(VkDeviceSize size);
+    void         Free(const UniformRange& range);
+
+    void Write(uint32_t segment, const UniformRange& range, const void* data,
+               VkDeviceSize size, VkDeviceSize offset = 0);
+    void* Map(uint32_t segment, const UniformRange& range) const;
+
+    VkDescriptorBufferInfo DescriptorInfo(uint32_t            segment,
+                                          const UniformRange& range) const;
+
+    VkBuffer     GetBuffer() const { return buffer_->buffer_; }
+    uint32_t     GetSegmentCount() const { return segments_; }
+    VkDeviceSize GetSegmentSize() const { return segmentSize_; }
+    VkDeviceSize GetUsedSize() const { return head_; }
+    VkDeviceSize Align(VkDeviceSize size) const;
+
+private:
+    std::unique_ptr<Buffer> buffer_;
+    std::byte*              mapped_;
+    uint32_t                segments_;
+    VkDeviceSize            segmentSize_;
+    VkDeviceSize            alignment_;
+    VkDeviceSize            head_ = 0;
+    //Released ranges sorted by offset, adjacent ones are merged
+    std::vector<UniformRange> freeRanges_;
+};
+
+} // namespace Multor::Vulkan
@@ -0,0 +1,516 @@
+/// \file upload_service.cpp
+
+#include "upload_service.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+namespace Multor::Vulkan
+{
+
+UploadService::UploadService(VkDevice                         device,
+                             std::shared_ptr<MemoryAllocator> allocator,
+                             VkQueue queue, uint32_t queueFamily,
+                             VkDeviceSize stagingSize, bool canBlit)
+    : logger_(Logging::LoggerFactory::GetLogger("vulkan.log")),
+      device_(device),
+      allocator_(std::move(allocator)),
+      queue_(queue),
+      queueFamily_(queueFamily),
+      canBlit_(canBlit),
+      ringSize_(stagingSize)
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.pNext            = nullptr;
+    poolInfo.queueFamilyIndex = queueFamily_;
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT |
+                     VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool_) !=
+        VK_SUCCESS)
+        throw std::runtime_error("failed to create upload command pool!");
+
+    VkSemaphoreTypeCreateInfo typeInfo {};
+    typeInfo.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.pNext         = nullptr;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue  = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &semaphore_) !=
+        VK_SUCCESS)
+        throw std::runtime_error("failed to create upload semaphore!");
+
+    ring_ = createStagingBuffer(ringSize_);
+}
+
+UploadService::~UploadService()
+{
+    LOG_TRACE_L1(logger_.get(), __FUNCTION__);
+
+    submit();
+    if (submittedValue_ > 0)
+        {
+            VkSemaphoreWaitInfo waitInfo {};
+            waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores    = &semaphore_;
+            waitInfo.pValues        = &submittedValue_;
+            vkWaitSemaphores(device_, &waitInfo, UINT64_MAX);
+        }
+    inFlight_.clear();
+    ring_.reset();
+    //Frees every command buffer of the pool as well
+    vkDestroyCommandPool(device_, commandPool_, nullptr);
+    vkDestroySemaphore(device_, semaphore_, nullptr);
+}
+
+uint64_t UploadService::UploadBuffer(VkBuffer dst, const void* data,
+                                     VkDeviceSize size, VkDeviceSize dstOffset)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const Staging src = stage(data, size, 4);
+
+    VkBufferCopy copyRegion {};
+    copyRegion.srcOffset = src.offset_;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size      = size;
+    pending_.bufferCopies_.push_back({src.buffer_, dst, copyRegion});
+
+    return nextValue_;
+}
+
+uint64_t UploadService::UploadImage(VkImage                      image,
+                                    const std::vector<MipLevel>& levels,
+                                    uint32_t mipLevels, const void* data,
+                                    VkDeviceSize size)
+{
+    if (levels.empty() || levels.size() > mipLevels)
+        throw std::invalid_argument("invalid image upload levels!");
+    if (levels.size() < mipLevels && !canBlit_)
+        throw std::invalid_argument("upload queue can not blit mip levels!");
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    //Buffer offsets of image copies must be a multiple of the texel or
+    //block size
+    const Staging src = stage(data, size, 16);
+
+    ImageCopy copy {src.buffer_, image, {}, mipLevels};
+    copy.regions_.reserve(levels.size());
+    for (uint32_t level = 0; level < levels.size(); ++level)
+        {
+            VkBufferImageCopy region {};
+            region.bufferOffset      = src.offset_ + levels[level].offset_;
+            region.bufferRowLength   = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel       = level;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount     = 1;
+            region.imageOffset                     = {0, 0, 0};
+            region.imageExtent = {levels[level].width_, levels[level].height_,
+                                  1};
+            copy.regions_.push_back(region);
+        }
+    pending_.imageCopies_.push_back(std::move(copy));
+
+    return nextValue_;
+}
+
+uint64_t UploadService::Flush()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    submit();
+    reclaim();
+    return submittedValue_;
+}
+
+void UploadService::Wait(uint64_t value)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (value > submittedValue_)
+        submit();
+
+    VkSemaphoreWaitInfo waitInfo {};
+    waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores    = &semaphore_;
+    waitInfo.pValues        = &value;
+    if (vkWaitSemaphores(device_, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+        throw std::runtime_error("failed to wait for uploads!");
+    reclaim();
+}
+
+bool UploadService::IsComplete(uint64_t value) const
+{
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(device_, semaphore_, &completed);
+    return completed >= value;
+}
+
+std::unique_ptr<Buffer> UploadService::createStagingBuffer(VkDeviceSize size)
+{
+    std::unique_ptr<Buffer> buf = std::make_unique<Buffer>();
+    VkBufferCreateInfo      bufferInfo {};
+    bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.pNext       = nullptr;
+    bufferInfo.size        = size;
+    bufferInfo.usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device_, &bufferInfo, nullptr, &buf->buffer_) !=
+        VK_SUCCESS)
+        throw std::runtime_error("failed to create staging buffer!");
+    buf->dev_ = device_;
+
+    buf->allocation_ = allocator_->AllocateBuffer(
+        buf->buffer_,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        AllocationStrategy::Linear);
+    buf->allocator_ = allocator_;
+    return buf;
+}
+
+UploadService::Staging UploadService::stage(const void* data, VkDeviceSize size,
+                                            VkDeviceSize alignment)
+{
+    if (size > ringSize_)
+        {
+            LOG_INFO(logger_.get(), "Upload of {} bytes bypasses the staging ring",
+                     size);
+            pending_.overflow_.push_back(createStagingBuffer(size));
+            auto& buf = pending_.overflow_.back();
+            std::memcpy(buf->allocation_.mapped_, data, size);
+            pending_.payload_ += size;
+            uploadedBytes_ += size;
+            return {buf->buffer_, 0};
+        }
+
+    VkDeviceSize offset   = 0;
+    VkDeviceSize consumed = 0;
+    for (;;)
+        {
+            reclaim();
+            offset   = (head_ + alignment - 1) / alignment * alignment;
+            consumed = offset - head_ + size;
+            //Wrap around, the tail of the ring is skipped
+            if (offset + size > ringSize_)
+                {
+                    offset   = 0;
+                    consumed = ringSize_ - head_ + size;
+                }
+            if (used_ + consumed <= ringSize_)
+                break;
+
+            //Ring is full, the oldest batch has to finish first
+            if (inFlight_.empty())
+                submit();
+            waitOldest();
+        }
+
+    head_ = offset + size;
+    used_ += consumed;
+    pending_.bytes_ += consumed;
+    pending_.payload_ += size;
+    uploadedBytes_ += size;
+    std::memcpy(static_cast<std::byte*>(ring_->allocation_.mapped_) + offset,
+                data, size);
+    return {ring_->buffer_, offset};
+}
+
+VkCommandBuffer UploadService::acquireCommandBuffer()
+{
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    if (!freeCmds_.empty())
+        {
+            cmd = freeCmds_.back();
+            freeCmds_.pop_back();
+        }
+    else
+        {
+            VkCommandBufferAllocateInfo allocInfo {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandPool        = commandPool_;
+            allocInfo.commandBufferCount = 1;
+            if (vkAllocateCommandBuffers(device_, &allocInfo, &cmd) !=
+                VK_SUCCESS)
+                throw std::runtime_error(
+                    "failed to allocate upload command buffer!");
+        }
+    return cmd;
+}
+
+void UploadService::record(const Batch& batch)
+{
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(batch.cmd_, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("failed to begin upload command buffer!");
+
+    //Buffers need no layout transition. Meshes interleave their vertex and
+    //index copies, grouped by source and destination every pair takes one
+    //call. The sort is stable, so copies to one buffer keep their order.
+    std::vector<BufferCopy> copies(batch.bufferCopies_);
+    std::stable_sort(copies.begin(), copies.end(),
+                     [](const BufferCopy& a, const BufferCopy& b)
+                     {
+                         const std::less<VkBuffer> less;
+                         if (a.src_ != b.src_)
+                             return less(a.src_, b.src_);
+                         return less(a.dst_, b.dst_);
+                     });
+    std::vector<VkBufferCopy> regions;
+    for (std::size_t i = 0; i < copies.size(); ++i)
+        {
+            const BufferCopy& copy = copies[i];
+            regions.push_back(copy.region_);
+            const bool last = i + 1 == copies.size();
+            if (last || copies[i + 1].src_ != copy.src_ ||
+                copies[i + 1].dst_ != copy.dst_)
+                {
+                    vkCmdCopyBuffer(batch.cmd_, copy.src_, copy.dst_,
+                                    static_cast<uint32_t>(regions.size()),
+                                    regions.data());
+                    regions.clear();
+                }
+        }
+
+    if (batch.imageCopies_.empty())
+        {
+            if (vkEndCommandBuffer(batch.cmd_) != VK_SUCCESS)
+                throw std::runtime_error("failed to end upload command buffer!");
+            return;
+        }
+
+    std::vector<VkImageMemoryBarrier> barriers(batch.imageCopies_.size());
+    for (std::size_t i = 0; i < barriers.size(); ++i)
+        {
+            VkImageMemoryBarrier& barrier = barriers[i];
+            barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image               = batch.imageCopies_[i].dst_;
+            barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.baseMipLevel   = 0;
+            barrier.subresourceRange.levelCount =
+                batch.imageCopies_[i].mipLevels_;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount     = 1;
+            barrier.srcAccessMask                   = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        }
+    vkCmdPipelineBarrier(batch.cmd_, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                         nullptr, static_cast<uint32_t>(barriers.size()),
+                         barriers.data());
+
+    for (const ImageCopy& copy : batch.imageCopies_)
+        vkCmdCopyBufferToImage(batch.cmd_, copy.src_, copy.dst_,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               static_cast<uint32_t>(copy.regions_.size()),
+                               copy.regions_.data());
+    recordMipBlits(batch);
+
+    //Transfer queues know no shader stages, the semaphore wait on the
+    //graphics queue makes the writes visible to the shaders. Blit sources
+    //are left in TRANSFER_SRC, only the last level is still a destination.
+    barriers.clear();
+    for (const ImageCopy& copy : batch.imageCopies_)
+        {
+            VkImageMemoryBarrier barrier {};
+            barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image               = copy.dst_;
+            barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.baseMipLevel   = 0;
+            barrier.subresourceRange.levelCount     = copy.mipLevels_;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount     = 1;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+            if (copy.regions_.size() < copy.mipLevels_)
+                {
+                    barrier.subresourceRange.baseMipLevel = copy.mipLevels_ - 1;
+                    barrier.subresourceRange.levelCount   = 1;
+                    barriers.push_back(barrier);
+                    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                    barrier.subresourceRange.baseMipLevel = 0;
+                    barrier.subresourceRange.levelCount = copy.mipLevels_ - 1;
+                    barrier.srcAccessMask               = 0;
+                }
+            barriers.push_back(barrier);
+        }
+    vkCmdPipelineBarrier(batch.cmd_, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+                         0, nullptr, static_cast<uint32_t>(barriers.size()),
+                         barriers.data());
+
+    if (vkEndCommandBuffer(batch.cmd_) != VK_SUCCESS)
+        throw std::runtime_error("failed to end upload command buffer!");
+}
+
+void UploadService::recordMipBlits(const Batch& batch)
+{
+    //Step n writes level copied + n of every image that has it, so the
+    //barriers of all images are issued together before the blits of a step
+    std::vector<VkImageMemoryBarrier> barriers;
+    for (uint32_t step = 0;; ++step)
+        {
+            barriers.clear();
+            for (const ImageCopy& copy : batch.imageCopies_)
+                {
+                    const auto     copied = static_cast<uint32_t>(copy.regions_.size());
+                    const uint32_t level  = copied + step;
+                    if (level >= copy.mipLevels_)
+                        continue;
+
+                    //First step turns every copied level into a source
+                    VkImageMemoryBarrier barrier {};
+                    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    barrier.image               = copy.dst_;
+                    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                    barrier.subresourceRange.baseMipLevel = step == 0 ? 0 : level - 1;
+                    barrier.subresourceRange.levelCount   = step == 0 ? copied : 1;
+                    barrier.subresourceRange.baseArrayLayer = 0;
+                    barrier.subresourceRange.layerCount     = 1;
+                    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+                    barriers.push_back(barrier);
+                }
+            if (barriers.empty())
+                return;
+            vkCmdPipelineBarrier(batch.cmd_, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+                                 0, nullptr,
+                                 static_cast<uint32_t>(barriers.size()),
+                                 barriers.data());
+
+            for (const ImageCopy& copy : batch.imageCopies_)
+                {
+                    const uint32_t level =
+                        static_cast<uint32_t>(copy.regions_.size()) + step;
+                    if (level >= copy.mipLevels_)
+                        continue;
+
+                    const VkExtent3D& base = copy.regions_.front().imageExtent;
+                    auto extent = [&base](uint32_t mip)
+                    {
+                        return VkOffset3D {
+                            static_cast<int32_t>(std::max(base.width >> mip, 1u)),
+                            static_cast<int32_t>(std::max(base.height >> mip, 1u)),
+                            1};
+                    };
+                    VkImageBlit blit {};
+                    blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1,
+                                           0, 1};
+                    blit.srcOffsets[1]  = extent(level - 1);
+                    blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+                    blit.dstOffsets[1]  = extent(level);
+                    vkCmdBlitImage(batch.cmd_, copy.dst_,
+                                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                   copy.dst_,
+                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
+                                   &blit, VK_FILTER_LINEAR);
+                }
+        }
+}
+
+void UploadService::submit()
+{
+    if (pending_.bufferCopies_.empty() && pending_.imageCopies_.empty())
+        return;
+
+    pending_.cmd_   = acquireCommandBuffer();
+    pending_.value_ = nextValue_;
+    record(pending_);
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues    = &pending_.value_;
+
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext                = &timelineInfo;
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.pCommandBuffers      = &pending_.cmd_;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = &semaphore_;
+
+    if (vkQueueSubmit(queue_, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+        throw std::runtime_error("failed to submit uploads!");
+
+    pending_.submitted_ = std::chrono::steady_clock::now();
+    submittedValue_     = nextValue_++;
+    inFlight_.push_back(std::move(pending_));
+    pending_ = Batch {};
+}
+
+void UploadService::reclaim()
+{
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(device_, semaphore_, &completed);
+
+    while (!inFlight_.empty() && inFlight_.front().value_ <= completed)
+        {
+            const Batch& batch = inFlight_.front();
+            //Completion is only noticed when polled, so this is a lower bound
+            const double seconds =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                              batch.submitted_)
+                    .count();
+            LOG_DEBUG(logger_.get(),
+                      "Upload batch {}: {} buffer and {} image copies, {:.2f} "
+                      "MiB in {:.2f} ms ({:.1f} MB/s)",
+                      batch.value_, batch.bufferCopies_.size(),
+                      batch.imageCopies_.size(),
+                      batch.payload_ / (1024.0 * 1024.0), seconds * 1e3,
+                      seconds > 0 ? batch.payload_ / seconds / 1e6 : 0.0);
+            used_ -= batch.bytes_;
+            freeCmds_.push_back(inFlight_.front().cmd_);
+            inFlight_.pop_front();
+        }
+    //Restart at the front while the ring is idle to avoid wrapping
+    if (used_ == 0)
+        head_ = 0;
+}
+
+void UploadService::waitOldest()
+{
+    if (inFlight_.empty())
+        return;
+
+    VkSemaphoreWaitInfo waitInfo {};
+    waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores    = &semaphore_;
+    waitInfo.pValues        = &inFlight_.front().value_;
+    if (vkWaitSemaphores(device_, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+        throw std::runtime_error("failed to wait for uploads!");
+    reclaim();
+}
+
+} // namespace Multor::Vulkan
@@ -0,0 +1,155 @@
+/// \file upload_service.h
+
+#pragma once
+
+#include "../logger/logger.h"
+#include "../utils/mip_chain.h"
+#include "memory_allocator.h"
+#include "objects/buffer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace Multor::Vulkan
+{
+
+/// \brief Records buffer and image uploads into batches submitted to the
+/// transfer queue without waiting for them on the host.
+///
+/// Source data is copied into a persistently mapped staging ring. Copies are
+/// only collected until the batch is submitted, then recorded into a single
+/// command buffer with one barrier per layout transition for all of its
+/// images. Each submitted batch signals the next value of a timeline
+/// semaphore, staging space of a batch is reused once the semaphore has
+/// passed its value.
+/// Consumers wait for the value returned by the upload calls, either on the
+/// GPU at first use or on the host with Wait.
+///
+/// Destinations have to be shared with the graphics family when the
+/// transfer queue belongs to another family, so no ownership transfer is
+/// recorded.
+class UploadService
+{
+public:
+    /// \param canBlit Whether \p queueFamily supports graphics, which
+    /// vkCmdBlitImage requires
+    UploadService(VkDevice device, std::shared_ptr<MemoryAllocator> allocator,
+                  VkQueue queue, uint32_t queueFamily,
+                  VkDeviceSize stagingSize, bool canBlit);
+    ~UploadService();
+
+    UploadService(const UploadService&)            = delete;
+    UploadService& operator=(const UploadService&) = delete;
+
+    /// \brief Copies \p size bytes of \p data into \p dst at \p dstOffset
+    /// \return Semaphore value signaled once the copy is complete
+    uint64_t UploadBuffer(VkBuffer dst, const void* data, VkDeviceSize size,
+                          VkDeviceSize dstOffset = 0);
+    /// \brief Fills a color image and leaves its \p mipLevels levels in
+    /// SHADER_READ_ONLY_OPTIMAL layout.
+    ///
+    /// \p levels, level 0 first, are copied from \p data at offsets
+    /// aligned to the texel size. Levels past them are blitted down from
+    /// the last copied one, which needs CanBlit and an image with
+    /// TRANSFER_SRC usage.
+    /// \return Semaphore value signaled once the copy is complete
+    uint64_t UploadImage(VkImage image, const std::vector<MipLevel>& levels,
+                         uint32_t mipLevels, const void* data,
+                         VkDeviceSize size);
+
+    /// \brief Submits the recorded uploads
+    /// \return Value signaled by the last submitted batch
+    uint64_t Flush();
+    /// \brief Blocks until \p value is signaled, flushing it if needed
+    void     Wait(uint64_t value);
+    bool     IsComplete(uint64_t value) const;
+
+    //Whether UploadImage can generate mip levels on the GPU
+    bool        CanBlit() const { return canBlit_; }
+    VkSemaphore GetSemaphore() const { return semaphore_; }
+    uint32_t    GetQueueFamily() const { return queueFamily_; }
+    /// \brief Bytes of source data passed to the upload calls so far
+    uint64_t    GetUploadedBytes() const { return uploadedBytes_; }
+
+private:
+    struct BufferCopy
+    {
+        VkBuffer     src_;
+        VkBuffer     dst_;
+        VkBufferCopy region_;
+    };
+
+    struct ImageCopy
+    {
+        VkBuffer                       src_;
+        VkImage                        dst_;
+        //One per copied level, the remaining levels are blitted
+        std::vector<VkBufferImageCopy> regions_;
+        uint32_t                       mipLevels_;
+    };
+
+    struct Batch
+    {
+        VkCommandBuffer cmd_   = VK_NULL_HANDLE;
+        uint64_t        value_ = 0;
+        //Ring bytes consumed by the batch, padding included
+        VkDeviceSize    bytes_ = 0;
+        //Source bytes copied by the batch
+        VkDeviceSize    payload_ = 0;
+        std::vector<BufferCopy> bufferCopies_;
+        std::vector<ImageCopy>  imageCopies_;
+        //Uploads larger than the ring get their own staging buffer
+        std::vector<std::unique_ptr<Buffer> > overflow_;
+        std::chrono::steady_clock::time_point submitted_ {};
+    };
+
+    struct Staging
+    {
+        VkBuffer     buffer_;
+        VkDeviceSize offset_;
+    };
+
+    std::unique_ptr<Buffer> createStagingBuffer(VkDeviceSize size);
+    Staging         stage(const void* data, VkDeviceSize size,
+                          VkDeviceSize alignment);
+    VkCommandBuffer acquireCommandBuffer();
+    void            record(const Batch& batch);
+    void            recordMipBlits(const Batch& batch);
+    void            submit();
+    void            reclaim();
+    void            waitOldest();
+
+private:
+    Logging::Logger& logger_;
+
+    VkDevice                         device_;
+    std::shared_ptr<MemoryAllocator> allocator_;
+    VkQueue                          queue_;
+    uint32_t                         queueFamily_;
+    bool                             canBlit_;
+    VkCommandPool                    commandPool_ = VK_NULL_HANDLE;
+    VkSemaphore                      semaphore_   = VK_NULL_HANDLE;
+
+    std::unique_ptr<Buffer> ring_;
+    VkDeviceSize            ringSize_;
+    VkDeviceSize            head_ = 0;
+    VkDeviceSize            used_ = 0;
+
+    Batch                        pending_;
+    std::deque<Batch>            inFlight_;
+    std::vector<VkCommandBuffer> freeCmds_;
+    //Value the pending batch will signal
+    uint64_t                     nextValue_      = 1;
+    uint64_t                     submittedValue_ = 0;
+    uint64_t                     uploadedBytes_  = 0;
+
+    mutable std::mutex mutex_;
+};
+
+} // namespace Multor::Vulkan